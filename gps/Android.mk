@@ -0,0 +1,132 @@
+#
+# Copyright (C) 2016 The CyanogenMod Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+LOCAL_PATH := $(call my-dir)
+
+# Streaming NMEA parser and sentence generators, see nmea.h
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    nmea.c
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../include
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)
+LOCAL_CFLAGS := -O2 -Wall -Werror
+
+LOCAL_MODULE := libnmea
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_STATIC_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    nmea.c
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../include \
+    hardware/libhardware/include
+
+LOCAL_EXPORT_C_INCLUDE_DIRS := $(LOCAL_PATH)
+LOCAL_CFLAGS := -O2 -Wall -Werror
+
+LOCAL_MODULE := libnmea
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+
+# Parser throughput on captured or synthesized receiver output
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    nmea-bench.c
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../include \
+    hardware/libhardware/include
+
+LOCAL_CFLAGS := -O2 -Wall -Werror
+LOCAL_LDLIBS := -lm -lrt
+LOCAL_STATIC_LIBRARIES := libnmea
+
+LOCAL_MODULE := nmea-bench
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
+
+# Replaying stand-in for the proprietary gps.default.so, see gps-replay.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    gnss-soa.c \
+    gnss-stats.c \
+    gps-replay.c \
+    spsc-ring.c
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../include
+
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_STATIC_LIBRARIES := libnmea
+
+LOCAL_MODULE := gps.replay
+LOCAL_MODULE_RELATIVE_PATH := hw
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_SHARED_LIBRARY)
+
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    gnss-soa.c \
+    gnss-stats.c \
+    gps-replay.c \
+    spsc-ring.c
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../include \
+    hardware/libhardware/include
+
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_LDLIBS := -lm -lpthread -lrt
+LOCAL_SHARED_LIBRARIES := liblog libcutils
+LOCAL_STATIC_LIBRARIES := libnmea
+
+LOCAL_MODULE := gps.replay
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_SHARED_LIBRARY)
+
+# Runs a GPS HAL session the way the framework does
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    gps-replaytest.c
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../include \
+    hardware/libhardware/include
+
+LOCAL_CFLAGS := -Wall -Werror
+LOCAL_LDLIBS := -ldl -lpthread -lrt
+
+LOCAL_MODULE := gps-replaytest
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
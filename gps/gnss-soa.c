@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "gnss-soa.h"
+
+void gnss_sv_from_status(struct gnss_sv_soa *soa, const GpsSvStatus *status)
+{
+    uint32_t i, n = status->num_svs < 0 ? 0
+            : status->num_svs > GPS_MAX_SVS ? GPS_MAX_SVS : status->num_svs;
+
+    soa->count = n;
+    soa->ephemeris_mask = status->ephemeris_mask;
+    soa->almanac_mask = status->almanac_mask;
+    soa->used_in_fix_mask = status->used_in_fix_mask;
+    for (i = 0; i < n; i++) {
+        const GpsSvInfo *sv = &status->sv_list[i];
+
+        soa->prn[i] = sv->prn;
+        soa->used[i] = sv->used;
+        soa->c_n0_dbhz[i] = sv->snr;
+        soa->elevation_deg[i] = sv->elevation;
+        soa->azimuth_deg[i] = sv->azimuth;
+    }
+}
+
+void gnss_sv_to_status(GpsSvStatus *status, const struct gnss_sv_soa *soa)
+{
+    uint32_t i;
+
+    status->size = sizeof(*status);
+    status->num_svs = soa->count;
+    status->ephemeris_mask = soa->ephemeris_mask;
+    status->almanac_mask = soa->almanac_mask;
+    status->used_in_fix_mask = soa->used_in_fix_mask;
+    for (i = 0; i < soa->count; i++) {
+        GpsSvInfo *sv = &status->sv_list[i];
+
+        sv->size = sizeof(*sv);
+        sv->prn = soa->prn[i];
+        sv->snr = soa->c_n0_dbhz[i];
+        sv->elevation = soa->elevation_deg[i];
+        sv->azimuth = soa->azimuth_deg[i];
+        sv->used = soa->used[i];
+    }
+}
+
+void gnss_measurements_reset(struct gnss_measurement_soa *soa, const GpsClock *clock)
+{
+    soa->count = 0;
+    soa->clock = *clock;
+}
+
+int gnss_measurements_append(struct gnss_measurement_soa *soa, const GpsMeasurement *m)
+{
+    uint32_t i = soa->count;
+
+    if (i == GPS_MAX_MEASUREMENT)
+        return -1;
+
+    soa->prn[i] = m->prn;
+    soa->state[i] = m->state;
+    soa->adr_state[i] = m->accumulated_delta_range_state;
+    soa->used_in_fix[i] = m->used_in_fix;
+    soa->flags[i] = m->flags & GNSS_SOA_MEASUREMENT_FLAGS;
+    soa->c_n0_dbhz[i] = m->c_n0_dbhz;
+    soa->pseudorange_rate_mps[i] = m->pseudorange_rate_mps;
+    soa->pseudorange_rate_uncertainty_mps[i] = m->pseudorange_rate_uncertainty_mps;
+    soa->adr_uncertainty_m[i] = m->accumulated_delta_range_uncertainty_m;
+    soa->elevation_deg[i] = m->elevation_deg;
+    soa->azimuth_deg[i] = m->azimuth_deg;
+    soa->adr_m[i] = m->accumulated_delta_range_m;
+    soa->time_offset_ns[i] = m->time_offset_ns;
+    soa->received_tow_ns[i] = m->received_gps_tow_ns;
+    soa->received_tow_uncertainty_ns[i] = m->received_gps_tow_uncertainty_ns;
+    soa->count++;
+
+    return 0;
+}
+
+void gnss_measurements_to_data(GpsData *data, const struct gnss_measurement_soa *soa)
+{
+    uint32_t i;
+
+    data->size = sizeof(*data);
+    data->measurement_count = soa->count;
+    data->clock = soa->clock;
+    for (i = 0; i < soa->count; i++) {
+        GpsMeasurement *m = &data->measurements[i];
+
+        memset(m, 0, sizeof(*m));
+        m->size = sizeof(*m);
+        m->flags = soa->flags[i];
+        m->prn = soa->prn[i];
+        m->time_offset_ns = soa->time_offset_ns[i];
+        m->state = soa->state[i];
+        m->received_gps_tow_ns = soa->received_tow_ns[i];
+        m->received_gps_tow_uncertainty_ns = soa->received_tow_uncertainty_ns[i];
+        m->c_n0_dbhz = soa->c_n0_dbhz[i];
+        m->pseudorange_rate_mps = soa->pseudorange_rate_mps[i];
+        m->pseudorange_rate_uncertainty_mps = soa->pseudorange_rate_uncertainty_mps[i];
+        m->accumulated_delta_range_state = soa->adr_state[i];
+        m->accumulated_delta_range_m = soa->adr_m[i];
+        m->accumulated_delta_range_uncertainty_m = soa->adr_uncertainty_m[i];
+        m->elevation_deg = soa->elevation_deg[i];
+        m->azimuth_deg = soa->azimuth_deg[i];
+        m->used_in_fix = soa->used_in_fix[i];
+    }
+}
+
+#define COPY_FIELD(dst, src, field) \
+    memcpy((dst)->field, (src)->field, (src)->count * sizeof((src)->field[0]))
+
+void gnss_measurements_copy(struct gnss_measurement_soa *dst,
+        const struct gnss_measurement_soa *src)
+{
+    dst->count = src->count;
+    dst->clock = src->clock;
+    COPY_FIELD(dst, src, prn);
+    COPY_FIELD(dst, src, state);
+    COPY_FIELD(dst, src, adr_state);
+    COPY_FIELD(dst, src, used_in_fix);
+    COPY_FIELD(dst, src, flags);
+    COPY_FIELD(dst, src, c_n0_dbhz);
+    COPY_FIELD(dst, src, pseudorange_rate_mps);
+    COPY_FIELD(dst, src, pseudorange_rate_uncertainty_mps);
+    COPY_FIELD(dst, src, adr_uncertainty_m);
+    COPY_FIELD(dst, src, elevation_deg);
+    COPY_FIELD(dst, src, azimuth_deg);
+    COPY_FIELD(dst, src, adr_m);
+    COPY_FIELD(dst, src, time_offset_ns);
+    COPY_FIELD(dst, src, received_tow_ns);
+    COPY_FIELD(dst, src, received_tow_uncertainty_ns);
+}
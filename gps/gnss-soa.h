@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GNSS_SOA_H
+#define GNSS_SOA_H
+
+#include <stdint.h>
+
+#include <hardware/gps.h>
+
+__BEGIN_DECLS
+
+/*
+ * Internal struct-of-arrays forms of GpsSvStatus and GpsData.
+ *
+ * The HAL structs are arrays of large per-satellite structs, a GpsData is
+ * about 8 KB of which an epoch typically uses a few hundred bytes. Here
+ * every per-satellite field is its own array, so a pass over one field
+ * (say C/N0 for a filter or statistics) reads just that field, with unit
+ * stride that the compiler can vectorize, and copies move only what is
+ * kept. Arrays are 16 byte aligned and have room for GPS_MAX_SVS or
+ * GPS_MAX_MEASUREMENT entries. Entries from count up hold stale or
+ * uninitialised values: a vector pass may load them, but has to mask them
+ * off before they reach a result.
+ *
+ * Narrowing: PRNs go to int16_t, and pseudorange rates and all
+ * uncertainties, angles and C/N0 to float. The accumulated delta range
+ * stays double, it needs mm resolution over km.
+ */
+
+#define GNSS_SOA_ALIGN  __attribute__((aligned(16)))
+
+struct gnss_sv_soa {
+    uint32_t count;
+    uint32_t ephemeris_mask;
+    uint32_t almanac_mask;
+    uint32_t used_in_fix_mask;
+
+    int16_t prn[GPS_MAX_SVS] GNSS_SOA_ALIGN;
+    uint8_t used[GPS_MAX_SVS] GNSS_SOA_ALIGN;
+    float c_n0_dbhz[GPS_MAX_SVS] GNSS_SOA_ALIGN;
+    float elevation_deg[GPS_MAX_SVS] GNSS_SOA_ALIGN;
+    float azimuth_deg[GPS_MAX_SVS] GNSS_SOA_ALIGN;
+};
+
+/*
+ * The GpsMeasurement fields a receiver without carrier phase or code
+ * phase output reports; the rest are zero after gnss_measurements_to_data().
+ * Only the flags for fields kept here (GNSS_SOA_MEASUREMENT_FLAGS) are
+ * kept, so a zeroed field is never claimed to be there.
+ */
+#define GNSS_SOA_MEASUREMENT_FLAGS \
+    (GPS_MEASUREMENT_HAS_ELEVATION | GPS_MEASUREMENT_HAS_AZIMUTH \
+            | GPS_MEASUREMENT_HAS_USED_IN_FIX | GPS_MEASUREMENT_HAS_UNCORRECTED_PSEUDORANGE_RATE)
+
+struct gnss_measurement_soa {
+    uint32_t count;
+    GpsClock clock;
+
+    int16_t prn[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    GpsMeasurementState state[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    GpsAccumulatedDeltaRangeState adr_state[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    uint8_t used_in_fix[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    GpsMeasurementFlags flags[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float c_n0_dbhz[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float pseudorange_rate_mps[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float pseudorange_rate_uncertainty_mps[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float adr_uncertainty_m[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float elevation_deg[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float azimuth_deg[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    double adr_m[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    double time_offset_ns[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    int64_t received_tow_ns[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    int64_t received_tow_uncertainty_ns[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+};
+
+void gnss_sv_from_status(struct gnss_sv_soa *soa, const GpsSvStatus *status);
+void gnss_sv_to_status(GpsSvStatus *status, const struct gnss_sv_soa *soa);
+
+/* Start an epoch with clock, no measurements */
+void gnss_measurements_reset(struct gnss_measurement_soa *soa, const GpsClock *clock);
+/* 0, or -1 if the epoch is full */
+int gnss_measurements_append(struct gnss_measurement_soa *soa, const GpsMeasurement *m);
+void gnss_measurements_to_data(GpsData *data, const struct gnss_measurement_soa *soa);
+
+/* Copy only the count entries in use of each array */
+void gnss_measurements_copy(struct gnss_measurement_soa *dst,
+        const struct gnss_measurement_soa *src);
+
+__END_DECLS
+
+#endif /* GNSS_SOA_H */
@@ -0,0 +1,304 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "gnss-stats.h"
+
+/* Beyond the common clock drift, an SV's range rate changes by under 1 m/s^2 */
+#define PRR_DYNAMICS_MPS2   1.0f
+#define PRR_SIGMAS          3.0f
+/* Less than an L1 cycle isn't told from Doppler integration noise */
+#define ADR_SLIP_MIN_M      0.19f
+#define ADR_SIGMAS          3.0f
+/* Epochs further apart than this aren't compared */
+#define MAX_EPOCH_GAP_NS    10000000000LL
+
+/*
+ * GCC/clang vector extensions rather than intrinsics: NEON on ARM, SSE on
+ * host builds, scalar code where there is neither.
+ */
+#define LANES               4
+#define VECTORS             (GPS_MAX_MEASUREMENT / LANES)
+
+typedef float v4sf __attribute__((vector_size(16)));
+typedef int32_t v4si __attribute__((vector_size(16)));
+
+static const char *s_constellation_names[GNSS_CONSTELLATION_COUNT] = {
+    [GNSS_CONSTELLATION_GPS] = "gps",
+    [GNSS_CONSTELLATION_SBAS] = "sbas",
+    [GNSS_CONSTELLATION_GLONASS] = "glonass",
+    [GNSS_CONSTELLATION_OTHER] = "other",
+};
+
+static inline v4sf load_f(const float *p)
+{
+    v4sf v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline v4si load_i(const int32_t *p)
+{
+    v4si v;
+
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* x where mask is all ones, 0.0f where it is 0 */
+static inline v4sf select_f(v4si mask, v4sf x)
+{
+    return (v4sf)(mask & (v4si)x);
+}
+
+static inline v4sf abs_f(v4sf x)
+{
+    return (v4sf)((v4si)x & 0x7fffffff);
+}
+
+static inline float sum_f(v4sf v)
+{
+    return v[0] + v[1] + v[2] + v[3];
+}
+
+/* Masks are -1 per set lane, so this counts them */
+static inline uint32_t count_i(v4si v)
+{
+    return -(v[0] + v[1] + v[2] + v[3]);
+}
+
+static int32_t constellation(int prn)
+{
+    if (prn >= 1 && prn <= 32)
+        return GNSS_CONSTELLATION_GPS;
+    if (prn >= 33 && prn <= 64)
+        return GNSS_CONSTELLATION_SBAS;
+    if (prn >= 65 && prn <= 96)
+        return GNSS_CONSTELLATION_GLONASS;
+    return GNSS_CONSTELLATION_OTHER;
+}
+
+/* Median of the n values of x, which it sorts; n is at most GPS_MAX_MEASUREMENT */
+static float median(float *x, uint32_t n)
+{
+    uint32_t i, j;
+
+    for (i = 1; i < n; i++) {
+        float t = x[i];
+
+        for (j = i; j > 0 && x[j - 1] > t; j--)
+            x[j] = x[j - 1];
+        x[j] = t;
+    }
+    return n % 2 ? x[n / 2] : 0.5f * (x[n / 2 - 1] + x[n / 2]);
+}
+
+void gnss_stats_reset(struct gnss_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void gnss_stats_update(struct gnss_stats *stats, const struct gnss_measurement_soa *m)
+{
+    /* Per lane inputs; unused lanes are in no constellation and have no previous epoch */
+    int32_t cls[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    int32_t has_prev[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    int32_t adr_both[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float prev_prr[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float prev_uncertainty[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    float adr_delta[GPS_MAX_MEASUREMENT] GNSS_SOA_ALIGN;
+    /* Rate changes of the SVs seen in both epochs, packed */
+    float deltas[GPS_MAX_MEASUREMENT];
+    uint32_t delta_n = 0;
+    v4sf cn0_sum[GNSS_CONSTELLATION_COUNT], cn0_sum_sq[GNSS_CONSTELLATION_COUNT];
+    v4si cn0_n[GNSS_CONSTELLATION_COUNT];
+    v4sf residual_sum_sq = { 0 };
+    v4si outliers = { 0 }, adr_n = { 0 }, slips = { 0 };
+    uint32_t n = m->count > GPS_MAX_MEASUREMENT ? GPS_MAX_MEASUREMENT : m->count;
+    uint32_t slot = stats->epochs % GNSS_STATS_WINDOW;
+    int64_t dt_ns = m->clock.time_ns - stats->last_time_ns;
+    int compare = stats->epochs > 0 && dt_ns > 0 && dt_ns <= MAX_EPOCH_GAP_NS;
+    float dt = dt_ns / 1e9f;
+    float common_delta;
+    v4si use_residuals;
+    uint32_t i, v;
+    int k;
+
+    /*
+     * Look up each SV's previous epoch. The vector passes below still load
+     * m's arrays from count up, which hold whatever was there before (see
+     * gnss-soa.h); those lanes are masked off bitwise by the zero masks
+     * set here, so the values never reach a sum or a count.
+     */
+    for (i = 0; i < GPS_MAX_MEASUREMENT; i++) {
+        uint32_t p;
+        int seen, adr_valid;
+
+        if (i >= n) {
+            cls[i] = -1;
+            has_prev[i] = adr_both[i] = 0;
+            prev_prr[i] = prev_uncertainty[i] = adr_delta[i] = 0;
+            continue;
+        }
+
+        p = m->prn[i] & (GNSS_STATS_PRNS - 1);
+        seen = compare && stats->last_epoch[p] == stats->epochs;
+        adr_valid = (m->adr_state[i] & (GPS_ADR_STATE_VALID | GPS_ADR_STATE_RESET))
+                == GPS_ADR_STATE_VALID;
+        cls[i] = constellation(m->prn[i]);
+        has_prev[i] = -seen;
+        prev_prr[i] = stats->last_prr_mps[p];
+        prev_uncertainty[i] = stats->last_prr_uncertainty_mps[p];
+        adr_both[i] = -(seen && adr_valid && stats->last_adr_valid[p]);
+        adr_delta[i] = adr_both[i] ? (float)(m->adr_m[i] - stats->last_adr_m[p]) : 0;
+        if (seen)
+            deltas[delta_n++] = m->pseudorange_rate_mps[i] - prev_prr[i];
+        if (m->adr_state[i] & (GPS_ADR_STATE_RESET | GPS_ADR_STATE_CYCLE_SLIP))
+            stats->adr_slips_reported++;
+    }
+
+    /* C/N0 sums per constellation */
+    memset(cn0_sum, 0, sizeof(cn0_sum));
+    memset(cn0_sum_sq, 0, sizeof(cn0_sum_sq));
+    memset(cn0_n, 0, sizeof(cn0_n));
+    for (v = 0; v < GPS_MAX_MEASUREMENT; v += LANES) {
+        v4sf cn0 = load_f(&m->c_n0_dbhz[v]);
+        v4si c = load_i(&cls[v]);
+
+        for (k = 0; k < GNSS_CONSTELLATION_COUNT; k++) {
+            v4si in = c == k;
+            v4sf x = select_f(in, cn0);
+
+            cn0_sum[k] += x;
+            cn0_sum_sq[k] += x * x;
+            cn0_n[k] += in;
+        }
+    }
+
+    /*
+     * The common clock drift change is the median rate change, so one bad
+     * SV doesn't shift everyone else's residual. With a single SV the
+     * residual is 0 by definition, don't count it.
+     */
+    common_delta = delta_n ? median(deltas, delta_n) : 0;
+    use_residuals = (v4si){ 0 } - (delta_n >= 2);
+
+    /* Residuals and outliers, and ADR change against integrated rate */
+    for (v = 0; v < GPS_MAX_MEASUREMENT; v += LANES) {
+        v4sf prr = load_f(&m->pseudorange_rate_mps[v]);
+        v4sf prr_prev = load_f(&prev_prr[v]);
+        v4sf uncertainty = load_f(&m->pseudorange_rate_uncertainty_mps[v])
+                + load_f(&prev_uncertainty[v]);
+        v4si prev = load_i(&has_prev[v]) & use_residuals;
+        v4si adr = load_i(&adr_both[v]);
+        v4sf residual = prr - prr_prev - common_delta;
+        v4sf prr_limit = PRR_SIGMAS * uncertainty + PRR_DYNAMICS_MPS2 * dt;
+        v4sf adr_error = load_f(&adr_delta[v]) - 0.5f * (prr + prr_prev) * dt;
+        v4sf adr_limit = ADR_SIGMAS * (0.5f * uncertainty * dt
+                + load_f(&m->adr_uncertainty_m[v])) + ADR_SLIP_MIN_M;
+
+        residual = select_f(prev, residual);
+        residual_sum_sq += residual * residual;
+        outliers += prev & (abs_f(residual) > prr_limit);
+        adr_n += adr;
+        slips += adr & (abs_f(adr_error) > adr_limit);
+    }
+
+    for (k = 0; k < GNSS_CONSTELLATION_COUNT; k++) {
+        struct gnss_cn0_epoch *e = &stats->cn0[k][slot];
+
+        e->n = count_i(cn0_n[k]);
+        e->sum = sum_f(cn0_sum[k]);
+        e->sum_sq = sum_f(cn0_sum_sq[k]);
+    }
+    if (delta_n >= 2) {
+        stats->prr_residuals += delta_n;
+        stats->prr_residual_sum_sq += sum_f(residual_sum_sq);
+    }
+    stats->prr_outliers += count_i(outliers);
+    stats->adr_checked += count_i(adr_n);
+    stats->adr_slips_detected += count_i(slips);
+
+    stats->epochs++;
+    stats->measurements += n;
+    stats->last_time_ns = m->clock.time_ns;
+    for (i = 0; i < n; i++) {
+        uint32_t p = m->prn[i] & (GNSS_STATS_PRNS - 1);
+
+        stats->last_epoch[p] = stats->epochs;
+        stats->last_prr_mps[p] = m->pseudorange_rate_mps[i];
+        stats->last_prr_uncertainty_mps[p] = m->pseudorange_rate_uncertainty_mps[i];
+        stats->last_adr_m[p] = m->adr_m[i];
+        stats->last_adr_valid[p] = (m->adr_state[i] & GPS_ADR_STATE_VALID) != 0;
+    }
+}
+
+int gnss_stats_cn0(const struct gnss_stats *stats, enum gnss_constellation constellation,
+        uint32_t *count, double *mean, double *variance)
+{
+    double sum = 0, sum_sq = 0;
+    uint32_t n = 0;
+    int i;
+
+    for (i = 0; i < GNSS_STATS_WINDOW; i++) {
+        const struct gnss_cn0_epoch *e = &stats->cn0[constellation][i];
+
+        n += e->n;
+        sum += e->sum;
+        sum_sq += e->sum_sq;
+    }
+    if (n == 0)
+        return -1;
+
+    *count = n;
+    *mean = sum / n;
+    *variance = n > 1 ? (sum_sq - sum * *mean) / (n - 1) : 0;
+    if (*variance < 0)
+        *variance = 0;
+    return 0;
+}
+
+int gnss_stats_format(const struct gnss_stats *stats, char *buf, size_t size)
+{
+    int len, shown = 0;
+    int k;
+
+    len = snprintf(buf, size, "%" PRIu64 " epochs, C/N0 dBHz", stats->epochs);
+    for (k = 0; k < GNSS_CONSTELLATION_COUNT && len >= 0 && (size_t)len < size; k++) {
+        double mean, variance;
+        uint32_t n;
+
+        if (gnss_stats_cn0(stats, k, &n, &mean, &variance) < 0)
+            continue;
+        len += snprintf(buf + len, size - len, "%s %s %.1f sd %.1f (%u)",
+                shown++ ? "," : "", s_constellation_names[k], mean, sqrt(variance), n);
+    }
+    if (!shown && len >= 0 && (size_t)len < size)
+        len += snprintf(buf + len, size - len, " none");
+    if (len >= 0 && (size_t)len < size)
+        len += snprintf(buf + len, size - len, ", prr residual rms %.3f m/s (%" PRIu64
+                "), %" PRIu64 " outliers, adr %" PRIu64 " slips detected in %" PRIu64
+                " checked, %" PRIu64 " reported",
+                stats->prr_residuals ? sqrt(stats->prr_residual_sum_sq / stats->prr_residuals) : 0,
+                stats->prr_residuals, stats->prr_outliers, stats->adr_slips_detected,
+                stats->adr_checked, stats->adr_slips_reported);
+    return len;
+}
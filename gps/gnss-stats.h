@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef GNSS_STATS_H
+#define GNSS_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gnss-soa.h"
+
+__BEGIN_DECLS
+
+/*
+ * Signal quality statistics over a stream of measurement epochs:
+ *
+ * - C/N0 mean and variance per constellation over the last
+ *   GNSS_STATS_WINDOW epochs.
+ * - Pseudorange rate residuals. Each SV's rate change since the previous
+ *   epoch has the epoch's median change removed, which is the common
+ *   receiver clock drift change and isn't pulled by an outlier. What is
+ *   left should stay within the SV dynamics and the reported
+ *   uncertainties; larger residuals count as outliers.
+ * - Accumulated delta range slips. The ADR change of each SV valid in both
+ *   epochs is checked against its pseudorange rate integrated over the
+ *   epoch. Slips the receiver reports itself are counted separately.
+ *
+ * An update does all 32 measurement slots at once, a few passes of four
+ * lane vectors over the gnss_measurement_soa arrays. Only looking up each
+ * SV's previous epoch is per SV.
+ *
+ * Constellations follow the NMEA SV numbering: 1-32 GPS, 33-64 SBAS,
+ * 65-96 GLONASS. The measurement PRN of this HAL version is GPS only, so
+ * the other classes are for receivers that number SVs that way anyway.
+ */
+
+#define GNSS_STATS_WINDOW   16
+#define GNSS_STATS_PRNS     128
+
+enum gnss_constellation {
+    GNSS_CONSTELLATION_GPS,
+    GNSS_CONSTELLATION_SBAS,
+    GNSS_CONSTELLATION_GLONASS,
+    GNSS_CONSTELLATION_OTHER,
+    GNSS_CONSTELLATION_COUNT,
+};
+
+struct gnss_cn0_epoch {
+    uint32_t n;
+    float sum;
+    float sum_sq;
+};
+
+struct gnss_stats {
+    uint64_t epochs;
+    uint64_t measurements;
+
+    /* Indexed by epochs % GNSS_STATS_WINDOW */
+    struct gnss_cn0_epoch cn0[GNSS_CONSTELLATION_COUNT][GNSS_STATS_WINDOW];
+
+    uint64_t prr_residuals;
+    double prr_residual_sum_sq;
+    uint64_t prr_outliers;
+
+    uint64_t adr_checked;
+    uint64_t adr_slips_detected;
+    uint64_t adr_slips_reported;
+
+    /* Each SV's previous epoch, by PRN; last_epoch is the epochs count then */
+    int64_t last_time_ns;
+    uint64_t last_epoch[GNSS_STATS_PRNS];
+    float last_prr_mps[GNSS_STATS_PRNS];
+    float last_prr_uncertainty_mps[GNSS_STATS_PRNS];
+    double last_adr_m[GNSS_STATS_PRNS];
+    uint8_t last_adr_valid[GNSS_STATS_PRNS];
+};
+
+void gnss_stats_reset(struct gnss_stats *stats);
+void gnss_stats_update(struct gnss_stats *stats, const struct gnss_measurement_soa *m);
+
+/* C/N0 over the window; 0, or -1 with nothing seen of constellation */
+int gnss_stats_cn0(const struct gnss_stats *stats, enum gnss_constellation constellation,
+        uint32_t *count, double *mean, double *variance);
+
+/* A one line summary like snprintf, without a newline */
+int gnss_stats_format(const struct gnss_stats *stats, char *buf, size_t size);
+
+__END_DECLS
+
+#endif /* GNSS_STATS_H */
@@ -0,0 +1,1424 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stand-in for the proprietary gps.default.so, for exercising the location
+ * stack without the BCM4752. Recorded receiver output is replayed through
+ * GpsInterface at real or scaled speed: NMEA sentences go to nmea_cb and
+ * through libnmea to location_cb and sv_status_cb, recorded raw data to
+ * the GpsMeasurementInterface and GpsNavigationMessageInterface callbacks.
+ *
+ * The recordings are named in a config file, GPS_REPLAY_CONF from the
+ * environment (for host runs) or ro.gps.replay.conf, default
+ * /system/etc/gps-replay.conf. One directive per line, '#' starts a
+ * comment:
+ *   nmea <file>           raw receiver output, paced by the sentence times
+ *   measurements <file>   raw data records, see below
+ *   navigation <file>     same format; both may hold either kind of record
+ *   speed <factor>        replay speed, 0 replays as fast as possible
+ *   loops <n>             passes over the recordings, 0 loops forever
+ *
+ * Raw data records, one per line, times in milliseconds from the start of
+ * the recording and not decreasing:
+ *   <time> clock <time_ns> [<full_bias_ns> [<bias_ns> [<drift_nsps>]]]
+ *       Starts a GpsData epoch, GPS_CLOCK_TYPE_LOCAL_HW_TIME.
+ *   <time> meas <prn> <c_n0_dbhz> <pseudorange_rate_mps> <uncertainty_mps>
+ *           [<adr_state> <adr_m> <adr_uncertainty_m> [<state> <tow_ns>]]
+ *       A GpsMeasurement of the epoch started at the same <time>.
+ *   <time> nav <prn> <type> <status> <message_id> <submessage_id> <hex>
+ *       A GpsNavigationMessage.
+ *
+ * set_position_mode() is honoured as far as a recording allows: fixes come
+ * no more often than min_interval, by fix time, and a single shot session
+ * ends after the first one. Stopping pauses the replay, starting resumes
+ * it where it was.
+ *
+ * Like a receiver driver, the replay thread produces and a dispatch thread,
+ * both made with create_thread_cb, makes the callbacks. In between sit
+ * lock-free single producer, single consumer rings of preallocated slots,
+ * one per callback type, deep enough to ride out a few seconds of a
+ * stalled framework at 10 Hz. A slow consumer so costs dropped callbacks,
+ * counted per ring, rather than a producer falling behind the receiver.
+ * Slots carry a sequence number and are dispatched in production order.
+ *
+ * Each produced event records how late it was relative to its scheduled
+ * time, each dispatched one how long it queued; a summary is logged after
+ * every pass and GPS_DEBUG_INTERFACE reports the totals. Measurement
+ * epochs on their way to the callback also go through gnss-stats, whose
+ * signal quality summary is reported the same way.
+ */
+
+#define LOG_TAG "gps-replay"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cutils/properties.h>
+#include <hardware/gps.h>
+#include <utils/Log.h>
+
+#include "gnss-soa.h"
+#include "gnss-stats.h"
+#include "nmea.h"
+#include "spsc-ring.h"
+
+#define CONF_PROPERTY       "ro.gps.replay.conf"
+#define CONF_ENV            "GPS_REPLAY_CONF"
+#define CONF_DEFAULT_PATH   "/system/etc/gps-replay.conf"
+
+/* A GPS L1 C/A subframe is 40 bytes, leave room for the other types */
+#define MAX_NAV_DATA        64
+#define MS_PER_DAY          86400000
+#define QUEUE_FULL_POLL_US  100
+
+struct nmea_line {
+    uint32_t time_ms;
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct measurement_epoch {
+    uint32_t time_ms;
+    uint32_t seq;
+    struct gnss_measurement_soa m;
+};
+
+struct nav_record {
+    uint32_t time_ms;
+    uint32_t seq;
+    GpsNavigationMessage message;
+    uint8_t data[MAX_NAV_DATA];
+};
+
+enum event_kind {
+    EVENT_NMEA,
+    EVENT_MEASUREMENT,
+    EVENT_NAVIGATION,
+};
+
+/* Dispatch queue slots start with the order they were produced in */
+struct slot_header {
+    uint64_t seq;
+    uint64_t produced_ns;
+};
+
+struct status_slot {
+    struct slot_header h;
+    GpsStatusValue status;
+};
+
+struct nmea_slot {
+    struct slot_header h;
+    GpsUtcTime timestamp;
+    int length;
+    char sentence[NMEA_MAX_SENTENCE + 1];
+};
+
+struct location_slot {
+    struct slot_header h;
+    GpsLocation location;
+};
+
+/* SV status and measurements queue in their compact form, see gnss-soa.h */
+struct sv_status_slot {
+    struct slot_header h;
+    struct gnss_sv_soa sv;
+};
+
+struct measurement_slot {
+    struct slot_header h;
+    struct gnss_measurement_soa m;
+};
+
+struct navigation_slot {
+    struct slot_header h;
+    GpsNavigationMessage message;
+    uint8_t data[MAX_NAV_DATA];
+};
+
+enum queue_id {
+    QUEUE_STATUS,
+    QUEUE_NMEA,
+    QUEUE_LOCATION,
+    QUEUE_SV_STATUS,
+    QUEUE_MEASUREMENT,
+    QUEUE_NAVIGATION,
+    QUEUE_COUNT,
+};
+
+/* Depths for about 5 s of a 10 Hz receiver with ~10 sentences per epoch */
+static const struct {
+    const char *name;
+    uint32_t slots;
+    size_t slot_size;
+} s_queue_config[QUEUE_COUNT] = {
+    [QUEUE_STATUS] = { "status", 16, sizeof(struct status_slot) },
+    [QUEUE_NMEA] = { "nmea", 512, sizeof(struct nmea_slot) },
+    [QUEUE_LOCATION] = { "location", 64, sizeof(struct location_slot) },
+    [QUEUE_SV_STATUS] = { "sv status", 64, sizeof(struct sv_status_slot) },
+    [QUEUE_MEASUREMENT] = { "measurement", 64, sizeof(struct measurement_slot) },
+    [QUEUE_NAVIGATION] = { "navigation", 64, sizeof(struct navigation_slot) },
+};
+
+struct replay_counts {
+    uint64_t nmea;
+    uint64_t locations;
+    uint64_t locations_skipped;
+    uint64_t sv_status;
+    uint64_t measurements;
+    uint64_t navigation;
+};
+
+/* Recordings, read-only once loaded */
+static char *s_nmea_data;
+static size_t s_nmea_size;
+static struct nmea_line *s_nmea_lines;
+static size_t s_nmea_count, s_nmea_capacity;
+static struct measurement_epoch *s_epochs;
+static size_t s_epoch_count, s_epoch_capacity;
+static struct nav_record *s_nav;
+static size_t s_nav_count, s_nav_capacity;
+static uint32_t s_seq;
+
+static double s_speed = 1.0;
+static int s_loops = 1;
+
+static GpsCallbacks s_callbacks;
+static GpsMeasurementCallbacks *s_measurement_cb;
+static GpsNavigationMessageCallbacks *s_navigation_cb;
+
+/* Between the replay and the dispatch thread; s_pending counts published slots */
+static struct spsc_ring s_queues[QUEUE_COUNT];
+static sem_t s_pending;
+static atomic_int s_dispatch_quit;
+static _Atomic uint64_t s_dispatched;
+static _Atomic uint64_t s_queued_ns;
+static _Atomic uint64_t s_max_queued_ns;
+
+/* Statistics of the measurements dispatched */
+static pthread_mutex_t s_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct gnss_stats s_stats;
+
+/* Session state, s_mutex protects everything below */
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond;
+static int s_initialized;
+static int s_replay_running;
+static int s_dispatch_running;
+static int s_quit;
+static int s_started;
+static int s_session;
+static int s_finished;
+static GpsPositionRecurrence s_recurrence = GPS_POSITION_RECURRENCE_PERIODIC;
+static uint32_t s_min_interval_ms;
+static struct replay_counts s_totals;
+static int s_pass;
+
+/* Replay position, only touched by the replay thread */
+static size_t s_next_nmea;
+static size_t s_next_epoch;
+static size_t s_next_nav;
+static uint64_t s_start_ns;
+static uint64_t s_paused_ns;
+static struct nmea_parser s_parser;
+static GpsUtcTime s_last_fix;
+static GpsPositionRecurrence s_fix_recurrence;
+static uint32_t s_fix_interval_ms;
+static struct replay_counts s_emitted;
+static uint64_t *s_lateness_ns;
+static size_t s_lateness_count;
+static uint64_t s_seq_produced;
+
+/* Dispatch thread's HAL structs, filled from the compact slots */
+static GpsSvStatus s_dispatch_sv;
+static GpsData s_dispatch_data;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static GpsUtcTime now_utc_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (GpsUtcTime)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Make room for one more element in a doubling array */
+static void *reserve(void *array, size_t *capacity, size_t count, size_t size)
+{
+    void *grown;
+    size_t n;
+
+    if (count < *capacity)
+        return array;
+    n = *capacity ? 2 * *capacity : 256;
+    grown = realloc(array, n * size);
+    if (grown != NULL)
+        *capacity = n;
+    return grown;
+}
+
+static int load_nmea(const char *path)
+{
+    FILE *fp;
+    char *data, *p, *end;
+    long size;
+    int last_tod = -1;
+    uint32_t time_ms = s_nmea_count ? s_nmea_lines[s_nmea_count - 1].time_ms : 0;
+    size_t first = s_nmea_count;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        ALOGE("Cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    if (fseek(fp, 0, SEEK_END) < 0 || (size = ftell(fp)) < 0 || fseek(fp, 0, SEEK_SET) < 0) {
+        ALOGE("Cannot size %s: %s", path, strerror(errno));
+        fclose(fp);
+        return -1;
+    }
+    data = realloc(s_nmea_data, s_nmea_size + size + 1);
+    if (data == NULL) {
+        ALOGE("Out of memory loading %s", path);
+        fclose(fp);
+        return -1;
+    }
+    s_nmea_data = data;
+    if (fread(s_nmea_data + s_nmea_size, 1, size, fp) != (size_t)size) {
+        ALOGE("Cannot read %s", path);
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+
+    /* Split into NUL terminated sentences in place */
+    p = s_nmea_data + s_nmea_size;
+    end = p + size;
+    *end = '\0';
+    while (p < end) {
+        char *eol = memchr(p, '\n', end - p);
+        char *start = memchr(p, '$', (eol ? eol : end) - p);
+        struct nmea_line *lines;
+        size_t length;
+        int tod;
+
+        if (eol == NULL)
+            eol = end;
+        *eol = '\0';
+        if (eol > p && eol[-1] == '\r')
+            eol[-1] = '\0';
+        if (start == NULL) {
+            p = eol + 1;
+            continue;
+        }
+        length = strlen(start);
+        if (length > NMEA_MAX_SENTENCE) {
+            p = eol + 1;
+            continue;
+        }
+
+        /*
+         * Sentences without a time go with the epoch of the last one that
+         * had one. A step back is a gap in the recording, not a reason to
+         * wait a day, except across midnight.
+         */
+        tod = nmea_time_of_day(start, length);
+        if (tod >= 0) {
+            if (last_tod >= 0) {
+                int delta = tod - last_tod;
+
+                if (delta < -MS_PER_DAY / 2)
+                    delta += MS_PER_DAY;
+                if (delta > 0)
+                    time_ms += delta;
+            }
+            last_tod = tod;
+        }
+
+        lines = reserve(s_nmea_lines, &s_nmea_capacity, s_nmea_count, sizeof(*lines));
+        if (lines == NULL) {
+            ALOGE("Out of memory loading %s", path);
+            return -1;
+        }
+        s_nmea_lines = lines;
+        lines[s_nmea_count].time_ms = time_ms;
+        lines[s_nmea_count].offset = start - s_nmea_data;
+        lines[s_nmea_count].length = length;
+        s_nmea_count++;
+
+        p = eol + 1;
+    }
+    s_nmea_size += size + 1;
+
+    ALOGI("Loaded %zu sentences spanning %u ms from %s", s_nmea_count - first,
+            s_nmea_count > first ? time_ms - s_nmea_lines[first].time_ms : 0, path);
+    return 0;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+/* Hex digits up to the end of the line, -1 if malformed or too long */
+static int parse_hex(const char *s, uint8_t *data, size_t size)
+{
+    size_t n = 0;
+
+    s += strspn(s, " \t");
+    while (hex_value(s[0]) >= 0 && hex_value(s[1]) >= 0) {
+        if (n == size)
+            return -1;
+        data[n++] = hex_value(s[0]) << 4 | hex_value(s[1]);
+        s += 2;
+    }
+    s += strspn(s, " \t\r\n");
+    return *s == '\0' ? (int)n : -1;
+}
+
+static int parse_clock(GpsClock *clock, const char *rest)
+{
+    int n;
+
+    memset(clock, 0, sizeof(*clock));
+    clock->size = sizeof(*clock);
+    clock->type = GPS_CLOCK_TYPE_LOCAL_HW_TIME;
+    n = sscanf(rest, "%" SCNd64 " %" SCNd64 " %lf %lf", &clock->time_ns,
+            &clock->full_bias_ns, &clock->bias_ns, &clock->drift_nsps);
+    if (n < 1)
+        return -1;
+    if (n >= 2)
+        clock->flags |= GPS_CLOCK_HAS_FULL_BIAS;
+    if (n >= 3)
+        clock->flags |= GPS_CLOCK_HAS_BIAS;
+    if (n >= 4)
+        clock->flags |= GPS_CLOCK_HAS_DRIFT;
+
+    return 0;
+}
+
+static int parse_measurement(GpsMeasurement *m, const char *rest)
+{
+    int prn, adr_state = GPS_ADR_STATE_UNKNOWN, state = GPS_MEASUREMENT_STATE_UNKNOWN;
+    int n;
+
+    memset(m, 0, sizeof(*m));
+    m->size = sizeof(*m);
+    n = sscanf(rest, "%d %lf %lf %lf %d %lf %lf %d %" SCNd64, &prn, &m->c_n0_dbhz,
+            &m->pseudorange_rate_mps, &m->pseudorange_rate_uncertainty_mps, &adr_state,
+            &m->accumulated_delta_range_m, &m->accumulated_delta_range_uncertainty_m,
+            &state, &m->received_gps_tow_ns);
+    if (n < 4 || (n > 4 && n < 7) || n == 8 || prn < 1 || prn > GPS_MAX_SVS)
+        return -1;
+
+    m->prn = prn;
+    m->accumulated_delta_range_state = adr_state;
+    m->state = state;
+    return 0;
+}
+
+static int parse_navigation(struct nav_record *nav, const char *rest)
+{
+    GpsNavigationMessage *message = &nav->message;
+    int prn, type, status, message_id, submessage_id, consumed = 0, length;
+
+    memset(message, 0, sizeof(*message));
+    message->size = sizeof(*message);
+    if (sscanf(rest, "%d %d %d %d %d %n", &prn, &type, &status, &message_id,
+            &submessage_id, &consumed) < 5 || consumed == 0
+            || prn < 1 || prn > GPS_MAX_SVS)
+        return -1;
+    length = parse_hex(rest + consumed, nav->data, sizeof(nav->data));
+    if (length <= 0)
+        return -1;
+
+    message->prn = prn;
+    message->type = type;
+    message->status = status;
+    message->message_id = message_id;
+    message->submessage_id = submessage_id;
+    message->data_length = length;
+    return 0;
+}
+
+static int load_raw(const char *path)
+{
+    char line[512];
+    unsigned last_ms = 0;
+    int lineno = 0;
+    struct measurement_epoch *epoch = NULL;
+    size_t epochs = s_epoch_count, navs = s_nav_count;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        ALOGE("Cannot open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char type[8];
+        unsigned time_ms;
+        int consumed = 0;
+        char *comment;
+        const char *rest;
+
+        lineno++;
+        comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+        if (strspn(line, " \t\r\n") == strlen(line))
+            continue;
+
+        if (sscanf(line, "%u %7s %n", &time_ms, type, &consumed) < 2
+                || consumed == 0 || time_ms < last_ms) {
+            ALOGW("%s:%d: bad record, skipped", path, lineno);
+            continue;
+        }
+        rest = line + consumed;
+
+        if (strcmp(type, "clock") == 0) {
+            struct measurement_epoch *epochs_grown = reserve(s_epochs, &s_epoch_capacity,
+                    s_epoch_count, sizeof(*s_epochs));
+            GpsClock clock;
+
+            if (epochs_grown == NULL)
+                goto oom;
+            s_epochs = epochs_grown;
+            epoch = NULL;
+            if (parse_clock(&clock, rest) < 0) {
+                ALOGW("%s:%d: bad clock, skipped", path, lineno);
+                continue;
+            }
+            epoch = &s_epochs[s_epoch_count++];
+            epoch->time_ms = time_ms;
+            epoch->seq = s_seq++;
+            gnss_measurements_reset(&epoch->m, &clock);
+        } else if (strcmp(type, "meas") == 0) {
+            GpsMeasurement m;
+
+            if (epoch == NULL || epoch->time_ms != time_ms
+                    || epoch->m.count == GPS_MAX_MEASUREMENT) {
+                ALOGW("%s:%d: measurement outside an epoch, skipped", path, lineno);
+                continue;
+            }
+            if (parse_measurement(&m, rest) < 0) {
+                ALOGW("%s:%d: bad measurement, skipped", path, lineno);
+                continue;
+            }
+            gnss_measurements_append(&epoch->m, &m);
+        } else if (strcmp(type, "nav") == 0) {
+            struct nav_record *nav = reserve(s_nav, &s_nav_capacity, s_nav_count,
+                    sizeof(*s_nav));
+
+            if (nav == NULL)
+                goto oom;
+            s_nav = nav;
+            if (parse_navigation(&s_nav[s_nav_count], rest) < 0) {
+                ALOGW("%s:%d: bad navigation message, skipped", path, lineno);
+                continue;
+            }
+            s_nav[s_nav_count].time_ms = time_ms;
+            s_nav[s_nav_count].seq = s_seq++;
+            s_nav_count++;
+        } else {
+            ALOGW("%s:%d: unknown record type '%s', skipped", path, lineno, type);
+            continue;
+        }
+
+        last_ms = time_ms;
+    }
+
+    fclose(fp);
+    ALOGI("Loaded %zu epochs and %zu navigation messages spanning %u ms from %s",
+            s_epoch_count - epochs, s_nav_count - navs, last_ms, path);
+    return 0;
+
+oom:
+    ALOGE("Out of memory loading %s", path);
+    fclose(fp);
+    return -1;
+}
+
+/* Records from several files interleave by time, ties in load order */
+static int compare_epochs(const void *a, const void *b)
+{
+    const struct measurement_epoch *x = a, *y = b;
+
+    if (x->time_ms != y->time_ms)
+        return x->time_ms < y->time_ms ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static int compare_nav(const void *a, const void *b)
+{
+    const struct nav_record *x = a, *y = b;
+
+    if (x->time_ms != y->time_ms)
+        return x->time_ms < y->time_ms ? -1 : 1;
+    return x->seq < y->seq ? -1 : x->seq > y->seq;
+}
+
+static int load_config(void)
+{
+    char path[PROPERTY_VALUE_MAX];
+    const char *env = getenv(CONF_ENV);
+    char line[512];
+    int lineno = 0;
+    FILE *fp;
+
+    if (env != NULL)
+        snprintf(path, sizeof(path), "%s", env);
+    else
+        property_get(CONF_PROPERTY, path, CONF_DEFAULT_PATH);
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        ALOGE("Cannot open config %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        char key[16], value[256];
+        char *comment;
+        int ret = 0;
+
+        lineno++;
+        comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+        if (strspn(line, " \t\r\n") == strlen(line))
+            continue;
+
+        if (sscanf(line, "%15s %255s", key, value) != 2) {
+            ALOGW("%s:%d: bad directive, skipped", path, lineno);
+            continue;
+        }
+        if (strcmp(key, "nmea") == 0)
+            ret = load_nmea(value);
+        else if (strcmp(key, "measurements") == 0 || strcmp(key, "navigation") == 0)
+            ret = load_raw(value);
+        else if (strcmp(key, "speed") == 0)
+            s_speed = atof(value);
+        else if (strcmp(key, "loops") == 0)
+            s_loops = atoi(value);
+        else
+            ALOGW("%s:%d: unknown directive '%s', skipped", path, lineno, key);
+
+        if (ret < 0) {
+            fclose(fp);
+            return -1;
+        }
+    }
+    fclose(fp);
+
+    if (s_nmea_count + s_epoch_count + s_nav_count == 0) {
+        ALOGE("Nothing to replay in %s", path);
+        return -1;
+    }
+
+    qsort(s_epochs, s_epoch_count, sizeof(*s_epochs), compare_epochs);
+    qsort(s_nav, s_nav_count, sizeof(*s_nav), compare_nav);
+
+    s_lateness_ns = calloc(s_nmea_count + s_epoch_count + s_nav_count, sizeof(uint64_t));
+    if (s_lateness_ns == NULL)
+        return -1;
+
+    return 0;
+}
+
+static void unload(void)
+{
+    free(s_nmea_data);
+    free(s_nmea_lines);
+    free(s_epochs);
+    free(s_nav);
+    free(s_lateness_ns);
+    s_nmea_data = NULL;
+    s_nmea_lines = NULL;
+    s_epochs = NULL;
+    s_nav = NULL;
+    s_lateness_ns = NULL;
+    s_nmea_size = s_nmea_count = s_nmea_capacity = 0;
+    s_epoch_count = s_epoch_capacity = 0;
+    s_nav_count = s_nav_capacity = 0;
+}
+
+/*
+ * Replay thread: a free slot of queue id, NULL if it's full. Replaying as
+ * fast as possible means as fast as the callbacks go, so that waits for
+ * the dispatcher instead, and must not be called with s_mutex held.
+ */
+static void *queue_claim(enum queue_id id)
+{
+    struct slot_header *h;
+
+    while (s_speed <= 0 && spsc_ring_full(&s_queues[id]))
+        usleep(QUEUE_FULL_POLL_US);
+    h = spsc_ring_claim(&s_queues[id]);
+
+    if (h != NULL) {
+        h->seq = s_seq_produced++;
+        h->produced_ns = now_ns();
+    }
+    return h;
+}
+
+static void queue_publish(enum queue_id id)
+{
+    spsc_ring_publish(&s_queues[id]);
+    sem_post(&s_pending);
+}
+
+static int format_queues(char *buf, size_t size)
+{
+    int len = 0;
+    int i;
+
+    for (i = 0; i < QUEUE_COUNT && len >= 0 && (size_t)len < size; i++) {
+        struct spsc_ring *ring = &s_queues[i];
+
+        len += snprintf(buf + len, size - len, "%s%s %u/%u (%u dropped)", i ? ", " : "",
+                s_queue_config[i].name, atomic_load(&ring->high_water),
+                spsc_ring_capacity(ring), atomic_load(&ring->overflows));
+    }
+    return len;
+}
+
+static void on_location(void *ctx __unused, const GpsLocation *location)
+{
+    struct location_slot *slot;
+
+    if (s_fix_interval_ms > 0 && s_last_fix > 0
+            && location->timestamp - s_last_fix < s_fix_interval_ms) {
+        s_emitted.locations_skipped++;
+        return;
+    }
+    s_last_fix = location->timestamp;
+    s_emitted.locations++;
+    slot = queue_claim(QUEUE_LOCATION);
+    if (slot != NULL) {
+        slot->location = *location;
+        queue_publish(QUEUE_LOCATION);
+    }
+
+    if (s_fix_recurrence == GPS_POSITION_RECURRENCE_SINGLE) {
+        pthread_mutex_lock(&s_mutex);
+        s_started = 0;
+        pthread_mutex_unlock(&s_mutex);
+    }
+}
+
+static void on_sv_status(void *ctx __unused, const GpsSvStatus *status)
+{
+    struct sv_status_slot *slot = queue_claim(QUEUE_SV_STATUS);
+
+    s_emitted.sv_status++;
+    if (slot != NULL) {
+        gnss_sv_from_status(&slot->sv, status);
+        queue_publish(QUEUE_SV_STATUS);
+    }
+}
+
+static const struct nmea_callbacks s_nmea_callbacks = {
+    .location = on_location,
+    .sv_status = on_sv_status,
+};
+
+static void emit(enum event_kind kind, size_t index, int measurements, int navigation)
+{
+    switch (kind) {
+    case EVENT_NMEA: {
+        const struct nmea_line *line = &s_nmea_lines[index];
+        const char *sentence = s_nmea_data + line->offset;
+        struct nmea_slot *slot = queue_claim(QUEUE_NMEA);
+
+        s_emitted.nmea++;
+        if (slot != NULL) {
+            slot->timestamp = now_utc_ms();
+            slot->length = line->length;
+            memcpy(slot->sentence, sentence, line->length + 1);
+            queue_publish(QUEUE_NMEA);
+        }
+        nmea_parser_sentence(&s_parser, sentence, line->length);
+        break;
+    }
+    case EVENT_MEASUREMENT: {
+        const struct measurement_epoch *epoch = &s_epochs[index];
+        struct measurement_slot *slot;
+
+        if (!measurements)
+            break;
+        s_emitted.measurements++;
+        slot = queue_claim(QUEUE_MEASUREMENT);
+        if (slot == NULL)
+            break;
+        gnss_measurements_copy(&slot->m, &epoch->m);
+        queue_publish(QUEUE_MEASUREMENT);
+        break;
+    }
+    case EVENT_NAVIGATION: {
+        const struct nav_record *nav = &s_nav[index];
+        struct navigation_slot *slot;
+
+        if (!navigation)
+            break;
+        s_emitted.navigation++;
+        slot = queue_claim(QUEUE_NAVIGATION);
+        if (slot == NULL)
+            break;
+        slot->message = nav->message;
+        memcpy(slot->data, nav->data, nav->message.data_length);
+        queue_publish(QUEUE_NAVIGATION);
+        break;
+    }
+    }
+}
+
+/* The earliest pending event of the three recordings, 0 if all are done */
+static int next_event(enum event_kind *kind, uint32_t *time_ms)
+{
+    int found = 0;
+
+    if (s_next_nmea < s_nmea_count) {
+        *kind = EVENT_NMEA;
+        *time_ms = s_nmea_lines[s_next_nmea].time_ms;
+        found = 1;
+    }
+    if (s_next_epoch < s_epoch_count
+            && (!found || s_epochs[s_next_epoch].time_ms < *time_ms)) {
+        *kind = EVENT_MEASUREMENT;
+        *time_ms = s_epochs[s_next_epoch].time_ms;
+        found = 1;
+    }
+    if (s_next_nav < s_nav_count && (!found || s_nav[s_next_nav].time_ms < *time_ms)) {
+        *kind = EVENT_NAVIGATION;
+        *time_ms = s_nav[s_next_nav].time_ms;
+        found = 1;
+    }
+
+    return found;
+}
+
+static void accumulate(struct replay_counts *to, const struct replay_counts *from)
+{
+    to->nmea += from->nmea;
+    to->locations += from->locations;
+    to->locations_skipped += from->locations_skipped;
+    to->sv_status += from->sv_status;
+    to->measurements += from->measurements;
+    to->navigation += from->navigation;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void rewind_replay(uint64_t now)
+{
+    s_next_nmea = s_next_epoch = s_next_nav = 0;
+    s_lateness_count = 0;
+    s_last_fix = 0;
+    s_start_ns = now;
+    nmea_parser_init(&s_parser, &s_nmea_callbacks, NULL);
+}
+
+/* Called with s_mutex held */
+static void finish_pass(uint64_t now)
+{
+    size_t n = s_lateness_count;
+
+    if (n > 0) {
+        qsort(s_lateness_ns, n, sizeof(uint64_t), compare_u64);
+        ALOGI("Replay pass %d: %zu events in %.1f ms (x%.1f), lateness us p50 %.1f p99 %.1f max %.1f",
+                s_pass + 1, n, (now - s_start_ns) / 1e6, s_speed,
+                s_lateness_ns[n / 2] / 1e3, s_lateness_ns[(n * 99) / 100] / 1e3,
+                s_lateness_ns[n - 1] / 1e3);
+    }
+
+    if (n > 0) {
+        char queues[256];
+        uint64_t dispatched = atomic_load(&s_dispatched);
+
+        format_queues(queues, sizeof(queues));
+        ALOGI("Replay pass %d: queue high water %s, queued us mean %.1f max %.1f",
+                s_pass + 1, queues,
+                dispatched ? atomic_load(&s_queued_ns) / 1e3 / dispatched : 0,
+                atomic_load(&s_max_queued_ns) / 1e3);
+    }
+
+    if (n > 0) {
+        char stats[512];
+        uint64_t epochs;
+
+        pthread_mutex_lock(&s_stats_mutex);
+        epochs = s_stats.epochs;
+        gnss_stats_format(&s_stats, stats, sizeof(stats));
+        pthread_mutex_unlock(&s_stats_mutex);
+        if (epochs > 0)
+            ALOGI("Replay pass %d: measurements %s", s_pass + 1, stats);
+    }
+
+    if (++s_pass < s_loops || s_loops == 0) {
+        rewind_replay(now);
+    } else {
+        s_finished = 1;
+        ALOGI("Replay finished after %d passes", s_pass);
+    }
+}
+
+static void report_status(int begin)
+{
+    static const GpsStatusValue s_begin[] = { GPS_STATUS_ENGINE_ON, GPS_STATUS_SESSION_BEGIN };
+    static const GpsStatusValue s_end[] = { GPS_STATUS_SESSION_END, GPS_STATUS_ENGINE_OFF };
+    int i;
+
+    for (i = 0; i < 2; i++) {
+        struct status_slot *slot = queue_claim(QUEUE_STATUS);
+
+        if (slot == NULL)
+            return;
+        slot->status = begin ? s_begin[i] : s_end[i];
+        queue_publish(QUEUE_STATUS);
+    }
+}
+
+/* Dispatch thread: make the callback for the oldest slot, 0 if there was none */
+static int dispatch_one(void)
+{
+    struct slot_header *oldest = NULL;
+    enum queue_id from = QUEUE_COUNT;
+    uint64_t queued;
+    int i;
+
+    for (i = 0; i < QUEUE_COUNT; i++) {
+        struct slot_header *h = spsc_ring_peek(&s_queues[i]);
+
+        if (h != NULL && (oldest == NULL || h->seq < oldest->seq)) {
+            oldest = h;
+            from = i;
+        }
+    }
+    if (oldest == NULL)
+        return 0;
+
+    queued = now_ns() - oldest->produced_ns;
+    atomic_fetch_add_explicit(&s_dispatched, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&s_queued_ns, queued, memory_order_relaxed);
+    if (queued > atomic_load_explicit(&s_max_queued_ns, memory_order_relaxed))
+        atomic_store_explicit(&s_max_queued_ns, queued, memory_order_relaxed);
+
+    switch (from) {
+    case QUEUE_STATUS: {
+        GpsStatus status;
+
+        memset(&status, 0, sizeof(status));
+        status.size = sizeof(status);
+        status.status = ((struct status_slot *)oldest)->status;
+        if (s_callbacks.status_cb != NULL)
+            s_callbacks.status_cb(&status);
+        break;
+    }
+    case QUEUE_NMEA: {
+        struct nmea_slot *slot = (struct nmea_slot *)oldest;
+
+        if (s_callbacks.nmea_cb != NULL)
+            s_callbacks.nmea_cb(slot->timestamp, slot->sentence, slot->length);
+        break;
+    }
+    case QUEUE_LOCATION:
+        if (s_callbacks.location_cb != NULL)
+            s_callbacks.location_cb(&((struct location_slot *)oldest)->location);
+        break;
+    case QUEUE_SV_STATUS:
+        if (s_callbacks.sv_status_cb != NULL) {
+            gnss_sv_to_status(&s_dispatch_sv, &((struct sv_status_slot *)oldest)->sv);
+            s_callbacks.sv_status_cb(&s_dispatch_sv);
+        }
+        break;
+    case QUEUE_MEASUREMENT: {
+        struct measurement_slot *slot = (struct measurement_slot *)oldest;
+        GpsMeasurementCallbacks *cb;
+
+        pthread_mutex_lock(&s_mutex);
+        cb = s_measurement_cb;
+        pthread_mutex_unlock(&s_mutex);
+        if (cb != NULL && cb->measurement_callback != NULL) {
+            pthread_mutex_lock(&s_stats_mutex);
+            gnss_stats_update(&s_stats, &slot->m);
+            pthread_mutex_unlock(&s_stats_mutex);
+            gnss_measurements_to_data(&s_dispatch_data, &slot->m);
+            cb->measurement_callback(&s_dispatch_data);
+        }
+        break;
+    }
+    case QUEUE_NAVIGATION: {
+        struct navigation_slot *slot = (struct navigation_slot *)oldest;
+        GpsNavigationMessageCallbacks *cb;
+
+        pthread_mutex_lock(&s_mutex);
+        cb = s_navigation_cb;
+        pthread_mutex_unlock(&s_mutex);
+        slot->message.data = slot->data;
+        if (cb != NULL && cb->navigation_message_callback != NULL)
+            cb->navigation_message_callback(&slot->message);
+        break;
+    }
+    case QUEUE_COUNT:
+        break;
+    }
+
+    spsc_ring_release(&s_queues[from]);
+    return 1;
+}
+
+static void dispatch_thread(void *arg __unused)
+{
+    for (;;) {
+        while (sem_wait(&s_pending) < 0 && errno == EINTR)
+            ;
+        if (!dispatch_one() && atomic_load(&s_dispatch_quit))
+            break;
+    }
+
+    pthread_mutex_lock(&s_mutex);
+    s_dispatch_running = 0;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static void wait_until(uint64_t due_ns)
+{
+    struct timespec ts;
+
+    ts.tv_sec = due_ns / 1000000000ULL;
+    ts.tv_nsec = due_ns % 1000000000ULL;
+    pthread_cond_timedwait(&s_cond, &s_mutex, &ts);
+}
+
+static uint32_t capabilities(void)
+{
+    uint32_t caps = GPS_CAPABILITY_SCHEDULING | GPS_CAPABILITY_SINGLE_SHOT;
+
+    if (s_epoch_count > 0)
+        caps |= GPS_CAPABILITY_MEASUREMENTS;
+    if (s_nav_count > 0)
+        caps |= GPS_CAPABILITY_NAV_MESSAGES;
+    return caps;
+}
+
+static void replay_thread(void *arg __unused)
+{
+    if (s_callbacks.set_capabilities_cb != NULL)
+        s_callbacks.set_capabilities_cb(capabilities());
+
+    pthread_mutex_lock(&s_mutex);
+    rewind_replay(now_ns());
+    s_paused_ns = s_start_ns;
+    while (!s_quit) {
+        int measurements, navigation;
+        enum event_kind kind;
+        uint32_t time_ms;
+        uint64_t now = now_ns();
+        uint64_t due;
+        size_t index;
+
+        if (s_started != s_session) {
+            int begin = s_session = s_started;
+
+            /* Time stopped doesn't count against the recording */
+            if (begin)
+                s_start_ns += now - s_paused_ns;
+            else
+                s_paused_ns = now;
+            /*
+             * queue_claim() waits for the dispatcher when replaying at full
+             * speed, and the dispatcher takes s_mutex for the measurement
+             * and navigation callbacks.
+             */
+            pthread_mutex_unlock(&s_mutex);
+            report_status(begin);
+            pthread_mutex_lock(&s_mutex);
+            continue;
+        }
+        if (!s_session || s_finished) {
+            pthread_cond_wait(&s_cond, &s_mutex);
+            continue;
+        }
+        if (!next_event(&kind, &time_ms)) {
+            pthread_mutex_unlock(&s_mutex);
+            nmea_parser_flush(&s_parser);
+            pthread_mutex_lock(&s_mutex);
+            accumulate(&s_totals, &s_emitted);
+            memset(&s_emitted, 0, sizeof(s_emitted));
+            finish_pass(now_ns());
+            continue;
+        }
+
+        due = s_speed > 0 ? s_start_ns + (uint64_t)(time_ms * 1e6 / s_speed) : now;
+        if (due > now) {
+            wait_until(due);
+            continue;
+        }
+
+        index = kind == EVENT_NMEA ? s_next_nmea++
+                : kind == EVENT_MEASUREMENT ? s_next_epoch++ : s_next_nav++;
+        measurements = s_measurement_cb != NULL;
+        navigation = s_navigation_cb != NULL;
+        s_fix_recurrence = s_recurrence;
+        s_fix_interval_ms = s_min_interval_ms;
+        pthread_mutex_unlock(&s_mutex);
+
+        emit(kind, index, measurements, navigation);
+        s_lateness_ns[s_lateness_count++] = now_ns() - due;
+
+        pthread_mutex_lock(&s_mutex);
+        accumulate(&s_totals, &s_emitted);
+        memset(&s_emitted, 0, sizeof(s_emitted));
+    }
+
+    s_replay_running = 0;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static void destroy_queues(void)
+{
+    int i;
+
+    for (i = 0; i < QUEUE_COUNT; i++)
+        spsc_ring_destroy(&s_queues[i]);
+}
+
+static int create_queues(void)
+{
+    int i;
+
+    for (i = 0; i < QUEUE_COUNT; i++) {
+        if (spsc_ring_init(&s_queues[i], s_queue_config[i].slots,
+                s_queue_config[i].slot_size) < 0) {
+            ALOGE("Out of memory for the %s queue", s_queue_config[i].name);
+            destroy_queues();
+            return -1;
+        }
+    }
+    if (sem_init(&s_pending, 0, 0) < 0) {
+        destroy_queues();
+        return -1;
+    }
+    atomic_store(&s_dispatch_quit, 0);
+    atomic_store(&s_dispatched, 0);
+    atomic_store(&s_queued_ns, 0);
+    atomic_store(&s_max_queued_ns, 0);
+
+    return 0;
+}
+
+static int replay_init(GpsCallbacks *callbacks)
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_lock(&s_mutex);
+    if (s_initialized) {
+        pthread_mutex_unlock(&s_mutex);
+        return 0;
+    }
+    if (callbacks->create_thread_cb == NULL || load_config() < 0 || create_queues() < 0) {
+        unload();
+        pthread_mutex_unlock(&s_mutex);
+        return -1;
+    }
+
+    s_callbacks = *callbacks;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&s_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    s_quit = s_started = s_session = s_finished = s_pass = 0;
+    memset(&s_totals, 0, sizeof(s_totals));
+    memset(&s_emitted, 0, sizeof(s_emitted));
+    s_seq_produced = 0;
+    pthread_mutex_lock(&s_stats_mutex);
+    gnss_stats_reset(&s_stats);
+    pthread_mutex_unlock(&s_stats_mutex);
+    s_replay_running = s_dispatch_running = 1;
+    s_initialized = 1;
+    pthread_mutex_unlock(&s_mutex);
+
+    /* Detached when they come from the framework, cleanup waits on s_cond */
+    s_callbacks.create_thread_cb("gps-dispatch", dispatch_thread, NULL);
+    s_callbacks.create_thread_cb("gps-replay", replay_thread, NULL);
+    return 0;
+}
+
+static int replay_start(void)
+{
+    pthread_mutex_lock(&s_mutex);
+    s_started = 1;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+    return 0;
+}
+
+static int replay_stop(void)
+{
+    pthread_mutex_lock(&s_mutex);
+    s_started = 0;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+    return 0;
+}
+
+static void replay_cleanup(void)
+{
+    pthread_mutex_lock(&s_mutex);
+    if (!s_initialized) {
+        pthread_mutex_unlock(&s_mutex);
+        return;
+    }
+    s_quit = 1;
+    pthread_cond_broadcast(&s_cond);
+    while (s_replay_running)
+        pthread_cond_wait(&s_cond, &s_mutex);
+
+    /* The dispatcher drains what the replay thread left, then sees this */
+    atomic_store(&s_dispatch_quit, 1);
+    sem_post(&s_pending);
+    while (s_dispatch_running)
+        pthread_cond_wait(&s_cond, &s_mutex);
+
+    sem_destroy(&s_pending);
+    destroy_queues();
+    pthread_cond_destroy(&s_cond);
+    unload();
+    s_initialized = 0;
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static int replay_inject_time(GpsUtcTime time __unused, int64_t time_reference __unused,
+        int uncertainty __unused)
+{
+    return 0;
+}
+
+static int replay_inject_location(double latitude __unused, double longitude __unused,
+        float accuracy __unused)
+{
+    return 0;
+}
+
+static void replay_delete_aiding_data(GpsAidingData flags __unused)
+{
+}
+
+static int replay_set_position_mode(GpsPositionMode mode __unused,
+        GpsPositionRecurrence recurrence, uint32_t min_interval,
+        uint32_t preferred_accuracy __unused, uint32_t preferred_time __unused)
+{
+    pthread_mutex_lock(&s_mutex);
+    s_recurrence = recurrence;
+    s_min_interval_ms = min_interval;
+    pthread_mutex_unlock(&s_mutex);
+    return 0;
+}
+
+static int measurement_init(GpsMeasurementCallbacks *callbacks)
+{
+    int ret = GPS_MEASUREMENT_OPERATION_SUCCESS;
+
+    pthread_mutex_lock(&s_mutex);
+    if (s_measurement_cb != NULL)
+        ret = GPS_MEASUREMENT_ERROR_ALREADY_INIT;
+    else
+        s_measurement_cb = callbacks;
+    pthread_mutex_unlock(&s_mutex);
+    return ret;
+}
+
+static void measurement_close(void)
+{
+    pthread_mutex_lock(&s_mutex);
+    s_measurement_cb = NULL;
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static int navigation_init(GpsNavigationMessageCallbacks *callbacks)
+{
+    int ret = GPS_NAVIGATION_MESSAGE_OPERATION_SUCCESS;
+
+    pthread_mutex_lock(&s_mutex);
+    if (s_navigation_cb != NULL)
+        ret = GPS_NAVIGATION_MESSAGE_ERROR_ALREADY_INIT;
+    else
+        s_navigation_cb = callbacks;
+    pthread_mutex_unlock(&s_mutex);
+    return ret;
+}
+
+static void navigation_close(void)
+{
+    pthread_mutex_lock(&s_mutex);
+    s_navigation_cb = NULL;
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static size_t get_internal_state(char *buffer, size_t size)
+{
+    struct replay_counts totals;
+    int pass, finished;
+    int len;
+
+    pthread_mutex_lock(&s_mutex);
+    totals = s_totals;
+    pass = s_pass;
+    finished = s_finished;
+    pthread_mutex_unlock(&s_mutex);
+
+    len = snprintf(buffer, size, "pass %d%s, x%.1f: %" PRIu64 " nmea, %" PRIu64
+            " locations (%" PRIu64 " skipped), %" PRIu64 " sv status, %" PRIu64
+            " measurements, %" PRIu64 " navigation messages\nqueue high water ",
+            pass + !finished, finished ? " (finished)" : "", s_speed, totals.nmea,
+            totals.locations, totals.locations_skipped, totals.sv_status,
+            totals.measurements, totals.navigation);
+    if (len >= 0 && (size_t)len < size)
+        len += format_queues(buffer + len, size - len);
+    if (len >= 0 && (size_t)len < size) {
+        uint64_t dispatched = atomic_load(&s_dispatched);
+
+        len += snprintf(buffer + len, size - len, "\n%" PRIu64
+                " dispatched, queued us mean %.1f max %.1f\n", dispatched,
+                dispatched ? atomic_load(&s_queued_ns) / 1e3 / dispatched : 0,
+                atomic_load(&s_max_queued_ns) / 1e3);
+    }
+    if (len >= 0 && (size_t)len < size) {
+        pthread_mutex_lock(&s_stats_mutex);
+        len += snprintf(buffer + len, size - len, "measurements ");
+        if (len >= 0 && (size_t)len < size)
+            len += gnss_stats_format(&s_stats, buffer + len, size - len);
+        pthread_mutex_unlock(&s_stats_mutex);
+        if (len >= 0 && (size_t)len < size)
+            len += snprintf(buffer + len, size - len, "\n");
+    }
+    return len < 0 ? 0 : (size_t)len < size ? (size_t)len : size - 1;
+}
+
+static const GpsMeasurementInterface s_measurement_interface = {
+    .size = sizeof(GpsMeasurementInterface),
+    .init = measurement_init,
+    .close = measurement_close,
+};
+
+static const GpsNavigationMessageInterface s_navigation_interface = {
+    .size = sizeof(GpsNavigationMessageInterface),
+    .init = navigation_init,
+    .close = navigation_close,
+};
+
+static const GpsDebugInterface s_debug_interface = {
+    .size = sizeof(GpsDebugInterface),
+    .get_internal_state = get_internal_state,
+};
+
+static const void *replay_get_extension(const char *name)
+{
+    if (strcmp(name, GPS_MEASUREMENT_INTERFACE) == 0)
+        return &s_measurement_interface;
+    if (strcmp(name, GPS_NAVIGATION_MESSAGE_INTERFACE) == 0)
+        return &s_navigation_interface;
+    if (strcmp(name, GPS_DEBUG_INTERFACE) == 0)
+        return &s_debug_interface;
+    return NULL;
+}
+
+static const GpsInterface s_interface = {
+    .size = sizeof(GpsInterface),
+    .init = replay_init,
+    .start = replay_start,
+    .stop = replay_stop,
+    .cleanup = replay_cleanup,
+    .inject_time = replay_inject_time,
+    .inject_location = replay_inject_location,
+    .delete_aiding_data = replay_delete_aiding_data,
+    .set_position_mode = replay_set_position_mode,
+    .get_extension = replay_get_extension,
+};
+
+static const GpsInterface *get_gps_interface(struct gps_device_t *dev __unused)
+{
+    return &s_interface;
+}
+
+static int close_gps(struct hw_device_t *device)
+{
+    free(device);
+    return 0;
+}
+
+static int open_gps(const struct hw_module_t *module, const char *name __unused,
+        struct hw_device_t **device)
+{
+    struct gps_device_t *dev = calloc(1, sizeof(*dev));
+
+    if (dev == NULL)
+        return -ENOMEM;
+
+    dev->common.tag = HARDWARE_DEVICE_TAG;
+    dev->common.version = 0;
+    dev->common.module = (struct hw_module_t *)module;
+    dev->common.close = close_gps;
+    dev->get_gps_interface = get_gps_interface;
+    *device = &dev->common;
+
+    return 0;
+}
+
+static struct hw_module_methods_t gps_module_methods = {
+    .open = open_gps,
+};
+
+struct hw_module_t HAL_MODULE_INFO_SYM = {
+    .tag = HARDWARE_MODULE_TAG,
+    .module_api_version = 1,
+    .hal_api_version = 0,
+    .id = GPS_HARDWARE_MODULE_ID,
+    .name = "Recorded NMEA and raw data replay",
+    .author = "The CyanogenMod Project",
+    .methods = &gps_module_methods,
+};
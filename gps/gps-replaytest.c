@@ -0,0 +1,339 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host driver that loads a GPS HAL (normally gps.replay) the way the
+ * framework does and runs a session through GpsInterface, counting
+ * callbacks and measuring the gaps between fixes.
+ *
+ * usage: gps-replaytest -l <gps hal .so> [-c config] [-t seconds]
+ *                       [-i min_interval_ms] [-1] [-d callback_delay_us]
+ *
+ * -c sets GPS_REPLAY_CONF for gps.replay. -1 asks for a single shot fix,
+ * the run then ends with the session. -d makes every callback take that
+ * long, like a busy framework would.
+ */
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <hardware/gps.h>
+
+#define MAX_FIX_GAPS    (1 << 20)
+
+struct thread_start {
+    void (*start)(void *);
+    void *arg;
+};
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+static int s_session_ended;
+
+static unsigned s_callback_delay_us;
+
+static unsigned long s_locations;
+static unsigned long s_sv_status;
+static unsigned long s_nmea;
+static unsigned long s_nmea_bytes;
+static unsigned long s_measurements;
+static unsigned long s_measurement_svs;
+static unsigned long s_navigation;
+static unsigned long s_status[GPS_STATUS_ENGINE_OFF + 1];
+static uint32_t s_capabilities;
+
+static uint64_t s_last_fix_ns;
+static uint64_t *s_fix_gaps_ns;
+static size_t s_fix_gap_count;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void consume(void)
+{
+    if (s_callback_delay_us > 0)
+        usleep(s_callback_delay_us);
+}
+
+static void location_cb(GpsLocation *location __unused)
+{
+    uint64_t now = now_ns();
+
+    if (s_last_fix_ns > 0 && s_fix_gap_count < MAX_FIX_GAPS)
+        s_fix_gaps_ns[s_fix_gap_count++] = now - s_last_fix_ns;
+    s_last_fix_ns = now;
+    s_locations++;
+    consume();
+}
+
+static void status_cb(GpsStatus *status)
+{
+    if (status->status <= GPS_STATUS_ENGINE_OFF)
+        s_status[status->status]++;
+    if (status->status == GPS_STATUS_SESSION_END) {
+        pthread_mutex_lock(&s_mutex);
+        s_session_ended = 1;
+        pthread_cond_broadcast(&s_cond);
+        pthread_mutex_unlock(&s_mutex);
+    }
+}
+
+static void sv_status_cb(GpsSvStatus *sv_info __unused)
+{
+    s_sv_status++;
+    consume();
+}
+
+static void nmea_cb(GpsUtcTime timestamp __unused, const char *nmea __unused, int length)
+{
+    s_nmea++;
+    s_nmea_bytes += length;
+    consume();
+}
+
+static void set_capabilities_cb(uint32_t capabilities)
+{
+    s_capabilities = capabilities;
+}
+
+static void acquire_wakelock_cb(void)
+{
+}
+
+static void release_wakelock_cb(void)
+{
+}
+
+static void request_utc_time_cb(void)
+{
+}
+
+static void *thread_trampoline(void *arg)
+{
+    struct thread_start start = *(struct thread_start *)arg;
+
+    free(arg);
+    start.start(start.arg);
+    return NULL;
+}
+
+/* Detached, like the framework's Java threads */
+static pthread_t create_thread_cb(const char *name __unused, void (*start)(void *), void *arg)
+{
+    struct thread_start *ts = malloc(sizeof(*ts));
+    pthread_attr_t attr;
+    pthread_t thread = 0;
+
+    if (ts == NULL)
+        return 0;
+    ts->start = start;
+    ts->arg = arg;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, thread_trampoline, ts) != 0) {
+        free(ts);
+        thread = 0;
+    }
+    pthread_attr_destroy(&attr);
+    return thread;
+}
+
+static void measurement_cb(GpsData *data)
+{
+    s_measurements++;
+    s_measurement_svs += data->measurement_count;
+    consume();
+}
+
+static void navigation_message_cb(GpsNavigationMessage *message __unused)
+{
+    s_navigation++;
+    consume();
+}
+
+static GpsCallbacks s_callbacks = {
+    .size = sizeof(GpsCallbacks),
+    .location_cb = location_cb,
+    .status_cb = status_cb,
+    .sv_status_cb = sv_status_cb,
+    .nmea_cb = nmea_cb,
+    .set_capabilities_cb = set_capabilities_cb,
+    .acquire_wakelock_cb = acquire_wakelock_cb,
+    .release_wakelock_cb = release_wakelock_cb,
+    .create_thread_cb = create_thread_cb,
+    .request_utc_time_cb = request_utc_time_cb,
+};
+
+static GpsMeasurementCallbacks s_measurement_callbacks = {
+    .size = sizeof(GpsMeasurementCallbacks),
+    .measurement_callback = measurement_cb,
+};
+
+static GpsNavigationMessageCallbacks s_navigation_callbacks = {
+    .size = sizeof(GpsNavigationMessageCallbacks),
+    .navigation_message_callback = navigation_message_cb,
+};
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void report(uint64_t elapsed_ns, const GpsDebugInterface *debug)
+{
+    double seconds = elapsed_ns / 1e9;
+    size_t n = s_fix_gap_count;
+    char state[1024];
+
+    printf("capabilities 0x%x, %.1f s, sessions begun %lu ended %lu\n", s_capabilities,
+            seconds, s_status[GPS_STATUS_SESSION_BEGIN], s_status[GPS_STATUS_SESSION_END]);
+    printf("locations     %8lu  %8.1f/s\n", s_locations, s_locations / seconds);
+    printf("sv status     %8lu  %8.1f/s\n", s_sv_status, s_sv_status / seconds);
+    printf("nmea          %8lu  %8.1f/s  %.1f KB/s\n", s_nmea, s_nmea / seconds,
+            s_nmea_bytes / seconds / 1024);
+    printf("measurements  %8lu  %8.1f/s  %.1f SVs each\n", s_measurements,
+            s_measurements / seconds,
+            s_measurements ? (double)s_measurement_svs / s_measurements : 0);
+    printf("navigation    %8lu  %8.1f/s\n", s_navigation, s_navigation / seconds);
+
+    if (n > 0) {
+        qsort(s_fix_gaps_ns, n, sizeof(uint64_t), compare_u64);
+        printf("fix gaps ms: p50 %.1f p99 %.1f max %.1f\n", s_fix_gaps_ns[n / 2] / 1e6,
+                s_fix_gaps_ns[(n * 99) / 100] / 1e6, s_fix_gaps_ns[n - 1] / 1e6);
+    }
+
+    if (debug != NULL && debug->get_internal_state(state, sizeof(state)) > 0)
+        printf("hal: %s", state);
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s -l <gps hal .so> [-c config] [-t seconds]\n"
+            "          [-i min_interval_ms] [-1] [-d callback_delay_us]\n", argv0);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *lib = NULL;
+    unsigned seconds = 10;
+    uint32_t min_interval = 0;
+    GpsPositionRecurrence recurrence = GPS_POSITION_RECURRENCE_PERIODIC;
+    const GpsInterface *gps;
+    const GpsMeasurementInterface *measurement;
+    const GpsNavigationMessageInterface *navigation;
+    const GpsDebugInterface *debug;
+    struct hw_module_t *module;
+    struct hw_device_t *device;
+    struct timespec deadline;
+    uint64_t start;
+    void *handle;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "l:c:t:i:1d:")) != -1) {
+        switch (opt) {
+        case 'l':
+            lib = optarg;
+            break;
+        case 'c':
+            setenv("GPS_REPLAY_CONF", optarg, 1);
+            break;
+        case 't':
+            seconds = strtoul(optarg, NULL, 0);
+            break;
+        case 'i':
+            min_interval = strtoul(optarg, NULL, 0);
+            break;
+        case '1':
+            recurrence = GPS_POSITION_RECURRENCE_SINGLE;
+            break;
+        case 'd':
+            s_callback_delay_us = strtoul(optarg, NULL, 0);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (lib == NULL)
+        usage(argv[0]);
+
+    s_fix_gaps_ns = calloc(MAX_FIX_GAPS, sizeof(uint64_t));
+    if (s_fix_gaps_ns == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    handle = dlopen(lib, RTLD_NOW);
+    if (handle == NULL) {
+        fprintf(stderr, "dlopen %s: %s\n", lib, dlerror());
+        return 1;
+    }
+    module = (struct hw_module_t *)dlsym(handle, HAL_MODULE_INFO_SYM_AS_STR);
+    if (module == NULL || module->methods->open(module, GPS_HARDWARE_MODULE_ID, &device) != 0) {
+        fprintf(stderr, "%s is not a GPS HAL\n", lib);
+        return 1;
+    }
+    printf("gps hal: %s\n", module->name);
+
+    gps = ((struct gps_device_t *)device)->get_gps_interface((struct gps_device_t *)device);
+    if (gps == NULL || gps->init(&s_callbacks) != 0) {
+        fprintf(stderr, "GpsInterface init failed\n");
+        return 1;
+    }
+    measurement = gps->get_extension(GPS_MEASUREMENT_INTERFACE);
+    if (measurement != NULL)
+        measurement->init(&s_measurement_callbacks);
+    navigation = gps->get_extension(GPS_NAVIGATION_MESSAGE_INTERFACE);
+    if (navigation != NULL)
+        navigation->init(&s_navigation_callbacks);
+    debug = gps->get_extension(GPS_DEBUG_INTERFACE);
+
+    gps->set_position_mode(GPS_POSITION_MODE_STANDALONE, recurrence, min_interval, 0, 0);
+    start = now_ns();
+    gps->start();
+
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += seconds;
+    pthread_mutex_lock(&s_mutex);
+    while (!s_session_ended
+            && pthread_cond_timedwait(&s_cond, &s_mutex, &deadline) == 0)
+        ;
+    pthread_mutex_unlock(&s_mutex);
+
+    gps->stop();
+    report(now_ns() - start, debug);
+
+    if (measurement != NULL)
+        measurement->close();
+    if (navigation != NULL)
+        navigation->close();
+    gps->cleanup();
+    device->close(device);
+
+    return 0;
+}
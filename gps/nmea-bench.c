@@ -0,0 +1,394 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host benchmark for the NMEA parser.
+ *
+ * Usage: nmea-bench [options] [capture...]
+ *   -n <passes>  passes over the input (default 3, the best one counts)
+ *   -c <bytes>   feed size, like the UART reads (default 64)
+ *   -g <hours>   synthesize this many hours of 10 Hz output instead
+ *   -o <file>    write the synthesized capture to file
+ *   -b           also time a strtok/strtod baseline
+ *   -t           check the parser on known tricky input and exit
+ *
+ * Captures are raw receiver output (e.g. from the HAL's NMEA log). The
+ * cost is also given as the share of one CPU needed to keep up with a
+ * 921600 baud port running flat out.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "nmea.h"
+
+#define UART_BYTES_PER_SEC  (921600 / 10)
+
+struct buffer {
+    char *data;
+    size_t len;
+    size_t size;
+};
+
+static void buffer_append(struct buffer *b, const char *data, size_t len)
+{
+    if (b->len + len > b->size) {
+        b->size = (b->len + len) * 2;
+        b->data = realloc(b->data, b->size);
+        if (b->data == NULL) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static int load_file(struct buffer *b, const char *path)
+{
+    char chunk[65536];
+    size_t n;
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+        buffer_append(b, chunk, n);
+    fclose(f);
+
+    return 0;
+}
+
+/* A receiver driving in circles at 10 Hz: GGA, GSA, GSVs, RMC per epoch */
+static void synthesize(struct buffer *b, double hours)
+{
+    long epochs = (long)(hours * 3600 * 10);
+    GpsUtcTime t0 = 1451606400000LL; /* 2016-01-01 */
+    GpsLocation location;
+    GpsSvStatus sv;
+    char line[NMEA_MAX_SENTENCE];
+    long e;
+    int i, len;
+
+    memset(&sv, 0, sizeof(sv));
+    sv.num_svs = 11;
+    for (i = 0; i < sv.num_svs; i++) {
+        sv.sv_list[i].size = sizeof(GpsSvInfo);
+        sv.sv_list[i].prn = 2 + i * 3;
+        if (i < 8)
+            sv.used_in_fix_mask |= 1U << (sv.sv_list[i].prn - 1);
+    }
+
+    memset(&location, 0, sizeof(location));
+    location.size = sizeof(location);
+    for (e = 0; e < epochs; e++) {
+        double a = e * 0.0005;
+
+        location.timestamp = t0 + e * 100;
+        location.latitude = 37.4 + 0.01 * sin(a);
+        location.longitude = -122.08 + 0.01 * cos(a);
+        location.altitude = 30 + 5 * sin(a * 7);
+        location.speed = 13.9f;
+        location.bearing = (float)fmod(a * 57.29578 + 90, 360);
+
+        for (i = 0; i < sv.num_svs; i++) {
+            sv.sv_list[i].elevation = (float)((i * 17 + e / 600) % 90);
+            sv.sv_list[i].azimuth = (float)((i * 33 + e / 300) % 360);
+            sv.sv_list[i].snr = (float)(20 + (i * 7 + e / 50) % 25);
+        }
+
+        len = nmea_format_gga(line, sizeof(line), &location, 8, 0.9f);
+        buffer_append(b, line, len);
+        len = nmea_format_gsa(line, sizeof(line), &sv, 0.9f);
+        buffer_append(b, line, len);
+        for (i = 0; i < nmea_gsv_count(&sv); i++) {
+            len = nmea_format_gsv(line, sizeof(line), &sv, i);
+            buffer_append(b, line, len);
+        }
+        len = nmea_format_rmc(line, sizeof(line), &location);
+        buffer_append(b, line, len);
+    }
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void on_location(void *ctx, const GpsLocation *location)
+{
+    /* Keep the compiler from dropping the work */
+    *(double *)ctx += location->latitude;
+}
+
+static void on_sv_status(void *ctx, const GpsSvStatus *status)
+{
+    *(double *)ctx += status->num_svs;
+}
+
+static const struct nmea_callbacks s_callbacks = {
+    .location = on_location,
+    .sv_status = on_sv_status,
+};
+
+static uint64_t run_parser(const struct buffer *b, size_t chunk, struct nmea_stats *stats)
+{
+    struct nmea_parser parser;
+    double sink = 0;
+    uint64_t start = now_ns();
+    size_t off;
+
+    nmea_parser_init(&parser, &s_callbacks, &sink);
+    for (off = 0; off < b->len; off += chunk)
+        nmea_parser_feed(&parser, b->data + off, b->len - off < chunk ? b->len - off : chunk);
+    nmea_parser_flush(&parser);
+
+    *stats = parser.stats;
+    return now_ns() - start + (sink == 12345.678 ? 1 : 0);
+}
+
+/* The SV reports of a check, as "n=<count>: <prn>..." each */
+static void on_check_sv_status(void *ctx, const GpsSvStatus *status)
+{
+    char *out = ctx;
+    int i;
+
+    sprintf(out + strlen(out), "%sn=%d:", *out ? " | " : "", status->num_svs);
+    for (i = 0; i < status->num_svs; i++)
+        sprintf(out + strlen(out), " %d", status->sv_list[i].prn);
+}
+
+static const struct nmea_callbacks s_check_callbacks = {
+    .sv_status = on_check_sv_status,
+};
+
+static const struct {
+    const char *name;
+    const char *input;
+    const char *expected;
+} s_checks[] = {
+    { "gsv talkers merged",
+        "$GPGSV,1,1,02,01,40,100,30,02,35,200,25\r\n"
+        "$GLGSV,1,1,01,65,20,300,20\r\n"
+        "$GPGGA,120000.00,,,,,0,00,,,,,,,\r\n",
+        "n=3: 1 2 65" },
+    { "gsv last message lost",
+        "$GPGSV,2,1,05,01,40,100,30,02,35,200,25,03,30,50,20,04,25,10,15\r\n"
+        "$GPGGA,120000.00,,,,,0,00,,,,,,,\r\n"
+        "$GPGSV,1,1,02,10,40,100,30,11,35,200,25\r\n"
+        "$GPGGA,120001.00,,,,,0,00,,,,,,,\r\n",
+        "n=2: 10 11" },
+    { "gsv restarted",
+        "$GPGSV,2,1,05,01,40,100,30,02,35,200,25,03,30,50,20,04,25,10,15\r\n"
+        "$GPGSV,1,1,02,10,40,100,30,11,35,200,25\r\n"
+        "$GPGGA,120001.00,,,,,0,00,,,,,,,\r\n",
+        "n=2: 10 11" },
+    { "gsv signal id",
+        "$GPGSV,1,1,02,12,40,100,30,13,35,200,25,1\r\n"
+        "$GPGGA,120000.00,,,,,0,00,,,,,,,\r\n",
+        "n=2: 12 13" },
+};
+
+static int run_checks(void)
+{
+    int failed = 0;
+    size_t i;
+
+    for (i = 0; i < sizeof(s_checks) / sizeof(s_checks[0]); i++) {
+        struct nmea_parser parser;
+        char out[512] = "";
+
+        nmea_parser_init(&parser, &s_check_callbacks, out);
+        nmea_parser_feed(&parser, s_checks[i].input, strlen(s_checks[i].input));
+        nmea_parser_flush(&parser);
+        if (strcmp(out, s_checks[i].expected) != 0) {
+            printf("%s: FAILED, got \"%s\", expected \"%s\"\n", s_checks[i].name, out,
+                    s_checks[i].expected);
+            failed++;
+        } else {
+            printf("%s: ok\n", s_checks[i].name);
+        }
+    }
+    return failed ? 1 : 0;
+}
+
+/*
+ * What consumers of gps_nmea_callback typically do: copy the line,
+ * strtok it, strtod every number. Counts fixes only.
+ */
+static uint64_t run_baseline(const struct buffer *b, uint64_t *fixes)
+{
+    uint64_t start = now_ns();
+    const char *p = b->data;
+    const char *end = b->data + b->len;
+    double sink = 0;
+
+    *fixes = 0;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        size_t len = (eol ? eol : end) - p;
+        char line[NMEA_MAX_SENTENCE + 1];
+        char *save, *field, *star;
+        char *fields[NMEA_MAX_FIELDS];
+        unsigned sum = 0;
+        int n = 0;
+        size_t i;
+
+        if (len > 0 && len <= NMEA_MAX_SENTENCE && p[0] == '$') {
+            memcpy(line, p, len);
+            line[len] = '\0';
+            star = strchr(line, '*');
+            for (i = 1; line + i < star; i++)
+                sum ^= (unsigned char)line[i];
+            if (star && strtoul(star + 1, NULL, 16) == sum) {
+                *star = '\0';
+                for (field = strtok_r(line + 1, ",", &save); field && n < NMEA_MAX_FIELDS;
+                        field = strtok_r(NULL, ",", &save))
+                    fields[n++] = field;
+                if (n > 9 && strcmp(fields[0] + 2, "RMC") == 0 && fields[2][0] == 'A') {
+                    int hh, mm, ss;
+
+                    sscanf(fields[1], "%2d%2d%2d", &hh, &mm, &ss);
+                    sink += strtod(fields[3], NULL) + strtod(fields[5], NULL)
+                            + strtod(fields[7], NULL) + strtod(fields[8], NULL) + hh;
+                    (*fixes)++;
+                } else {
+                    for (i = 1; i < (size_t)n; i++)
+                        sink += strtod(fields[i], NULL);
+                }
+            }
+        }
+        p += len + 1;
+    }
+
+    return now_ns() - start + (sink == 12345.678 ? 1 : 0);
+}
+
+static void report(const char *name, uint64_t ns, size_t bytes, uint64_t sentences)
+{
+    double seconds = ns / 1e9;
+
+    printf("%-9s %8.1f ms  %7.1f MB/s  %6.1f ns/sentence  %.3f%% CPU at 921600 baud\n",
+            name, ns / 1e6, bytes / seconds / 1e6,
+            sentences ? (double)ns / sentences : 0,
+            100.0 * UART_BYTES_PER_SEC * seconds / bytes);
+}
+
+int main(int argc, char **argv)
+{
+    struct buffer input = { NULL, 0, 0 };
+    struct nmea_stats stats;
+    int passes = 3;
+    size_t chunk = 64;
+    double hours = 0;
+    const char *out = NULL;
+    int baseline = 0;
+    uint64_t best = 0;
+    int opt, i;
+
+    while ((opt = getopt(argc, argv, "n:c:g:o:bt")) != -1) {
+        switch (opt) {
+        case 'n':
+            passes = atoi(optarg);
+            break;
+        case 'c':
+            chunk = strtoul(optarg, NULL, 0);
+            break;
+        case 'g':
+            hours = atof(optarg);
+            break;
+        case 'o':
+            out = optarg;
+            break;
+        case 'b':
+            baseline = 1;
+            break;
+        case 't':
+            return run_checks();
+        default:
+            fprintf(stderr, "usage: %s [-n passes] [-c bytes] [-g hours [-o file]] [-b] [-t]"
+                    " [capture...]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (passes < 1 || chunk < 1) {
+        fprintf(stderr, "bad -n or -c\n");
+        return 1;
+    }
+
+    if (hours > 0)
+        synthesize(&input, hours);
+    for (i = optind; i < argc; i++)
+        if (load_file(&input, argv[i]) < 0)
+            return 1;
+    if (input.len == 0) {
+        fprintf(stderr, "no input, give captures or -g\n");
+        return 1;
+    }
+
+    if (out != NULL) {
+        FILE *f = fopen(out, "wb");
+
+        if (f == NULL || fwrite(input.data, 1, input.len, f) != input.len) {
+            fprintf(stderr, "%s: %s\n", out, strerror(errno));
+            return 1;
+        }
+        fclose(f);
+    }
+
+    for (i = 0; i < passes; i++) {
+        uint64_t ns = run_parser(&input, chunk, &stats);
+
+        if (best == 0 || ns < best)
+            best = ns;
+    }
+
+    printf("%zu bytes (%.0f s at 921600 baud), %llu sentences, %llu fixes,"
+            " %llu SV reports, %llu bad checksums, %llu overflows, %llu ignored\n",
+            input.len, input.len / (double)UART_BYTES_PER_SEC,
+            (unsigned long long)stats.sentences, (unsigned long long)stats.locations,
+            (unsigned long long)stats.sv_reports, (unsigned long long)stats.bad_checksum,
+            (unsigned long long)stats.overflow, (unsigned long long)stats.ignored);
+    report("nmea", best, input.len, stats.sentences);
+
+    if (baseline) {
+        uint64_t fixes = 0;
+
+        best = 0;
+        for (i = 0; i < passes; i++) {
+            uint64_t ns = run_baseline(&input, &fixes);
+
+            if (best == 0 || ns < best)
+                best = ns;
+        }
+        report("baseline", best, input.len, stats.sentences);
+        if (fixes != stats.locations)
+            printf("baseline found %llu fixes\n", (unsigned long long)fixes);
+    }
+
+    free(input.data);
+    return 0;
+}
@@ -0,0 +1,748 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Streaming NMEA 0183 parser and generator.
+ *
+ * At 921600 baud and 10 Hz the receiver sends a few hundred sentences a
+ * second, so the parser avoids the usual strtok/strtod/sscanf round: the
+ * checksum and the field split work on eight characters at a time (plain
+ * 64-bit words, which is as wide as it gets without NEON intrinsics and
+ * keeps the code identical on the host), numbers are converted by hand,
+ * and results are written straight into GpsLocation and GpsSvStatus.
+ * Nothing is allocated.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "nmea.h"
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "the word-at-a-time scans assume a little endian target"
+#endif
+
+#define WORD_ONES       0x0101010101010101ULL
+#define WORD_LOW7       0x7f7f7f7f7f7f7f7fULL
+#define WORD_COMMAS     (WORD_ONES * ',')
+
+#define KNOTS_TO_MPS    0.514444f
+#define MS_PER_DAY      86400000LL
+
+static const double s_pow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18,
+};
+
+static inline uint64_t load_word(const char *p)
+{
+    uint64_t w;
+
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+/* 0x80 in every byte of w that is zero, nothing elsewhere */
+static inline uint64_t zero_bytes(uint64_t w)
+{
+    return ~(((w & WORD_LOW7) + WORD_LOW7) | w | WORD_LOW7);
+}
+
+uint8_t nmea_checksum(const char *data, size_t len)
+{
+    uint64_t acc = 0;
+    uint8_t sum;
+    size_t i;
+
+    for (i = 0; i + 8 <= len; i += 8)
+        acc ^= load_word(data + i);
+    acc ^= acc >> 32;
+    acc ^= acc >> 16;
+    acc ^= acc >> 8;
+    sum = (uint8_t)acc;
+
+    for (; i < len; i++)
+        sum ^= (uint8_t)data[i];
+
+    return sum;
+}
+
+/*
+ * Split body[0..len) at the commas in place. body must be readable for 7
+ * bytes past len.
+ */
+static int split_fields(char *body, size_t len, char **fields)
+{
+    int count = 1;
+    size_t i;
+
+    fields[0] = body;
+    for (i = 0; i < len; i += 8) {
+        uint64_t hits = zero_bytes(load_word(body + i) ^ WORD_COMMAS);
+
+        if (len - i < 8)
+            hits &= (1ULL << ((len - i) * 8)) - 1;
+        while (hits) {
+            size_t at = i + __builtin_ctzll(hits) / 8;
+
+            body[at] = '\0';
+            if (count < NMEA_MAX_FIELDS)
+                fields[count++] = body + at + 1;
+            hits &= hits - 1;
+        }
+    }
+    body[len] = '\0';
+
+    return count;
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+/* [+-]digits[.digits], nothing else; 0 if s is empty or malformed */
+static int parse_decimal(const char *s, double *out)
+{
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    int negative = 0;
+    double v;
+
+    if (*s == '-') {
+        negative = 1;
+        s++;
+    } else if (*s == '+') {
+        s++;
+    }
+
+    for (; *s >= '0' && *s <= '9'; s++, digits++) {
+        if (digits < 18)
+            mantissa = mantissa * 10 + (*s - '0');
+        else
+            scale++;
+    }
+    if (*s == '.') {
+        for (s++; *s >= '0' && *s <= '9'; s++, digits++) {
+            if (digits < 18) {
+                mantissa = mantissa * 10 + (*s - '0');
+                scale--;
+            }
+        }
+    }
+    if (*s != '\0' || digits == 0)
+        return 0;
+
+    v = (double)mantissa;
+    if (scale < 0)
+        v /= s_pow10[-scale];
+    else if (scale > 0)
+        v *= s_pow10[scale];
+    *out = negative ? -v : v;
+
+    return 1;
+}
+
+static int parse_int(const char *s, int *out)
+{
+    int v = 0;
+
+    if (*s == '\0')
+        return 0;
+    for (; *s >= '0' && *s <= '9'; s++)
+        v = v * 10 + (*s - '0');
+    if (*s != '\0')
+        return 0;
+    *out = v;
+
+    return 1;
+}
+
+static inline int two_digits(const char *s)
+{
+    return (s[0] - '0') * 10 + (s[1] - '0');
+}
+
+static inline int is_digits(const char *s, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (s[i] < '0' || s[i] > '9')
+            return 0;
+    return 1;
+}
+
+/* hhmmss[.sss] -> ms of the day, -1 if malformed */
+static int parse_time(const char *s)
+{
+    double seconds;
+
+    if (!is_digits(s, 6) || !parse_decimal(s + 4, &seconds))
+        return -1;
+
+    return (two_digits(s) * 3600 + two_digits(s + 2) * 60) * 1000
+            + (int)(seconds * 1000 + 0.5);
+}
+
+/* Days since 1970-01-01 of a proleptic Gregorian date */
+static int64_t days_from_civil(int y, int m, int d)
+{
+    int era, yoe, doy, doe;
+
+    y -= m <= 2;
+    era = (y >= 0 ? y : y - 399) / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+    return (int64_t)era * 146097 + doe - 719468;
+}
+
+/* ddmmyy -> days since the epoch, -1 if malformed */
+static int64_t parse_date(const char *s)
+{
+    int day, month, year;
+
+    if (!is_digits(s, 6) || s[6] != '\0')
+        return -1;
+    day = two_digits(s);
+    month = two_digits(s + 2);
+    year = two_digits(s + 4);
+    if (day < 1 || day > 31 || month < 1 || month > 12)
+        return -1;
+
+    /* NMEA only has two digits, GPS receivers are younger than 1980 */
+    return days_from_civil(year + (year < 80 ? 2000 : 1900), month, day);
+}
+
+/* [d]ddmm.mmmm plus hemisphere -> signed degrees */
+static int parse_coordinate(const char *value, const char *hemisphere, double *out)
+{
+    double v;
+    double degrees;
+
+    if (!parse_decimal(value, &v) || v < 0)
+        return 0;
+    degrees = floor(v / 100);
+    v = degrees + (v - degrees * 100) / 60;
+
+    switch (hemisphere[0]) {
+    case 'N':
+    case 'E':
+        *out = v;
+        return 1;
+    case 'S':
+    case 'W':
+        *out = -v;
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static void report_sv_status(struct nmea_parser *parser)
+{
+    GpsSvStatus *sv = &parser->sv;
+    int i;
+
+    sv->size = sizeof(*sv);
+    sv->used_in_fix_mask = 0;
+    for (i = 0; i < sv->num_svs; i++) {
+        int prn = sv->sv_list[i].prn;
+
+        if (prn >= 1 && prn <= 32 && (parser->used_mask & (1U << (prn - 1)))) {
+            sv->sv_list[i].used = 1;
+            sv->used_in_fix_mask |= 1U << (prn - 1);
+        }
+    }
+
+    parser->sv_fresh = 0;
+    parser->stats.sv_reports++;
+    if (parser->cb && parser->cb->sv_status)
+        parser->cb->sv_status(parser->ctx, sv);
+}
+
+static void handle_gga(struct nmea_parser *parser, char **f, int n)
+{
+    int quality;
+    double altitude, separation;
+    double hdop;
+
+    parser->gga_tod_ms = -1;
+    if (n < 12 || !parse_int(f[6], &quality) || quality == 0)
+        return;
+
+    if (!parse_decimal(f[9], &altitude))
+        return;
+    /* GGA altitude is above the geoid, GpsLocation wants the ellipsoid */
+    if (parse_decimal(f[11], &separation))
+        altitude += separation;
+
+    parser->gga_altitude = altitude;
+    parser->gga_hdop = parse_decimal(f[8], &hdop) ? (float)hdop : -1;
+    parser->gga_tod_ms = parse_time(f[1]);
+}
+
+static void handle_rmc(struct nmea_parser *parser, char **f, int n)
+{
+    GpsLocation location;
+    int tod;
+    int64_t days;
+    double v;
+
+    if (n < 10 || f[2][0] != 'A')
+        return;
+
+    memset(&location, 0, sizeof(location));
+    location.size = sizeof(location);
+
+    tod = parse_time(f[1]);
+    days = parse_date(f[9]);
+    if (tod < 0 || days < 0)
+        return;
+    if (!parse_coordinate(f[3], f[4], &location.latitude)
+            || !parse_coordinate(f[5], f[6], &location.longitude))
+        return;
+    location.flags = GPS_LOCATION_HAS_LAT_LONG;
+    location.timestamp = days * MS_PER_DAY + tod;
+
+    if (parse_decimal(f[7], &v)) {
+        location.speed = (float)v * KNOTS_TO_MPS;
+        location.flags |= GPS_LOCATION_HAS_SPEED;
+    }
+    if (parse_decimal(f[8], &v)) {
+        location.bearing = (float)v;
+        location.flags |= GPS_LOCATION_HAS_BEARING;
+    }
+    if (parser->gga_tod_ms == tod) {
+        location.altitude = parser->gga_altitude;
+        location.flags |= GPS_LOCATION_HAS_ALTITUDE;
+        if (parser->gga_hdop >= 0) {
+            location.accuracy = parser->gga_hdop * NMEA_UERE_M;
+            location.flags |= GPS_LOCATION_HAS_ACCURACY;
+        }
+    }
+
+    parser->stats.locations++;
+    if (parser->cb && parser->cb->location)
+        parser->cb->location(parser->ctx, &location);
+}
+
+/* GSA lists the PRNs used in the fix, one GSA per talker in an epoch */
+static void handle_gsa(struct nmea_parser *parser, char **f, int n, int continued)
+{
+    int i;
+
+    if (!continued)
+        parser->used_mask = 0;
+    for (i = 3; i < 15 && i < n; i++) {
+        int prn;
+
+        if (parse_int(f[i], &prn) && prn >= 1 && prn <= 32)
+            parser->used_mask |= 1U << (prn - 1);
+    }
+}
+
+/* The GSV set of this epoch is done: report it, or drop it if a message was lost */
+static void end_sv_status(struct nmea_parser *parser)
+{
+    if (parser->gsv_complete) {
+        report_sv_status(parser);
+    } else {
+        parser->sv_fresh = 0;
+        parser->stats.sv_discarded++;
+    }
+}
+
+/* Bit for the talker of a sentence ID, GB and BD are both BeiDou */
+static uint32_t talker_bit(const char *id)
+{
+    static const char s_talkers[][3] = { "GP", "GL", "GA", "GB", "BD", "GQ", "QZ", "GN" };
+    unsigned i;
+
+    for (i = 0; i < sizeof(s_talkers) / sizeof(s_talkers[0]); i++)
+        if (id[0] == s_talkers[i][0] && id[1] == s_talkers[i][1])
+            return 1U << i;
+    return 1U << i;
+}
+
+static void handle_gsv(struct nmea_parser *parser, char **f, int n)
+{
+    GpsSvStatus *sv = &parser->sv;
+    uint32_t talker = talker_bit(f[0]);
+    int total, number;
+    int i;
+
+    if (n < 4 || !parse_int(f[1], &total) || !parse_int(f[2], &number))
+        return;
+
+    /* A talker starting over ends the set, even if its last message was lost */
+    if (parser->sv_fresh && number == 1 && (parser->gsv_talkers & talker))
+        end_sv_status(parser);
+    if (!parser->sv_fresh) {
+        memset(sv, 0, sizeof(*sv));
+        parser->sv_fresh = 1;
+        parser->gsv_talkers = 0;
+    }
+    parser->gsv_talkers |= talker;
+
+    /* Whole groups of four only, NMEA 4.1 appends a signal ID */
+    for (i = 4; i + 3 < n; i += 4) {
+        GpsSvInfo *info;
+        int prn;
+        double v;
+
+        if (!parse_int(f[i], &prn) || sv->num_svs >= GPS_MAX_SVS)
+            continue;
+        info = &sv->sv_list[sv->num_svs++];
+        info->size = sizeof(*info);
+        info->prn = prn;
+        info->elevation = parse_decimal(f[i + 1], &v) ? (float)v : 0;
+        info->azimuth = parse_decimal(f[i + 2], &v) ? (float)v : 0;
+        /* Empty SNR: in view but not tracked */
+        info->snr = parse_decimal(f[i + 3], &v) ? (float)v : 0;
+    }
+
+    parser->gsv_complete = number >= total;
+}
+
+static void process_sentence(struct nmea_parser *parser)
+{
+    char *buf = parser->buf;
+    unsigned len = parser->len;
+    char *fields[NMEA_MAX_FIELDS];
+    const char *type;
+    int count;
+    int was_gsa;
+
+    /* Trailing CR, and anything short of "$ttsss" */
+    while (len > 0 && (buf[len - 1] == '\r' || buf[len - 1] == '\n'))
+        len--;
+    if (len < 6 || buf[0] != '$') {
+        parser->stats.ignored++;
+        return;
+    }
+    parser->stats.sentences++;
+
+    if (len >= 9 && buf[len - 3] == '*') {
+        int hi = hex_value(buf[len - 2]);
+        int lo = hex_value(buf[len - 1]);
+
+        len -= 3;
+        if (hi < 0 || lo < 0 || nmea_checksum(buf + 1, len - 1) != (hi << 4 | lo)) {
+            parser->stats.bad_checksum++;
+            return;
+        }
+    }
+
+    count = split_fields(buf + 1, len - 1, fields);
+    if (strlen(fields[0]) != 5) {
+        parser->stats.ignored++;
+        return;
+    }
+    /* Skip the talker, GP, GL, GN and BD all mean the same here */
+    type = fields[0] + 2;
+
+    if (memcmp(type, "GSV", 3) == 0) {
+        handle_gsv(parser, fields, count);
+        parser->last_was_gsa = 0;
+        return;
+    }
+    if (parser->sv_fresh)
+        end_sv_status(parser);
+
+    was_gsa = parser->last_was_gsa;
+    parser->last_was_gsa = 0;
+    if (memcmp(type, "GGA", 3) == 0) {
+        handle_gga(parser, fields, count);
+    } else if (memcmp(type, "RMC", 3) == 0) {
+        handle_rmc(parser, fields, count);
+    } else if (memcmp(type, "GSA", 3) == 0) {
+        handle_gsa(parser, fields, count, was_gsa);
+        parser->last_was_gsa = 1;
+    } else {
+        parser->stats.ignored++;
+    }
+}
+
+void nmea_parser_init(struct nmea_parser *parser,
+        const struct nmea_callbacks *cb, void *ctx)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->cb = cb;
+    parser->ctx = ctx;
+    parser->gga_tod_ms = -1;
+}
+
+static void append(struct nmea_parser *parser, const char *data, size_t len)
+{
+    if (parser->len + len > NMEA_MAX_SENTENCE) {
+        parser->overflowed = 1;
+        len = NMEA_MAX_SENTENCE - parser->len;
+    }
+    memcpy(parser->buf + parser->len, data, len);
+    parser->len += len;
+}
+
+void nmea_parser_feed(struct nmea_parser *parser, const char *data, size_t len)
+{
+    const char *end = data + len;
+
+    parser->stats.bytes += len;
+    while (data < end) {
+        const char *eol;
+
+        if (!parser->in_sentence) {
+            data = memchr(data, '$', end - data);
+            if (data == NULL)
+                return;
+            parser->in_sentence = 1;
+            parser->overflowed = 0;
+            parser->len = 0;
+        }
+
+        eol = memchr(data, '\n', end - data);
+        if (eol == NULL) {
+            append(parser, data, end - data);
+            return;
+        }
+        append(parser, data, eol - data);
+        data = eol + 1;
+
+        parser->in_sentence = 0;
+        if (parser->overflowed)
+            parser->stats.overflow++;
+        else
+            process_sentence(parser);
+    }
+}
+
+void nmea_parser_sentence(struct nmea_parser *parser, const char *nmea, int length)
+{
+    if (length < 0)
+        return;
+    parser->stats.bytes += length;
+    if (length > NMEA_MAX_SENTENCE) {
+        parser->stats.overflow++;
+        return;
+    }
+    memcpy(parser->buf, nmea, length);
+    parser->len = length;
+    process_sentence(parser);
+}
+
+void nmea_parser_flush(struct nmea_parser *parser)
+{
+    if (parser->sv_fresh && parser->gsv_complete)
+        report_sv_status(parser);
+}
+
+int nmea_time_of_day(const char *sentence, size_t len)
+{
+    const char *field, *end = sentence + len;
+    char time[16];
+    int index, n;
+
+    if (len < 7 || sentence[0] != '$')
+        return -1;
+    if (memcmp(sentence + 3, "GGA,", 4) == 0 || memcmp(sentence + 3, "RMC,", 4) == 0
+            || memcmp(sentence + 3, "GNS,", 4) == 0 || memcmp(sentence + 3, "ZDA,", 4) == 0)
+        index = 1;
+    else if (memcmp(sentence + 3, "GLL,", 4) == 0)
+        index = 5;
+    else
+        return -1;
+
+    field = sentence;
+    for (n = 0; n < index; n++) {
+        field = memchr(field, ',', end - field);
+        if (field++ == NULL)
+            return -1;
+    }
+    for (n = 0; field + n < end && field[n] != ',' && field[n] != '*'; n++)
+        if (n == (int)sizeof(time) - 1)
+            return -1;
+    memcpy(time, field, n);
+    time[n] = '\0';
+
+    return parse_time(time);
+}
+
+/*
+ * Generators
+ */
+
+/* Append "*hh\r\n" to the sentence in buf[0..len) */
+static int finish_sentence(char *buf, size_t size, int len)
+{
+    if (len < 0 || (size_t)len + 6 > size)
+        return -1;
+
+    return len + snprintf(buf + len, size - len, "*%02X\r\n",
+            nmea_checksum(buf + 1, len - 1));
+}
+
+static int format_coordinate(char *buf, size_t size, double value, int degree_digits,
+        char positive, char negative)
+{
+    double magnitude = fabs(value);
+    int degrees = (int)magnitude;
+    double minutes = (magnitude - degrees) * 60;
+
+    /* Don't let rounding print 60 minutes */
+    if (minutes >= 59.99995) {
+        degrees++;
+        minutes = 0;
+    }
+
+    return snprintf(buf, size, "%0*d%07.4f,%c", degree_digits, degrees, minutes,
+            value < 0 ? negative : positive);
+}
+
+static int format_time(char *buf, size_t size, GpsUtcTime timestamp)
+{
+    int64_t tod = timestamp % MS_PER_DAY;
+
+    if (tod < 0)
+        tod += MS_PER_DAY;
+
+    return snprintf(buf, size, "%02d%02d%02d.%02d", (int)(tod / 3600000),
+            (int)(tod / 60000 % 60), (int)(tod / 1000 % 60), (int)(tod % 1000 / 10));
+}
+
+static int format_date(char *buf, size_t size, GpsUtcTime timestamp)
+{
+    int64_t z = timestamp / MS_PER_DAY + 719468;
+    int era = (int)((z >= 0 ? z : z - 146096) / 146097);
+    int doe = (int)(z - (int64_t)era * 146097);
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    int day = doy - (153 * mp + 2) / 5 + 1;
+    int month = mp < 10 ? mp + 3 : mp - 9;
+    int year = yoe + era * 400 + (month <= 2);
+
+    return snprintf(buf, size, "%02d%02d%02d", day, month, year % 100);
+}
+
+/* snprintf into buf at *len, tracking truncation */
+#define APPEND(buf, size, len, ...) do { \
+        if ((len) >= 0 && (size_t)(len) < (size)) { \
+            int n_ = snprintf((buf) + (len), (size) - (len), __VA_ARGS__); \
+            (len) = n_ < 0 || (size_t)((len) + n_) >= (size) ? -1 : (len) + n_; \
+        } else { \
+            (len) = -1; \
+        } \
+    } while (0)
+
+#define APPEND_WITH(buf, size, len, fn, ...) do { \
+        if ((len) >= 0 && (size_t)(len) < (size)) { \
+            int n_ = fn((buf) + (len), (size) - (len), __VA_ARGS__); \
+            (len) = n_ < 0 || (size_t)((len) + n_) >= (size) ? -1 : (len) + n_; \
+        } else { \
+            (len) = -1; \
+        } \
+    } while (0)
+
+int nmea_format_gga(char *buf, size_t size, const GpsLocation *location,
+        int num_svs, float hdop)
+{
+    int len = 0;
+
+    APPEND(buf, size, len, "$GPGGA,");
+    APPEND_WITH(buf, size, len, format_time, location->timestamp);
+    APPEND(buf, size, len, ",");
+    APPEND_WITH(buf, size, len, format_coordinate, location->latitude, 2, 'N', 'S');
+    APPEND(buf, size, len, ",");
+    APPEND_WITH(buf, size, len, format_coordinate, location->longitude, 3, 'E', 'W');
+    APPEND(buf, size, len, ",1,%02d,%.1f,%.1f,M,0.0,M,,", num_svs, hdop,
+            location->altitude);
+
+    return finish_sentence(buf, size, len);
+}
+
+int nmea_format_rmc(char *buf, size_t size, const GpsLocation *location)
+{
+    int len = 0;
+
+    APPEND(buf, size, len, "$GPRMC,");
+    APPEND_WITH(buf, size, len, format_time, location->timestamp);
+    APPEND(buf, size, len, ",A,");
+    APPEND_WITH(buf, size, len, format_coordinate, location->latitude, 2, 'N', 'S');
+    APPEND(buf, size, len, ",");
+    APPEND_WITH(buf, size, len, format_coordinate, location->longitude, 3, 'E', 'W');
+    APPEND(buf, size, len, ",%.2f,%.1f,", location->speed / KNOTS_TO_MPS,
+            location->bearing);
+    APPEND_WITH(buf, size, len, format_date, location->timestamp);
+    APPEND(buf, size, len, ",,,A");
+
+    return finish_sentence(buf, size, len);
+}
+
+int nmea_format_gsa(char *buf, size_t size, const GpsSvStatus *status, float hdop)
+{
+    int len = 0;
+    int used = 0;
+    int i;
+
+    APPEND(buf, size, len, "$GPGSA,A,3");
+    for (i = 0; i < status->num_svs && used < 12; i++) {
+        int prn = status->sv_list[i].prn;
+
+        if (prn >= 1 && prn <= 32 && (status->used_in_fix_mask & (1U << (prn - 1)))) {
+            APPEND(buf, size, len, ",%02d", prn);
+            used++;
+        }
+    }
+    for (; used < 12; used++)
+        APPEND(buf, size, len, ",");
+    APPEND(buf, size, len, ",%.1f,%.1f,%.1f", hdop * 1.5f, hdop, hdop * 1.2f);
+
+    return finish_sentence(buf, size, len);
+}
+
+int nmea_gsv_count(const GpsSvStatus *status)
+{
+    return status->num_svs > 0 ? (status->num_svs + 3) / 4 : 1;
+}
+
+int nmea_format_gsv(char *buf, size_t size, const GpsSvStatus *status, int index)
+{
+    int len = 0;
+    int i;
+
+    APPEND(buf, size, len, "$GPGSV,%d,%d,%02d", nmea_gsv_count(status), index + 1,
+            status->num_svs);
+    for (i = index * 4; i < status->num_svs && i < index * 4 + 4; i++) {
+        const GpsSvInfo *info = &status->sv_list[i];
+
+        APPEND(buf, size, len, ",%02d,%02d,%03d,", info->prn, (int)info->elevation,
+                (int)info->azimuth);
+        if (info->snr > 0)
+            APPEND(buf, size, len, "%02d", (int)(info->snr + 0.5f));
+    }
+
+    return finish_sentence(buf, size, len);
+}
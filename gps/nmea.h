@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef NMEA_H
+#define NMEA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <hardware/gps.h>
+
+__BEGIN_DECLS
+
+/* NMEA 0183 caps sentences at 82 characters, leave room for proprietary ones */
+#define NMEA_MAX_SENTENCE   128
+#define NMEA_MAX_FIELDS     32
+
+/* Assumed user equivalent range error, accuracy is HDOP times this */
+#define NMEA_UERE_M         5.0f
+
+struct nmea_callbacks {
+    /* A fix, from an RMC with status A plus the same epoch's GGA if it came first */
+    void (*location)(void *ctx, const GpsLocation *location);
+    /* Every SV in the GSV sets of one epoch, all talkers */
+    void (*sv_status)(void *ctx, const GpsSvStatus *status);
+};
+
+struct nmea_stats {
+    uint64_t bytes;
+    uint64_t sentences;
+    uint64_t bad_checksum;
+    uint64_t overflow;
+    uint64_t ignored;
+    uint64_t locations;
+    uint64_t sv_reports;
+    /* GSV sets given up on, their last message never came */
+    uint64_t sv_discarded;
+};
+
+/*
+ * Streaming parser state, no allocations: sentences are assembled in buf
+ * and split in place.
+ */
+struct nmea_parser {
+    const struct nmea_callbacks *cb;
+    void *ctx;
+
+    /* Sentence being assembled, padded for word-at-a-time scans */
+    char buf[NMEA_MAX_SENTENCE + 8];
+    unsigned len;
+    int in_sentence;
+    int overflowed;
+
+    /* Last GGA: time of day (ms), altitude and HDOP */
+    int gga_tod_ms;
+    double gga_altitude;
+    float gga_hdop;
+
+    /* GSV sets of the current epoch, and a bit per talker that sent one */
+    GpsSvStatus sv;
+    int sv_fresh;
+    int gsv_complete;
+    uint32_t gsv_talkers;
+    /* PRNs of the last GSA, or run of GSAs */
+    uint32_t used_mask;
+    int last_was_gsa;
+
+    struct nmea_stats stats;
+};
+
+void nmea_parser_init(struct nmea_parser *parser,
+        const struct nmea_callbacks *cb, void *ctx);
+
+/* Feed raw receiver output, any chunking */
+void nmea_parser_feed(struct nmea_parser *parser, const char *data, size_t len);
+
+/* Parse one complete sentence, as handed to gps_nmea_callback */
+void nmea_parser_sentence(struct nmea_parser *parser, const char *nmea, int length);
+
+/* Report a GSV epoch still held back waiting for the next sentence */
+void nmea_parser_flush(struct nmea_parser *parser);
+
+/*
+ * Time of day in ms of a sentence that carries one (GGA, RMC, GNS, ZDA,
+ * GLL), -1 for other sentences or a malformed time
+ */
+int nmea_time_of_day(const char *sentence, size_t len);
+
+/* XOR of the characters between '$' and '*' */
+uint8_t nmea_checksum(const char *data, size_t len);
+
+/*
+ * Sentence generators. Each writes one sentence including "*hh\r\n" and a
+ * terminating NUL, and returns its length, or -1 if size is too small.
+ */
+int nmea_format_gga(char *buf, size_t size, const GpsLocation *location,
+        int num_svs, float hdop);
+int nmea_format_rmc(char *buf, size_t size, const GpsLocation *location);
+int nmea_format_gsa(char *buf, size_t size, const GpsSvStatus *status, float hdop);
+/* GSV message index (0-based) of status, see nmea_gsv_count() */
+int nmea_format_gsv(char *buf, size_t size, const GpsSvStatus *status, int index);
+int nmea_gsv_count(const GpsSvStatus *status);
+
+__END_DECLS
+
+#endif /* NMEA_H */
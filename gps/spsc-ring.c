@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "spsc-ring.h"
+
+int spsc_ring_init(struct spsc_ring *ring, uint32_t capacity, size_t slot_size)
+{
+    uint32_t n = 1;
+
+    if (capacity == 0 || capacity > 1U << 31)
+        return -1;
+    while (n < capacity)
+        n <<= 1;
+
+    memset(ring, 0, sizeof(*ring));
+    /* Slots start on cache lines too, a slot is written by one side at a time */
+    ring->slot_size = (slot_size + SPSC_CACHE_LINE - 1) & ~(size_t)(SPSC_CACHE_LINE - 1);
+    ring->mask = n - 1;
+    if (posix_memalign((void **)&ring->slots, SPSC_CACHE_LINE, (size_t)n * ring->slot_size) != 0) {
+        ring->slots = NULL;
+        return -1;
+    }
+    spsc_ring_reset(ring);
+
+    return 0;
+}
+
+void spsc_ring_destroy(struct spsc_ring *ring)
+{
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+void spsc_ring_reset(struct spsc_ring *ring)
+{
+    atomic_store(&ring->head, 0);
+    atomic_store(&ring->tail, 0);
+    atomic_store(&ring->high_water, 0);
+    atomic_store(&ring->overflows, 0);
+}
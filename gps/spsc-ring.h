@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <sys/cdefs.h>
+
+__BEGIN_DECLS
+
+#define SPSC_CACHE_LINE     64
+
+/*
+ * Single producer, single consumer ring of preallocated fixed-size slots.
+ * The producer fills a slot in place between claim and publish, the
+ * consumer uses it in place between peek and release; neither blocks nor
+ * locks. A full ring drops what the producer wanted to add and counts it.
+ *
+ * head and tail run free and are masked on use, the capacity is a power
+ * of two. They sit on separate cache lines so the two sides don't bounce
+ * one line between cores on every slot.
+ */
+struct spsc_ring {
+    /* Written by the producer */
+    _Atomic uint32_t head;
+    _Atomic uint32_t high_water;
+    _Atomic uint32_t overflows;
+
+    /* Written by the consumer */
+    _Atomic uint32_t tail __attribute__((aligned(SPSC_CACHE_LINE)));
+
+    uint32_t mask __attribute__((aligned(SPSC_CACHE_LINE)));
+    size_t slot_size;
+    char *slots;
+};
+
+/* Capacity is rounded up to a power of two; 0 on success */
+int spsc_ring_init(struct spsc_ring *ring, uint32_t capacity, size_t slot_size);
+void spsc_ring_destroy(struct spsc_ring *ring);
+/* Empty the ring; only while neither side is using it */
+void spsc_ring_reset(struct spsc_ring *ring);
+
+static inline uint32_t spsc_ring_capacity(const struct spsc_ring *ring)
+{
+    return ring->mask + 1;
+}
+
+/* Producer: whether a claim would fail right now */
+static inline int spsc_ring_full(struct spsc_ring *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+    return head - atomic_load_explicit(&ring->tail, memory_order_acquire) > ring->mask;
+}
+
+/* Producer: the next free slot, or NULL (and an overflow) if full */
+static inline void *spsc_ring_claim(struct spsc_ring *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+
+    if (head - tail > ring->mask) {
+        atomic_fetch_add_explicit(&ring->overflows, 1, memory_order_relaxed);
+        return NULL;
+    }
+    return ring->slots + (size_t)(head & ring->mask) * ring->slot_size;
+}
+
+/* Producer: hand the claimed slot to the consumer */
+static inline void spsc_ring_publish(struct spsc_ring *ring)
+{
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed) + 1;
+    uint32_t used = head - atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->head, head, memory_order_release);
+    if (used > atomic_load_explicit(&ring->high_water, memory_order_relaxed))
+        atomic_store_explicit(&ring->high_water, used, memory_order_relaxed);
+}
+
+/* Consumer: the oldest published slot, or NULL if empty */
+static inline void *spsc_ring_peek(struct spsc_ring *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+
+    if (head == tail)
+        return NULL;
+    return ring->slots + (size_t)(tail & ring->mask) * ring->slot_size;
+}
+
+/* Consumer: done with the peeked slot, the producer may reuse it */
+static inline void spsc_ring_release(struct spsc_ring *ring)
+{
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
+
+__END_DECLS
+
+#endif /* SPSC_RING_H */
@@ -0,0 +1,55 @@
+#
+# Copyright (C) 2016 The CyanogenMod Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+LOCAL_PATH := $(call my-dir)
+
+# Host-only stand-in for the proprietary libsec-ril.so, see mock-ril.c
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    mock-ril.c \
+    modem-sim.c
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../include \
+    hardware/ril/include
+
+LOCAL_CFLAGS := -DRIL_SHLIB -Wall -Werror
+LOCAL_LDLIBS := -lpthread
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_MODULE := libsecril-mock
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_SHARED_LIBRARY)
+
+# Load generator driving a vendor RIL through RIL_RadioFunctions
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    ril-loadtest.c
+
+LOCAL_C_INCLUDES := \
+    $(LOCAL_PATH)/../include \
+    hardware/ril/include
+
+LOCAL_CFLAGS := -DRIL_SHLIB -Wall -Werror
+LOCAL_LDLIBS := -ldl -lpthread
+
+LOCAL_MODULE := ril-loadtest
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_EXECUTABLE)
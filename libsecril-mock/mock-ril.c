@@ -0,0 +1,549 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Stand-in for the proprietary libsec-ril.so, for measuring the RIL stack
+ * without the xmm6262. Every request is answered with a canned response
+ * after a configurable latency, and unsolicited responses can be generated
+ * periodically to load the unsolicited path.
+ *
+ * RIL_Init arguments (passed after "--" by rild, or with -a by ril-loadtest):
+ *   -c <file>  latency profile, see below
+ *   -s <seed>  seed for the jitter generator
+ *   -t <file>  modem trace to replay, see modem-sim.c
+ *   -x <speed> trace replay speed factor, 0 replays as fast as possible
+ *   -L <loops> number of passes over the trace, 0 loops forever
+ *
+ * Profile format, one directive per line, '#' starts a comment:
+ *   default <latency_ms> <jitter_ms>
+ *   req <code> <latency_ms> <jitter_ms> [<RIL_Errno>]
+ *   unsol <code> <period_ms>
+ *
+ * The effective latency is uniformly distributed in
+ * [latency - jitter, latency + jitter], clamped at zero.
+ */
+
+#define LOG_TAG "RIL-MOCK"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <utils/Log.h>
+
+#include "mock-ril.h"
+
+#define MOCK_RIL_VERSION_STRING "mock-ril 1.0"
+#define MAX_UNSOL_SOURCES       16
+
+struct latency_profile {
+    unsigned latency_ms;
+    unsigned jitter_ms;
+    RIL_Errno error;
+    int set;
+};
+
+struct unsol_source {
+    int code;
+    unsigned period_ms;
+};
+
+struct pending_request {
+    struct pending_request *next;
+    RIL_Token t;
+    int request;
+    RIL_Errno error;
+    int done;
+    void *response;
+    size_t responselen;
+    union {
+        int ints[4];
+        const char *strings[15];
+        RIL_SIM_IO_Response sim_io;
+        RIL_SignalStrength_v10 signal;
+        RIL_CardStatus_v6 card;
+    } u;
+    char *buffer;
+};
+
+const struct RIL_Env *s_rilenv;
+uint64_t mock_ril_unsol_due_ns;
+
+static RIL_RadioState s_state = RADIO_STATE_UNAVAILABLE;
+
+static struct latency_profile s_default_profile;
+static struct latency_profile s_aosp_profiles[256];
+static struct latency_profile s_samsung_profiles[SAMSUNG_REQUEST_COUNT];
+
+static struct unsol_source s_unsol_sources[MAX_UNSOL_SOURCES];
+static int s_unsol_count;
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int s_seed = 1;
+static struct pending_request *s_pending;
+
+static const char *s_imsi = "001010123456789";
+static const char *s_imei = "004999010640000";
+static const char *s_imeisv = "01";
+static const char *s_baseband = "N5100XXDLL1";
+
+uint64_t mock_ril_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void mock_ril_schedule(RIL_TimedCallback cb, void *param, unsigned delay_ms)
+{
+    struct timeval tv;
+
+    tv.tv_sec = delay_ms / 1000;
+    tv.tv_usec = (delay_ms % 1000) * 1000;
+    RIL_requestTimedCallback(cb, param, &tv);
+}
+
+static struct latency_profile *profile_slot(int request)
+{
+    if (request >= 0 && request < (int)(sizeof(s_aosp_profiles) / sizeof(s_aosp_profiles[0])))
+        return &s_aosp_profiles[request];
+    if (request >= SAMSUNG_REQUEST_BASE
+            && request < SAMSUNG_REQUEST_BASE + SAMSUNG_REQUEST_COUNT)
+        return &s_samsung_profiles[request - SAMSUNG_REQUEST_BASE];
+    return NULL;
+}
+
+static const struct latency_profile *profile_for(int request)
+{
+    const struct latency_profile *profile = profile_slot(request);
+
+    if (profile == NULL || !profile->set)
+        return &s_default_profile;
+
+    return profile;
+}
+
+static unsigned pick_latency(const struct latency_profile *profile)
+{
+    long latency = profile->latency_ms;
+    unsigned span;
+
+    if (profile->jitter_ms == 0)
+        return profile->latency_ms;
+
+    span = 2 * profile->jitter_ms + 1;
+    pthread_mutex_lock(&s_mutex);
+    latency += (long)(rand_r(&s_seed) % span) - (long)profile->jitter_ms;
+    pthread_mutex_unlock(&s_mutex);
+
+    return latency < 0 ? 0 : (unsigned)latency;
+}
+
+static int load_profile(const char *path)
+{
+    char line[256];
+    FILE *fp;
+    int lineno = 0;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        ALOGE("Cannot open profile %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        unsigned latency, jitter, period;
+        int code, error = RIL_E_SUCCESS;
+        char *comment;
+
+        lineno++;
+        comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+
+        if (sscanf(line, "default %u %u", &latency, &jitter) == 2) {
+            s_default_profile.latency_ms = latency;
+            s_default_profile.jitter_ms = jitter;
+            s_default_profile.set = 1;
+        } else if (sscanf(line, "req %d %u %u %d", &code, &latency, &jitter, &error) >= 3) {
+            struct latency_profile *slot = profile_slot(code);
+
+            if (slot == NULL) {
+                ALOGW("%s:%d: request %d out of range", path, lineno, code);
+                continue;
+            }
+            slot->latency_ms = latency;
+            slot->jitter_ms = jitter;
+            slot->error = (RIL_Errno)error;
+            slot->set = 1;
+        } else if (sscanf(line, "unsol %d %u", &code, &period) == 2) {
+            if (s_unsol_count == MAX_UNSOL_SOURCES || period == 0) {
+                ALOGW("%s:%d: ignoring unsol source", path, lineno);
+                continue;
+            }
+            s_unsol_sources[s_unsol_count].code = code;
+            s_unsol_sources[s_unsol_count].period_ms = period;
+            s_unsol_count++;
+        } else if (strspn(line, " \t\r\n") != strlen(line)) {
+            ALOGW("%s:%d: cannot parse '%s'", path, lineno, line);
+        }
+    }
+
+    fclose(fp);
+    return 0;
+}
+
+static void set_radio_state(RIL_RadioState state)
+{
+    if (s_state == state)
+        return;
+
+    s_state = state;
+    RIL_onUnsolicitedResponse(RIL_UNSOL_RESPONSE_RADIO_STATE_CHANGED, NULL, 0);
+}
+
+static void fill_signal_strength(RIL_SignalStrength_v10 *signal)
+{
+    memset(signal, 0, sizeof(*signal));
+    signal->GW_SignalStrength.signalStrength = 12 + rand_r(&s_seed) % 8;
+    signal->GW_SignalStrength.bitErrorRate = 99;
+    signal->CDMA_SignalStrength.dbm = -1;
+    signal->CDMA_SignalStrength.ecio = -1;
+    signal->EVDO_SignalStrength.dbm = -1;
+    signal->EVDO_SignalStrength.ecio = -1;
+    signal->EVDO_SignalStrength.signalNoiseRatio = -1;
+    signal->LTE_SignalStrength.signalStrength = 99;
+    signal->LTE_SignalStrength.rsrp = 0x7FFFFFFF;
+    signal->LTE_SignalStrength.rsrq = 0x7FFFFFFF;
+    signal->LTE_SignalStrength.rssnr = 0x7FFFFFFF;
+    signal->LTE_SignalStrength.cqi = 0x7FFFFFFF;
+    signal->LTE_SignalStrength.timingAdvance = 0x7FFFFFFF;
+    signal->TD_SCDMA_SignalStrength.rscp = 0x7FFFFFFF;
+}
+
+static void fill_card_status(RIL_CardStatus_v6 *card)
+{
+    RIL_AppStatus *app = &card->applications[0];
+
+    memset(card, 0, sizeof(*card));
+    card->card_state = RIL_CARDSTATE_PRESENT;
+    card->universal_pin_state = RIL_PINSTATE_UNKNOWN;
+    card->gsm_umts_subscription_app_index = 0;
+    card->cdma_subscription_app_index = -1;
+    card->ims_subscription_app_index = -1;
+    card->num_applications = 1;
+
+    app->app_type = RIL_APPTYPE_USIM;
+    app->app_state = RIL_APPSTATE_READY;
+    app->perso_substate = RIL_PERSOSUBSTATE_READY;
+    app->pin1 = RIL_PINSTATE_DISABLED;
+    app->pin2 = RIL_PINSTATE_ENABLED_NOT_VERIFIED;
+}
+
+/*
+ * Build the canned response for request into pr. Requests not listed
+ * complete with an empty response, which every libril marshaller accepts.
+ */
+static void build_response(struct pending_request *pr, int request,
+        void *data, size_t datalen)
+{
+    pr->response = NULL;
+    pr->responselen = 0;
+
+    switch (request) {
+    case RIL_REQUEST_GET_SIM_STATUS:
+        fill_card_status(&pr->u.card);
+        pr->response = &pr->u.card;
+        pr->responselen = sizeof(pr->u.card);
+        break;
+    case RIL_REQUEST_GET_IMSI:
+        pr->response = (void *)s_imsi;
+        pr->responselen = sizeof(char *);
+        break;
+    case RIL_REQUEST_GET_IMEI:
+        pr->response = (void *)s_imei;
+        pr->responselen = sizeof(char *);
+        break;
+    case RIL_REQUEST_GET_IMEISV:
+        pr->response = (void *)s_imeisv;
+        pr->responselen = sizeof(char *);
+        break;
+    case RIL_REQUEST_BASEBAND_VERSION:
+        pr->response = (void *)s_baseband;
+        pr->responselen = sizeof(char *);
+        break;
+    case RIL_REQUEST_OPERATOR:
+        pr->u.strings[0] = "Mock Network";
+        pr->u.strings[1] = "Mock";
+        pr->u.strings[2] = "00101";
+        pr->response = pr->u.strings;
+        pr->responselen = 3 * sizeof(char *);
+        break;
+    case RIL_REQUEST_VOICE_REGISTRATION_STATE:
+    case RIL_REQUEST_DATA_REGISTRATION_STATE:
+        memset(pr->u.strings, 0, sizeof(pr->u.strings));
+        pr->u.strings[0] = "1";         /* registered, home */
+        pr->u.strings[1] = "1a2b";      /* LAC */
+        pr->u.strings[2] = "0000c0de";  /* CID */
+        pr->u.strings[3] = "11";        /* HSPA */
+        pr->response = pr->u.strings;
+        pr->responselen = (request == RIL_REQUEST_VOICE_REGISTRATION_STATE ? 15 : 6)
+                * sizeof(char *);
+        break;
+    case RIL_REQUEST_SIGNAL_STRENGTH:
+        pthread_mutex_lock(&s_mutex);
+        fill_signal_strength(&pr->u.signal);
+        pthread_mutex_unlock(&s_mutex);
+        pr->response = &pr->u.signal;
+        pr->responselen = sizeof(pr->u.signal);
+        break;
+    case RIL_REQUEST_QUERY_NETWORK_SELECTION_MODE:
+    case RIL_REQUEST_GET_PREFERRED_NETWORK_TYPE:
+        pr->u.ints[0] = 0;
+        pr->response = pr->u.ints;
+        pr->responselen = sizeof(int);
+        break;
+    case RIL_REQUEST_SIM_IO: {
+        const RIL_SIM_IO_v6 *io = data;
+        int len = (io != NULL && datalen >= sizeof(*io) && io->p3 > 0) ? io->p3 : 0;
+
+        /* Blank (all 0xFF) records of the requested length */
+        pr->buffer = malloc(2 * len + 1);
+        if (pr->buffer != NULL) {
+            memset(pr->buffer, 'F', 2 * len);
+            pr->buffer[2 * len] = '\0';
+        }
+        pr->u.sim_io.sw1 = 0x90;
+        pr->u.sim_io.sw2 = 0x00;
+        pr->u.sim_io.simResponse = pr->buffer;
+        pr->response = &pr->u.sim_io;
+        pr->responselen = sizeof(pr->u.sim_io);
+        break;
+    }
+    case RIL_REQUEST_RADIO_POWER:
+        if (data != NULL && datalen >= sizeof(int))
+            set_radio_state(((int *)data)[0] ? RADIO_STATE_ON : RADIO_STATE_OFF);
+        break;
+    }
+}
+
+static void unlink_pending(struct pending_request *pr)
+{
+    struct pending_request **pp;
+
+    for (pp = &s_pending; *pp != NULL; pp = &(*pp)->next) {
+        if (*pp == pr) {
+            *pp = pr->next;
+            break;
+        }
+    }
+}
+
+static void complete_request(void *param)
+{
+    struct pending_request *pr = param;
+    int done;
+
+    pthread_mutex_lock(&s_mutex);
+    done = pr->done;
+    pr->done = 1;
+    unlink_pending(pr);
+    pthread_mutex_unlock(&s_mutex);
+
+    /* A cancelled request has already been answered */
+    if (!done) {
+        if (pr->error != RIL_E_SUCCESS)
+            RIL_onRequestComplete(pr->t, pr->error, NULL, 0);
+        else
+            RIL_onRequestComplete(pr->t, RIL_E_SUCCESS, pr->response, pr->responselen);
+    }
+
+    free(pr->buffer);
+    free(pr);
+}
+
+static void fire_unsol(void *param)
+{
+    struct unsol_source *source = param;
+    RIL_SignalStrength_v10 signal;
+
+    switch (source->code) {
+    case RIL_UNSOL_SIGNAL_STRENGTH:
+        pthread_mutex_lock(&s_mutex);
+        fill_signal_strength(&signal);
+        pthread_mutex_unlock(&s_mutex);
+        RIL_onUnsolicitedResponse(source->code, &signal, sizeof(signal));
+        break;
+    default:
+        RIL_onUnsolicitedResponse(source->code, NULL, 0);
+        break;
+    }
+
+    mock_ril_schedule(fire_unsol, source, source->period_ms);
+}
+
+#if defined(ANDROID_MULTI_SIM)
+static void onRequest(int request, void *data, size_t datalen, RIL_Token t,
+        RIL_SOCKET_ID socket_id __unused)
+#else
+static void onRequest(int request, void *data, size_t datalen, RIL_Token t)
+#endif
+{
+    const struct latency_profile *profile = profile_for(request);
+    struct pending_request *pr;
+    unsigned latency;
+    RIL_Errno error;
+
+    /* The trace runs from the first request on, see modem-sim.c */
+    modem_sim_start();
+
+    if (s_state == RADIO_STATE_UNAVAILABLE && request != RIL_REQUEST_GET_SIM_STATUS) {
+        RIL_onRequestComplete(t, RIL_E_RADIO_NOT_AVAILABLE, NULL, 0);
+        return;
+    }
+
+    pr = calloc(1, sizeof(*pr));
+    if (pr == NULL) {
+        RIL_onRequestComplete(t, RIL_E_GENERIC_FAILURE, NULL, 0);
+        return;
+    }
+
+    if (!modem_sim_next_response(request, &latency, &error)) {
+        latency = pick_latency(profile);
+        error = profile->error;
+    }
+
+    pr->t = t;
+    pr->request = request;
+    pr->error = error;
+    if (pr->error == RIL_E_SUCCESS)
+        build_response(pr, request, data, datalen);
+
+    pthread_mutex_lock(&s_mutex);
+    pr->next = s_pending;
+    s_pending = pr;
+    pthread_mutex_unlock(&s_mutex);
+
+    mock_ril_schedule(complete_request, pr, latency);
+}
+
+#if defined(ANDROID_MULTI_SIM)
+static RIL_RadioState currentState(RIL_SOCKET_ID socket_id __unused)
+#else
+static RIL_RadioState currentState()
+#endif
+{
+    return s_state;
+}
+
+static int onSupports(int requestCode)
+{
+    return profile_for(requestCode)->error != RIL_E_REQUEST_NOT_SUPPORTED;
+}
+
+static void onCancel(RIL_Token t)
+{
+    struct pending_request *pr;
+    int found = 0;
+
+    pthread_mutex_lock(&s_mutex);
+    for (pr = s_pending; pr != NULL; pr = pr->next) {
+        if (pr->t == t && !pr->done) {
+            /* complete_request() frees it once its timer fires */
+            pr->done = 1;
+            found = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_mutex);
+
+    if (found)
+        RIL_onRequestComplete(t, RIL_E_CANCELLED, NULL, 0);
+}
+
+static const char *getVersion(void)
+{
+    return MOCK_RIL_VERSION_STRING;
+}
+
+static const RIL_RadioFunctions s_callbacks = {
+    RIL_VERSION,
+    onRequest,
+    currentState,
+    onSupports,
+    onCancel,
+    getVersion
+};
+
+static void radio_ready(void *param __unused)
+{
+    int i;
+
+    set_radio_state(RADIO_STATE_OFF);
+
+    for (i = 0; i < s_unsol_count; i++)
+        mock_ril_schedule(fire_unsol, &s_unsol_sources[i], s_unsol_sources[i].period_ms);
+}
+
+const RIL_RadioFunctions *RIL_Init(const struct RIL_Env *env, int argc, char **argv)
+{
+    double speed = 1.0;
+    int loops = 1;
+    int opt;
+
+    s_rilenv = env;
+
+    optind = 1;
+    while ((opt = getopt(argc, argv, "c:s:t:x:L:")) != -1) {
+        switch (opt) {
+        case 'c':
+            if (load_profile(optarg) < 0)
+                return NULL;
+            break;
+        case 's':
+            s_seed = (unsigned int)strtoul(optarg, NULL, 0);
+            break;
+        case 't':
+            if (modem_sim_load(optarg) < 0)
+                return NULL;
+            break;
+        case 'x':
+            speed = strtod(optarg, NULL);
+            break;
+        case 'L':
+            loops = (int)strtol(optarg, NULL, 0);
+            break;
+        default:
+            ALOGE("usage: %s [-c profile] [-s seed] [-t trace [-x speed] [-L loops]]",
+                    argv[0]);
+            return NULL;
+        }
+    }
+    modem_sim_set_speed(speed, loops);
+
+    ALOGI("%s: default latency %ums +/- %ums, %d unsol sources", getVersion(),
+            s_default_profile.latency_ms, s_default_profile.jitter_ms, s_unsol_count);
+
+    /* Like a real modem, come up asynchronously */
+    mock_ril_schedule(radio_ready, NULL, 0);
+
+    return &s_callbacks;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MOCK_RIL_H
+#define MOCK_RIL_H
+
+#include <stdint.h>
+#include <telephony/ril.h>
+
+#define SAMSUNG_REQUEST_BASE    10000
+#define SAMSUNG_REQUEST_COUNT   64
+
+extern const struct RIL_Env *s_rilenv;
+
+/*
+ * Scheduled time (mock_ril_now_ns() clock) of the unsolicited response
+ * being delivered, 0 if it has none. Set around each replayed trace unsol
+ * so a host loading this library can dlsym() it from OnUnsolicitedResponse
+ * and measure dispatch latency end to end.
+ */
+extern uint64_t mock_ril_unsol_due_ns;
+
+#if defined(ANDROID_MULTI_SIM)
+#define RIL_onUnsolicitedResponse(a, b, c) \
+    s_rilenv->OnUnsolicitedResponse(a, b, c, RIL_SOCKET_1)
+#else
+#define RIL_onUnsolicitedResponse(a, b, c) \
+    s_rilenv->OnUnsolicitedResponse(a, b, c)
+#endif
+#define RIL_onRequestComplete(t, e, response, responselen) \
+    s_rilenv->OnRequestComplete(t, e, response, responselen)
+#define RIL_requestTimedCallback(cb, param, tv) \
+    s_rilenv->RequestTimedCallback(cb, param, tv)
+
+/* Monotonic clock in nanoseconds */
+uint64_t mock_ril_now_ns(void);
+
+/* Schedule cb(param) on the RIL event loop after delay_ms */
+void mock_ril_schedule(RIL_TimedCallback cb, void *param, unsigned delay_ms);
+
+/* Scripted modem simulator, see modem-sim.c */
+int modem_sim_load(const char *path);
+void modem_sim_set_speed(double speed, int loops);
+void modem_sim_start(void);
+int modem_sim_next_response(int request, unsigned *latency_ms, RIL_Errno *error);
+
+#endif /* MOCK_RIL_H */
@@ -0,0 +1,439 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Scripted xmm6262 simulator: replays a recorded trace of solicited and
+ * unsolicited traffic through libsecril-mock, at real or scaled speed.
+ *
+ * Trace format, one event per line, '#' starts a comment, times are in
+ * milliseconds from the start of the trace and must not decrease:
+ *
+ *   <time> req <code> <latency_ms> [<RIL_Errno>]
+ *       The next request <code> is answered after <latency_ms>, with
+ *       RIL_Errno if given. Recorded answers are consumed in order; once
+ *       a code runs out, the latency profile applies again.
+ *
+ *   <time> unsol <code> <payload>
+ *       Emit unsolicited response <code> at <time>. <payload> is one of
+ *         void
+ *         ints <v>...
+ *         string <text>
+ *         strings <s>...
+ *         signal <gw_signal_strength> <gw_bit_error_rate>
+ *         cells <count> <gw_signal_strength>   (count GSM RIL_CellInfo)
+ *
+ * Example, a handover burst:
+ *   0    unsol 1009  signal 18 99
+ *   40   unsol 1036  cells 6 14
+ *   45   unsol 11016 ints 1
+ *   60   unsol 11012 ints 0
+ *   60   req   20    350
+ *
+ * Playback starts with the first request the RIL gets, so the trace lines
+ * up with the framework's traffic rather than with RIL_Init, and a load
+ * generator's warm-up doesn't eat the start of it.
+ *
+ * The <time> of a req line only orders it in the trace: recorded answers
+ * are matched to requests as they arrive, not at a point in time.
+ *
+ * Each emitted event records how late it fired relative to its scheduled
+ * time; a summary is logged after every pass over the trace. The scheduled
+ * time is also published in mock_ril_unsol_due_ns while the event is
+ * delivered, so the host can measure the whole way to its
+ * OnUnsolicitedResponse.
+ */
+
+#define LOG_TAG "RIL-MOCK"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <utils/Log.h>
+
+#include "mock-ril.h"
+
+#define MAX_VALUES      16
+#define MAX_CELLS       32
+
+enum payload_kind {
+    PAYLOAD_VOID,
+    PAYLOAD_INTS,
+    PAYLOAD_STRING,
+    PAYLOAD_STRINGS,
+    PAYLOAD_SIGNAL,
+    PAYLOAD_CELLS,
+};
+
+struct trace_event {
+    unsigned time_ms;
+    int solicited;
+    int code;
+    enum payload_kind kind;
+    int count;
+    int values[MAX_VALUES];
+    char *text;
+    char *strings[MAX_VALUES];
+    unsigned latency_ms;
+    RIL_Errno error;
+};
+
+static struct trace_event *s_events;
+static size_t s_event_count;
+
+/*
+ * Per request code scan position for recorded solicited answers, guarded
+ * by s_cursor_mutex: onRequest and play() need not share a thread.
+ */
+static pthread_mutex_t s_cursor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static size_t s_aosp_cursors[256];
+static size_t s_samsung_cursors[SAMSUNG_REQUEST_COUNT];
+
+static double s_speed = 1.0;
+static int s_loops = 1;
+static int s_started;
+static int s_loop;
+static size_t s_next_unsol;
+static uint64_t s_start_ns;
+static uint64_t *s_lateness_ns;
+static size_t s_lateness_count;
+
+static unsigned scale(unsigned ms)
+{
+    if (s_speed <= 0)
+        return 0;
+    return (unsigned)(ms / s_speed);
+}
+
+static int parse_payload(struct trace_event *ev, char *kind, char *rest)
+{
+    char *save = NULL;
+    char *tok;
+
+    if (strcmp(kind, "void") == 0) {
+        ev->kind = PAYLOAD_VOID;
+    } else if (strcmp(kind, "ints") == 0 || strcmp(kind, "signal") == 0
+            || strcmp(kind, "cells") == 0) {
+        ev->kind = kind[0] == 'i' ? PAYLOAD_INTS
+                : kind[0] == 's' ? PAYLOAD_SIGNAL : PAYLOAD_CELLS;
+        for (tok = strtok_r(rest, " \t\r\n", &save); tok != NULL;
+                tok = strtok_r(NULL, " \t\r\n", &save)) {
+            if (ev->count == MAX_VALUES)
+                return -1;
+            ev->values[ev->count++] = (int)strtol(tok, NULL, 0);
+        }
+        if ((ev->kind == PAYLOAD_SIGNAL || ev->kind == PAYLOAD_CELLS) && ev->count != 2)
+            return -1;
+        if (ev->kind == PAYLOAD_CELLS && (ev->values[0] < 0 || ev->values[0] > MAX_CELLS))
+            return -1;
+    } else if (strcmp(kind, "string") == 0) {
+        ev->kind = PAYLOAD_STRING;
+        rest += strspn(rest, " \t");
+        rest[strcspn(rest, "\r\n")] = '\0';
+        ev->text = strdup(rest);
+        if (ev->text == NULL)
+            return -1;
+    } else if (strcmp(kind, "strings") == 0) {
+        ev->kind = PAYLOAD_STRINGS;
+        ev->text = strdup(rest);
+        if (ev->text == NULL)
+            return -1;
+        for (tok = strtok_r(ev->text, " \t\r\n", &save); tok != NULL;
+                tok = strtok_r(NULL, " \t\r\n", &save)) {
+            if (ev->count == MAX_VALUES)
+                return -1;
+            ev->strings[ev->count++] = tok;
+        }
+    } else {
+        return -1;
+    }
+
+    return 0;
+}
+
+int modem_sim_load(const char *path)
+{
+    char line[512];
+    size_t capacity = 0;
+    unsigned last_ms = 0;
+    int lineno = 0;
+    FILE *fp;
+
+    fp = fopen(path, "r");
+    if (fp == NULL) {
+        ALOGE("Cannot open trace %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        struct trace_event *ev;
+        char type[8], kind[16];
+        unsigned time_ms, latency;
+        int code, error = RIL_E_SUCCESS, consumed = 0;
+        char *comment;
+
+        lineno++;
+        comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+        if (strspn(line, " \t\r\n") == strlen(line))
+            continue;
+
+        if (s_event_count == capacity) {
+            struct trace_event *events;
+
+            capacity = capacity ? 2 * capacity : 256;
+            events = realloc(s_events, capacity * sizeof(*events));
+            if (events == NULL) {
+                ALOGE("Out of memory loading %s", path);
+                fclose(fp);
+                return -1;
+            }
+            s_events = events;
+        }
+        ev = &s_events[s_event_count];
+        memset(ev, 0, sizeof(*ev));
+
+        if (sscanf(line, "%u %7s %d %n", &time_ms, type, &code, &consumed) < 3
+                || consumed == 0 || time_ms < last_ms) {
+            ALOGW("%s:%d: bad event, skipped", path, lineno);
+            continue;
+        }
+
+        ev->time_ms = time_ms;
+        ev->code = code;
+
+        if (strcmp(type, "req") == 0) {
+            if (sscanf(line + consumed, "%u %d", &latency, &error) < 1) {
+                ALOGW("%s:%d: req needs a latency, skipped", path, lineno);
+                continue;
+            }
+            ev->solicited = 1;
+            ev->latency_ms = latency;
+            ev->error = (RIL_Errno)error;
+        } else if (strcmp(type, "unsol") == 0) {
+            int kind_len = 0;
+
+            if (sscanf(line + consumed, "%15s %n", kind, &kind_len) < 1
+                    || parse_payload(ev, kind, line + consumed + kind_len) < 0) {
+                ALOGW("%s:%d: bad unsol payload, skipped", path, lineno);
+                free(ev->text);
+                continue;
+            }
+        } else {
+            ALOGW("%s:%d: unknown event type '%s', skipped", path, lineno, type);
+            continue;
+        }
+
+        last_ms = time_ms;
+        s_event_count++;
+    }
+
+    fclose(fp);
+
+    s_lateness_ns = calloc(s_event_count ? s_event_count : 1, sizeof(uint64_t));
+    if (s_lateness_ns == NULL)
+        return -1;
+
+    ALOGI("Loaded %zu events spanning %u ms from %s", s_event_count, last_ms, path);
+    return 0;
+}
+
+void modem_sim_set_speed(double speed, int loops)
+{
+    s_speed = speed;
+    s_loops = loops;
+}
+
+/*
+ * Consume the oldest unanswered recorded response for request. Returns 1
+ * and fills latency/error if there was one.
+ */
+int modem_sim_next_response(int request, unsigned *latency_ms, RIL_Errno *error)
+{
+    size_t *cursor;
+    int found = 0;
+
+    if (request >= 0 && request < 256)
+        cursor = &s_aosp_cursors[request];
+    else if (request >= SAMSUNG_REQUEST_BASE
+            && request < SAMSUNG_REQUEST_BASE + SAMSUNG_REQUEST_COUNT)
+        cursor = &s_samsung_cursors[request - SAMSUNG_REQUEST_BASE];
+    else
+        return 0;
+
+    pthread_mutex_lock(&s_cursor_mutex);
+    for (; *cursor < s_event_count; (*cursor)++) {
+        struct trace_event *ev = &s_events[*cursor];
+
+        if (ev->solicited && ev->code == request) {
+            (*cursor)++;
+            *latency_ms = scale(ev->latency_ms);
+            *error = ev->error;
+            found = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_cursor_mutex);
+
+    return found;
+}
+
+static void emit(struct trace_event *ev, uint64_t due)
+{
+    static RIL_CellInfo cells[MAX_CELLS];
+    RIL_SignalStrength_v10 signal;
+    int i;
+
+    mock_ril_unsol_due_ns = due;
+
+    switch (ev->kind) {
+    case PAYLOAD_VOID:
+        RIL_onUnsolicitedResponse(ev->code, NULL, 0);
+        break;
+    case PAYLOAD_INTS:
+        RIL_onUnsolicitedResponse(ev->code, ev->values, ev->count * sizeof(int));
+        break;
+    case PAYLOAD_STRING:
+        RIL_onUnsolicitedResponse(ev->code, ev->text, sizeof(char *));
+        break;
+    case PAYLOAD_STRINGS:
+        RIL_onUnsolicitedResponse(ev->code, ev->strings, ev->count * sizeof(char *));
+        break;
+    case PAYLOAD_SIGNAL:
+        memset(&signal, 0, sizeof(signal));
+        signal.GW_SignalStrength.signalStrength = ev->values[0];
+        signal.GW_SignalStrength.bitErrorRate = ev->values[1];
+        signal.CDMA_SignalStrength.dbm = -1;
+        signal.CDMA_SignalStrength.ecio = -1;
+        signal.EVDO_SignalStrength.dbm = -1;
+        signal.EVDO_SignalStrength.ecio = -1;
+        signal.EVDO_SignalStrength.signalNoiseRatio = -1;
+        signal.LTE_SignalStrength.signalStrength = 99;
+        signal.LTE_SignalStrength.rsrp = INT_MAX;
+        signal.LTE_SignalStrength.rsrq = INT_MAX;
+        signal.LTE_SignalStrength.rssnr = INT_MAX;
+        signal.LTE_SignalStrength.cqi = INT_MAX;
+        signal.LTE_SignalStrength.timingAdvance = INT_MAX;
+        signal.TD_SCDMA_SignalStrength.rscp = INT_MAX;
+        RIL_onUnsolicitedResponse(ev->code, &signal, sizeof(signal));
+        break;
+    case PAYLOAD_CELLS:
+        for (i = 0; i < ev->values[0]; i++) {
+            RIL_CellInfo *cell = &cells[i];
+
+            memset(cell, 0, sizeof(*cell));
+            cell->cellInfoType = RIL_CELL_INFO_TYPE_GSM;
+            cell->registered = (i == 0);
+            cell->timeStampType = RIL_TIMESTAMP_TYPE_OEM_RIL;
+            cell->timeStamp = mock_ril_now_ns();
+            cell->CellInfo.gsm.cellIdentityGsm.mcc = 1;
+            cell->CellInfo.gsm.cellIdentityGsm.mnc = 1;
+            cell->CellInfo.gsm.cellIdentityGsm.lac = 0x1a2b;
+            cell->CellInfo.gsm.cellIdentityGsm.cid = 0xc0de + i;
+            cell->CellInfo.gsm.signalStrengthGsm.signalStrength = ev->values[1];
+            cell->CellInfo.gsm.signalStrengthGsm.bitErrorRate = 99;
+        }
+        RIL_onUnsolicitedResponse(ev->code, ev->values[0] ? cells : NULL,
+                ev->values[0] * sizeof(RIL_CellInfo));
+        break;
+    }
+
+    mock_ril_unsol_due_ns = 0;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void report_pass(void)
+{
+    uint64_t elapsed = mock_ril_now_ns() - s_start_ns;
+    size_t n = s_lateness_count;
+
+    if (n == 0) {
+        ALOGI("Trace pass %d: no unsolicited events", s_loop + 1);
+        return;
+    }
+
+    qsort(s_lateness_ns, n, sizeof(uint64_t), compare_u64);
+    ALOGI("Trace pass %d: %zu unsols in %.1f ms (x%.1f), lateness us p50 %.1f p99 %.1f max %.1f",
+            s_loop + 1, n, elapsed / 1e6, s_speed,
+            s_lateness_ns[n / 2] / 1e3, s_lateness_ns[(n * 99) / 100] / 1e3,
+            s_lateness_ns[n - 1] / 1e3);
+}
+
+static void play(void *param __unused)
+{
+    uint64_t now = mock_ril_now_ns();
+
+    while (s_next_unsol < s_event_count) {
+        struct trace_event *ev = &s_events[s_next_unsol];
+        uint64_t due = s_start_ns + (uint64_t)scale(ev->time_ms) * 1000000ULL;
+
+        if (ev->solicited) {
+            s_next_unsol++;
+            continue;
+        }
+        if (due > now) {
+            mock_ril_schedule(play, NULL, (unsigned)((due - now + 999999) / 1000000));
+            return;
+        }
+
+        emit(ev, due);
+        s_lateness_ns[s_lateness_count++] = mock_ril_now_ns() - due;
+        s_next_unsol++;
+    }
+
+    report_pass();
+
+    if (++s_loop < s_loops || s_loops == 0) {
+        pthread_mutex_lock(&s_cursor_mutex);
+        memset(s_aosp_cursors, 0, sizeof(s_aosp_cursors));
+        memset(s_samsung_cursors, 0, sizeof(s_samsung_cursors));
+        pthread_mutex_unlock(&s_cursor_mutex);
+        s_next_unsol = 0;
+        s_lateness_count = 0;
+        s_start_ns = mock_ril_now_ns();
+        mock_ril_schedule(play, NULL, 0);
+    }
+}
+
+/* Start playback, once; later calls do nothing */
+void modem_sim_start(void)
+{
+    int started;
+
+    pthread_mutex_lock(&s_cursor_mutex);
+    started = s_started;
+    s_started = 1;
+    pthread_mutex_unlock(&s_cursor_mutex);
+
+    if (started || s_event_count == 0)
+        return;
+
+    s_loop = 0;
+    s_next_unsol = 0;
+    s_lateness_count = 0;
+    s_start_ns = mock_ril_now_ns();
+    mock_ril_schedule(play, NULL, 0);
+}
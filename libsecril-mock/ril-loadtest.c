@@ -0,0 +1,469 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Host driver that loads a vendor RIL (normally libsecril-mock) the way
+ * rild does and drives it through RIL_RadioFunctions, measuring request
+ * throughput, completion latency and unsolicited fan-out.
+ *
+ * usage: ril-loadtest -l <vendor ril .so> [-n requests] [-w window]
+ *                     [-r request]... [-t seconds] [-a ril arg]...
+ *
+ * Requests listed with -r are issued round robin with at most <window>
+ * outstanding. The event loop also runs RequestTimedCallback callbacks,
+ * on the same thread that calls onRequest, as libril does.
+ *
+ * If the vendor RIL exports mock_ril_unsol_due_ns (libsecril-mock does,
+ * for replayed trace events), each unsolicited response carrying a
+ * scheduled time also counts towards the dispatch latency, measured from
+ * that time to its arrival in OnUnsolicitedResponse.
+ */
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <telephony/ril.h>
+
+#define MAX_REQUEST_CODES   32
+#define MAX_RIL_ARGS        32
+#define UNSOL_SLOTS         64
+
+struct timer {
+    uint64_t when_ns;
+    RIL_TimedCallback cb;
+    void *param;
+};
+
+struct request_slot {
+    uint64_t sent_ns;
+    int request;
+};
+
+static const RIL_RadioFunctions *s_funcs;
+
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t s_cond = PTHREAD_COND_INITIALIZER;
+
+static struct timer *s_timers;
+static size_t s_timer_count;
+static size_t s_timer_capacity;
+
+static int s_request_codes[MAX_REQUEST_CODES];
+static int s_request_code_count;
+static unsigned s_total_requests = 1000;
+static unsigned s_window = 16;
+
+static unsigned s_issued;
+static unsigned s_dispatched;
+static unsigned s_completed;
+static unsigned s_failed;
+static unsigned s_in_flight;
+static uint64_t *s_latencies_ns;
+
+static int s_loading;
+
+/* Unsolicited counts for codes 1000+ (AOSP) and 11000+ (Samsung) */
+static const int s_unsol_bases[2] = { 1000, 11000 };
+static unsigned long s_unsol_counts[2][UNSOL_SLOTS];
+static unsigned long s_unsol_total;
+
+static const uint64_t *s_unsol_due_ns;
+static uint64_t *s_dispatch_ns;
+static size_t s_dispatch_count;
+static size_t s_dispatch_capacity;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Binary min-heap on when_ns; callers hold s_mutex */
+static void timer_push(uint64_t when_ns, RIL_TimedCallback cb, void *param)
+{
+    size_t i;
+
+    if (s_timer_count == s_timer_capacity) {
+        size_t capacity = s_timer_capacity ? 2 * s_timer_capacity : 64;
+        struct timer *timers = realloc(s_timers, capacity * sizeof(*timers));
+
+        if (timers == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        s_timers = timers;
+        s_timer_capacity = capacity;
+    }
+
+    i = s_timer_count++;
+    while (i > 0 && s_timers[(i - 1) / 2].when_ns > when_ns) {
+        s_timers[i] = s_timers[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    s_timers[i].when_ns = when_ns;
+    s_timers[i].cb = cb;
+    s_timers[i].param = param;
+}
+
+static struct timer timer_pop(void)
+{
+    struct timer top = s_timers[0];
+    struct timer last = s_timers[--s_timer_count];
+    size_t i = 0;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+
+        if (child >= s_timer_count)
+            break;
+        if (child + 1 < s_timer_count
+                && s_timers[child + 1].when_ns < s_timers[child].when_ns)
+            child++;
+        if (last.when_ns <= s_timers[child].when_ns)
+            break;
+        s_timers[i] = s_timers[child];
+        i = child;
+    }
+    if (s_timer_count > 0)
+        s_timers[i] = last;
+
+    return top;
+}
+
+static void onRequestComplete(RIL_Token t, RIL_Errno e,
+        void *response __unused, size_t responselen __unused)
+{
+    struct request_slot *slot = t;
+    uint64_t latency = now_ns() - slot->sent_ns;
+
+    pthread_mutex_lock(&s_mutex);
+    s_latencies_ns[s_completed++] = latency;
+    if (e != RIL_E_SUCCESS)
+        s_failed++;
+    s_in_flight--;
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+
+    free(slot);
+}
+
+#if defined(ANDROID_MULTI_SIM)
+static void onUnsolicitedResponse(int unsolResponse, const void *data __unused,
+        size_t datalen __unused, RIL_SOCKET_ID socket_id __unused)
+#else
+static void onUnsolicitedResponse(int unsolResponse, const void *data __unused,
+        size_t datalen __unused)
+#endif
+{
+    uint64_t due = s_unsol_due_ns != NULL ? *s_unsol_due_ns : 0;
+    uint64_t now = now_ns();
+    int i;
+
+    pthread_mutex_lock(&s_mutex);
+    if (due != 0) {
+        if (s_dispatch_count == s_dispatch_capacity) {
+            size_t capacity = s_dispatch_capacity ? 2 * s_dispatch_capacity : 256;
+            uint64_t *dispatch = realloc(s_dispatch_ns, capacity * sizeof(*dispatch));
+
+            if (dispatch == NULL) {
+                fprintf(stderr, "out of memory\n");
+                exit(1);
+            }
+            s_dispatch_ns = dispatch;
+            s_dispatch_capacity = capacity;
+        }
+        s_dispatch_ns[s_dispatch_count++] = now > due ? now - due : 0;
+    }
+    s_unsol_total++;
+    for (i = 0; i < 2; i++) {
+        int slot = unsolResponse - s_unsol_bases[i];
+
+        if (slot >= 0 && slot < UNSOL_SLOTS)
+            s_unsol_counts[i][slot]++;
+    }
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static void requestTimedCallback(RIL_TimedCallback callback, void *param,
+        const struct timeval *relativeTime)
+{
+    uint64_t delay_ns = 0;
+
+    if (relativeTime != NULL)
+        delay_ns = (uint64_t)relativeTime->tv_sec * 1000000000ULL
+                + (uint64_t)relativeTime->tv_usec * 1000ULL;
+
+    pthread_mutex_lock(&s_mutex);
+    timer_push(now_ns() + delay_ns, callback, param);
+    pthread_cond_broadcast(&s_cond);
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static const struct RIL_Env s_env = {
+    onRequestComplete,
+    onUnsolicitedResponse,
+    requestTimedCallback
+};
+
+static void issue_request(void *param __unused)
+{
+    static RIL_SIM_IO_v6 sim_io = { 0xb2, 0x6f3a, "3F007F10", 1, 4, 28, NULL, NULL, NULL };
+    static int radio_on = 1;
+    struct request_slot *slot;
+    void *data = NULL;
+    size_t datalen = 0;
+    int request;
+
+    pthread_mutex_lock(&s_mutex);
+    request = s_request_codes[s_dispatched % s_request_code_count];
+    s_dispatched++;
+    pthread_mutex_unlock(&s_mutex);
+
+    switch (request) {
+    case RIL_REQUEST_SIM_IO:
+        data = &sim_io;
+        datalen = sizeof(sim_io);
+        break;
+    case RIL_REQUEST_RADIO_POWER:
+    case RIL_REQUEST_SCREEN_STATE:
+        data = &radio_on;
+        datalen = sizeof(radio_on);
+        break;
+    }
+
+    slot = malloc(sizeof(*slot));
+    if (slot == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    slot->request = request;
+    slot->sent_ns = now_ns();
+
+#if defined(ANDROID_MULTI_SIM)
+    s_funcs->onRequest(request, data, datalen, slot, RIL_SOCKET_1);
+#else
+    s_funcs->onRequest(request, data, datalen, slot);
+#endif
+}
+
+/* Runs timers until deadline_ns, or until every request completed */
+static void event_loop(uint64_t deadline_ns)
+{
+    pthread_mutex_lock(&s_mutex);
+    for (;;) {
+        uint64_t now = now_ns();
+
+        if (now >= deadline_ns)
+            break;
+        if (s_completed == s_total_requests && deadline_ns == UINT64_MAX)
+            break;
+
+        /* Keep the window full */
+        if (s_loading && s_issued < s_total_requests && s_in_flight < s_window) {
+            s_issued++;
+            s_in_flight++;
+            timer_push(now, issue_request, NULL);
+        }
+
+        if (s_timer_count > 0 && s_timers[0].when_ns <= now) {
+            struct timer timer = timer_pop();
+
+            pthread_mutex_unlock(&s_mutex);
+            timer.cb(timer.param);
+            pthread_mutex_lock(&s_mutex);
+        } else {
+            uint64_t wake = deadline_ns;
+            struct timespec ts;
+
+            if (s_timer_count > 0 && s_timers[0].when_ns < wake)
+                wake = s_timers[0].when_ns;
+            if (wake == UINT64_MAX)
+                wake = now + 1000000000ULL;
+
+            /* pthread_cond_timedwait uses CLOCK_REALTIME */
+            clock_gettime(CLOCK_REALTIME, &ts);
+            wake -= now;
+            ts.tv_sec += wake / 1000000000ULL;
+            ts.tv_nsec += wake % 1000000000ULL;
+            if (ts.tv_nsec >= 1000000000L) {
+                ts.tv_sec++;
+                ts.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&s_cond, &s_mutex, &ts);
+        }
+    }
+    pthread_mutex_unlock(&s_mutex);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void report(uint64_t elapsed_ns, unsigned soak_seconds)
+{
+    uint64_t sum = 0;
+    unsigned i, j;
+
+    printf("requests:   %u completed, %u failed in %.3f s (%.1f req/s)\n",
+            s_completed, s_failed, elapsed_ns / 1e9,
+            elapsed_ns ? s_completed * 1e9 / elapsed_ns : 0.0);
+
+    if (s_completed > 0) {
+        qsort(s_latencies_ns, s_completed, sizeof(uint64_t), compare_u64);
+        for (i = 0; i < s_completed; i++)
+            sum += s_latencies_ns[i];
+        printf("latency ms: min %.3f avg %.3f p50 %.3f p99 %.3f max %.3f\n",
+                s_latencies_ns[0] / 1e6, sum / 1e6 / s_completed,
+                s_latencies_ns[s_completed / 2] / 1e6,
+                s_latencies_ns[(s_completed * 99) / 100] / 1e6,
+                s_latencies_ns[s_completed - 1] / 1e6);
+    }
+
+    printf("unsol:      %lu total", s_unsol_total);
+    if (soak_seconds > 0)
+        printf(" (%.1f/s over %u s soak)", (double)s_unsol_total / soak_seconds,
+                soak_seconds);
+    printf("\n");
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < UNSOL_SLOTS; j++) {
+            if (s_unsol_counts[i][j] > 0)
+                printf("  %5u: %lu\n", s_unsol_bases[i] + j, s_unsol_counts[i][j]);
+        }
+    }
+
+    if (s_dispatch_count > 0) {
+        size_t n = s_dispatch_count;
+
+        qsort(s_dispatch_ns, n, sizeof(uint64_t), compare_u64);
+        printf("dispatch us: %zu unsols, p50 %.1f p99 %.1f max %.1f\n", n,
+                s_dispatch_ns[n / 2] / 1e3, s_dispatch_ns[(n * 99) / 100] / 1e3,
+                s_dispatch_ns[n - 1] / 1e3);
+    }
+}
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s -l <vendor ril .so> [-n requests] [-w window]\n"
+            "          [-r request]... [-t soak seconds] [-a ril arg]...\n", argv0);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const RIL_RadioFunctions *(*rilInit)(const struct RIL_Env *, int, char **);
+    char *ril_argv[MAX_RIL_ARGS + 1];
+    int ril_argc = 1;
+    const char *lib = NULL;
+    unsigned soak_seconds = 0;
+    uint64_t start;
+    void *handle;
+    int opt;
+
+    ril_argv[0] = "ril-loadtest";
+
+    while ((opt = getopt(argc, argv, "l:n:w:r:t:a:")) != -1) {
+        switch (opt) {
+        case 'l':
+            lib = optarg;
+            break;
+        case 'n':
+            s_total_requests = strtoul(optarg, NULL, 0);
+            break;
+        case 'w':
+            s_window = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            if (s_request_code_count == MAX_REQUEST_CODES)
+                usage(argv[0]);
+            s_request_codes[s_request_code_count++] = strtol(optarg, NULL, 0);
+            break;
+        case 't':
+            soak_seconds = strtoul(optarg, NULL, 0);
+            break;
+        case 'a':
+            if (ril_argc == MAX_RIL_ARGS)
+                usage(argv[0]);
+            ril_argv[ril_argc++] = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    ril_argv[ril_argc] = NULL;
+
+    if (lib == NULL || s_window == 0)
+        usage(argv[0]);
+    if (s_request_code_count == 0)
+        s_request_codes[s_request_code_count++] = RIL_REQUEST_SIGNAL_STRENGTH;
+
+    s_latencies_ns = calloc(s_total_requests ? s_total_requests : 1, sizeof(uint64_t));
+    if (s_latencies_ns == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    handle = dlopen(lib, RTLD_NOW);
+    if (handle == NULL) {
+        fprintf(stderr, "dlopen %s: %s\n", lib, dlerror());
+        return 1;
+    }
+    rilInit = (const RIL_RadioFunctions *(*)(const struct RIL_Env *, int, char **))
+            dlsym(handle, "RIL_Init");
+    if (rilInit == NULL) {
+        fprintf(stderr, "%s does not export RIL_Init\n", lib);
+        return 1;
+    }
+    s_unsol_due_ns = (const uint64_t *)dlsym(handle, "mock_ril_unsol_due_ns");
+
+    s_funcs = rilInit(&s_env, ril_argc, ril_argv);
+    if (s_funcs == NULL) {
+        fprintf(stderr, "RIL_Init failed\n");
+        return 1;
+    }
+    printf("vendor ril: %s (RIL_VERSION %d)\n",
+            s_funcs->getVersion ? s_funcs->getVersion() : "?", s_funcs->version);
+
+    /*
+     * Let the RIL come up and report its radio state before loading it.
+     * libsecril-mock holds a trace back until the first request, so the
+     * reset below doesn't drop any of it.
+     */
+    event_loop(now_ns() + 100000000ULL);
+    s_unsol_total = 0;
+    memset(s_unsol_counts, 0, sizeof(s_unsol_counts));
+    s_dispatch_count = 0;
+
+    s_loading = 1;
+    start = now_ns();
+    if (soak_seconds > 0)
+        event_loop(start + soak_seconds * 1000000000ULL);
+    else
+        event_loop(UINT64_MAX);
+    report(now_ns() - start, soak_seconds);
+
+    return s_completed == s_total_requests ? 0 : 1;
+}
@@ -0,0 +1,49 @@
+#
+# Copyright (C) 2016 The CyanogenMod Project
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+LOCAL_PATH := $(call my-dir)
+
+# Host benchmark for SamsungExynos4PendingRequests, see PendingRequestsBench.
+# Lives outside ril/ because BOARD_RIL_CLASS builds every java file there.
+# Run with: java -jar $(HOST_OUT_JAVA_LIBRARIES)/pending-requests-bench.jar
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    src/com/android/internal/telephony/PendingRequestsBench.java \
+    $(call all-java-files-under, stubs) \
+    ../ril/telephony/java/com/android/internal/telephony/SamsungExynos4PendingRequests.java
+
+LOCAL_JAR_MANIFEST := manifest.txt
+
+LOCAL_MODULE := pending-requests-bench
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_JAVA_LIBRARY)
+
+# Host benchmark for the solicited response decoder choice, see
+# ResponseDecodeBench.
+# Run with: java -jar $(HOST_OUT_JAVA_LIBRARIES)/response-decode-bench.jar
+include $(CLEAR_VARS)
+
+LOCAL_SRC_FILES := \
+    src/com/android/internal/telephony/ResponseDecodeBench.java
+
+LOCAL_JAR_MANIFEST := response-decode-manifest.txt
+
+LOCAL_MODULE := response-decode-bench
+LOCAL_MODULE_TAGS := optional
+
+include $(BUILD_HOST_JAVA_LIBRARY)
@@ -0,0 +1,211 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.util.SparseArray;
+
+import java.util.ArrayList;
+import java.util.Random;
+
+/**
+ * Replays interleaved requests and responses against the ways
+ * SamsungExynos4RIL can find the request a response belongs to.
+ *
+ * Usage: pending-requests-bench [-n requests] [-w in flight] [-p passes]
+ *                               [-s seed]
+ *
+ * Requests are sent until -w are in flight (a phonebook or cell info
+ * burst), then answered mostly in order, one of the 8 oldest at random,
+ * the way rild works through its queue. Three lookups are timed:
+ *
+ *  sparsearray  RIL: append(), then get() and remove() per response
+ *  table        SamsungExynos4PendingRequests alone
+ *  sparse+table what SamsungExynos4RIL does: RIL's lookup, plus the table
+ *               for send times and deadlines
+ *
+ * The best of -p passes counts. The SparseArray is a host stand-in, see
+ * stubs/android/util/SparseArray.java.
+ */
+public final class PendingRequestsBench {
+
+    private static final int OUT_OF_ORDER = 8;
+    /* RILConstants isn't part of the host build */
+    private static final int RIL_REQUEST_SIM_IO = 28;
+
+    private int mRequests = 10000;
+    private int mWindow = 200;
+    private int mPasses = 5;
+    private long mSeed = 1;
+
+    /* Serial to send (>= 0) or answer (~serial), in order */
+    private int[] mTrace;
+    private RILRequest[] mPool;
+    private int mErrors;
+
+    public static void
+    main(String[] args) {
+        PendingRequestsBench bench = new PendingRequestsBench();
+        if (!bench.parseArgs(args)) {
+            System.err.println("usage: pending-requests-bench [-n requests] [-w in flight]"
+                    + " [-p passes] [-s seed]");
+            System.exit(2);
+        }
+        bench.run();
+        System.exit(bench.mErrors == 0 ? 0 : 1);
+    }
+
+    private boolean
+    parseArgs(String[] args) {
+        try {
+            for (int i = 0; i < args.length; i++) {
+                String arg = args[i];
+                if (i + 1 == args.length) {
+                    return false;
+                }
+                String value = args[++i];
+                if (arg.equals("-n")) {
+                    mRequests = Integer.parseInt(value);
+                } else if (arg.equals("-w")) {
+                    mWindow = Integer.parseInt(value);
+                } else if (arg.equals("-p")) {
+                    mPasses = Integer.parseInt(value);
+                } else if (arg.equals("-s")) {
+                    mSeed = Long.parseLong(value);
+                } else {
+                    return false;
+                }
+            }
+        } catch (NumberFormatException e) {
+            return false;
+        }
+        return mRequests > 0 && mWindow > 0 && mPasses > 0;
+    }
+
+    private void
+    run() {
+        buildTrace();
+        System.out.println(mRequests + " requests, " + mWindow + " in flight, best of "
+                + mPasses + " passes");
+
+        long sparse = Long.MAX_VALUE;
+        long table = Long.MAX_VALUE;
+        long both = Long.MAX_VALUE;
+        for (int pass = 0; pass < mPasses; pass++) {
+            sparse = Math.min(sparse, runSparseArray());
+            table = Math.min(table, runTable());
+            both = Math.min(both, runSparseArrayAndTable());
+        }
+        report("sparsearray", sparse);
+        report("table", table);
+        report("sparse+table", both);
+        if (mErrors > 0) {
+            System.out.println(mErrors + " responses matched the wrong request");
+        }
+    }
+
+    private void
+    buildTrace() {
+        Random random = new Random(mSeed);
+        ArrayList<Integer> inFlight = new ArrayList<Integer>();
+        mTrace = new int[2 * mRequests];
+        mPool = new RILRequest[mRequests];
+        int t = 0;
+        int sent = 0;
+        while (sent < mRequests || !inFlight.isEmpty()) {
+            if (sent < mRequests && inFlight.size() < mWindow) {
+                mPool[sent] = new RILRequest(sent, RIL_REQUEST_SIM_IO);
+                inFlight.add(sent);
+                mTrace[t++] = sent++;
+                continue;
+            }
+            int i = random.nextInt(Math.min(OUT_OF_ORDER, inFlight.size()));
+            mTrace[t++] = ~inFlight.remove(i);
+        }
+    }
+
+    private void
+    check(RILRequest rr, int serial) {
+        if (rr == null || rr.mSerial != serial) {
+            mErrors++;
+        }
+    }
+
+    private long
+    runSparseArray() {
+        SparseArray<RILRequest> list = new SparseArray<RILRequest>();
+        long start = System.nanoTime();
+        for (int op : mTrace) {
+            if (op >= 0) {
+                list.append(op, mPool[op]);
+                continue;
+            }
+            int serial = ~op;
+            RILRequest rr = list.get(serial);
+            if (rr != null) {
+                list.remove(serial);
+            }
+            check(rr, serial);
+        }
+        return System.nanoTime() - start;
+    }
+
+    private long
+    runTable() {
+        SamsungExynos4PendingRequests pending = new SamsungExynos4PendingRequests();
+        long start = System.nanoTime();
+        for (int op : mTrace) {
+            if (op >= 0) {
+                pending.add(mPool[op], op, SamsungExynos4PendingRequests.NO_DEADLINE);
+                continue;
+            }
+            int serial = ~op;
+            check(pending.remove(serial), serial);
+        }
+        return System.nanoTime() - start;
+    }
+
+    private long
+    runSparseArrayAndTable() {
+        SamsungExynos4PendingRequests pending = new SamsungExynos4PendingRequests();
+        SparseArray<RILRequest> list = new SparseArray<RILRequest>();
+        long start = System.nanoTime();
+        for (int op : mTrace) {
+            if (op >= 0) {
+                pending.add(mPool[op], op, SamsungExynos4PendingRequests.NO_DEADLINE);
+                list.append(op, mPool[op]);
+                continue;
+            }
+            int serial = ~op;
+            if (pending.sentAt(serial) != serial) {
+                mErrors++;
+            }
+            pending.remove(serial);
+            RILRequest rr = list.get(serial);
+            if (rr != null) {
+                list.remove(serial);
+            }
+            check(rr, serial);
+        }
+        return System.nanoTime() - start;
+    }
+
+    private void
+    report(String name, long ns) {
+        System.out.printf("%-12s %8.1f ns/request %8.2f ms total%n",
+                name, (double) ns / mRequests, ns / 1e6);
+    }
+}
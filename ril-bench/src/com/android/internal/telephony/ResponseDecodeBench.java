@@ -0,0 +1,405 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import java.util.Random;
+
+/**
+ * Times how SamsungExynos4RIL picks the decoder for a solicited response.
+ *
+ * Usage: response-decode-bench [-n responses] [-p passes] [-s seed]
+ *
+ * Two ways are timed over the same random response mix, half of it
+ * SIM_IO (a phonebook or boot read) and the rest spread over every code
+ * the old switch knows:
+ *
+ *  switch  the processSolicited switch before the tables, reduced to the
+ *          decoder it picks: a lookupswitch over 1..10028
+ *  table   responseKind() and the dense switch over decoder kinds in
+ *          decodeResponse(), as SamsungExynos4RIL does now
+ *
+ * The tables are filled from the old switch, so both pick the same
+ * decoders; the Samsung codes the RIL's tables added aren't in the mix.
+ * Parcel decoding itself is the same either way and isn't timed. The
+ * best of -p passes counts.
+ */
+public final class ResponseDecodeBench {
+
+    private static final int SAMSUNG_REQUEST_BASE = 10000;
+    /* RILConstants isn't part of the host build */
+    private static final int RIL_REQUEST_SIM_IO = 28;
+
+    private static final byte RESPONSE_UNKNOWN = 0;
+    private static final byte RESPONSE_VOID = 1;
+    private static final byte RESPONSE_INTS = 2;
+    private static final byte RESPONSE_STRING = 3;
+    private static final byte RESPONSE_STRINGS = 4;
+    private static final byte RESPONSE_RAW = 5;
+    private static final byte RESPONSE_ICC_CARD_STATUS = 6;
+    private static final byte RESPONSE_ICC_IO = 7;
+    private static final byte RESPONSE_ICC_IO_BASE64 = 8;
+    private static final byte RESPONSE_CALL_LIST = 9;
+    private static final byte RESPONSE_FAIL_CAUSE = 10;
+    private static final byte RESPONSE_SIGNAL_STRENGTH = 11;
+    private static final byte RESPONSE_SMS = 12;
+    private static final byte RESPONSE_SETUP_DATA_CALL = 13;
+    private static final byte RESPONSE_DATA_CALL_LIST = 14;
+    private static final byte RESPONSE_CALL_FORWARD = 15;
+    private static final byte RESPONSE_OPERATOR_INFOS = 16;
+    private static final byte RESPONSE_PREFERRED_NETWORK_TYPE = 17;
+    private static final byte RESPONSE_CELL_LIST = 18;
+    private static final byte RESPONSE_CELL_INFO_LIST = 19;
+    private static final byte RESPONSE_GSM_BROADCAST_CONFIG = 20;
+    private static final byte RESPONSE_CDMA_BROADCAST_CONFIG = 21;
+    private static final byte RESPONSE_HARDWARE_CONFIG = 22;
+    private static final byte RESPONSE_RADIO_CAPABILITY = 23;
+    private static final byte RESPONSE_LCE_STATUS = 24;
+    private static final byte RESPONSE_LCE_DATA = 25;
+    private static final byte RESPONSE_ACTIVITY_DATA = 26;
+
+    private final byte[] mAospResponseKinds = new byte[256];
+    private final byte[] mSamsungResponseKinds = new byte[64];
+
+    private int mResponses = 1000000;
+    private int mPasses = 5;
+    private long mSeed = 1;
+
+    /* Request code of each response, in order */
+    private int[] mTrace;
+    /* Sum of the decoder kinds over the trace, the same for every pass */
+    private long mExpected = -1;
+    private int mErrors;
+
+    public static void
+    main(String[] args) {
+        ResponseDecodeBench bench = new ResponseDecodeBench();
+        if (!bench.parseArgs(args)) {
+            System.err.println("usage: response-decode-bench [-n responses] [-p passes]"
+                    + " [-s seed]");
+            System.exit(2);
+        }
+        bench.run();
+        System.exit(bench.mErrors == 0 ? 0 : 1);
+    }
+
+    private boolean
+    parseArgs(String[] args) {
+        try {
+            for (int i = 0; i < args.length; i++) {
+                String arg = args[i];
+                if (i + 1 == args.length) {
+                    return false;
+                }
+                String value = args[++i];
+                if (arg.equals("-n")) {
+                    mResponses = Integer.parseInt(value);
+                } else if (arg.equals("-p")) {
+                    mPasses = Integer.parseInt(value);
+                } else if (arg.equals("-s")) {
+                    mSeed = Long.parseLong(value);
+                } else {
+                    return false;
+                }
+            }
+        } catch (NumberFormatException e) {
+            return false;
+        }
+        return mResponses > 0 && mPasses > 0;
+    }
+
+    private void
+    run() {
+        buildTables();
+        buildTrace();
+        System.out.println(mResponses + " responses, best of " + mPasses + " passes");
+
+        long sw = Long.MAX_VALUE;
+        long table = Long.MAX_VALUE;
+        for (int pass = 0; pass < mPasses; pass++) {
+            sw = Math.min(sw, runSwitch());
+            table = Math.min(table, runTable());
+        }
+        report("switch", sw);
+        report("table", table);
+        if (mErrors > 0) {
+            System.out.println(mErrors + " passes picked a different decoder");
+        }
+    }
+
+    private void
+    buildTables() {
+        for (int i = 0; i < mAospResponseKinds.length; i++) {
+            mAospResponseKinds[i] = (byte) switchKind(i);
+        }
+        for (int i = 0; i < mSamsungResponseKinds.length; i++) {
+            mSamsungResponseKinds[i] = (byte) switchKind(SAMSUNG_REQUEST_BASE + i);
+        }
+    }
+
+    private void
+    buildTrace() {
+        int[] codes = new int[mAospResponseKinds.length + mSamsungResponseKinds.length];
+        int count = 0;
+        for (int i = 0; i < mAospResponseKinds.length; i++) {
+            if (mAospResponseKinds[i] != RESPONSE_UNKNOWN) {
+                codes[count++] = i;
+            }
+        }
+        for (int i = 0; i < mSamsungResponseKinds.length; i++) {
+            if (mSamsungResponseKinds[i] != RESPONSE_UNKNOWN) {
+                codes[count++] = SAMSUNG_REQUEST_BASE + i;
+            }
+        }
+
+        Random random = new Random(mSeed);
+        mTrace = new int[mResponses];
+        for (int i = 0; i < mResponses; i++) {
+            mTrace[i] = random.nextBoolean() ? RIL_REQUEST_SIM_IO : codes[random.nextInt(count)];
+        }
+    }
+
+    private long
+    runSwitch() {
+        long sum = 0;
+        long start = System.nanoTime();
+        for (int request : mTrace) {
+            sum += switchKind(request);
+        }
+        long ns = System.nanoTime() - start;
+        check(sum);
+        return ns;
+    }
+
+    private long
+    runTable() {
+        long sum = 0;
+        long start = System.nanoTime();
+        for (int request : mTrace) {
+            sum += decodeResponse(responseKind(request));
+        }
+        long ns = System.nanoTime() - start;
+        check(sum);
+        return ns;
+    }
+
+    private void
+    check(long sum) {
+        if (mExpected < 0) {
+            mExpected = sum;
+        } else if (sum != mExpected) {
+            mErrors++;
+        }
+    }
+
+    private int
+    responseKind(int request) {
+        if (request >= 0 && request < mAospResponseKinds.length) {
+            return mAospResponseKinds[request];
+        }
+        int index = request - SAMSUNG_REQUEST_BASE;
+        if (index >= 0 && index < mSamsungResponseKinds.length) {
+            return mSamsungResponseKinds[index];
+        }
+        return RESPONSE_UNKNOWN;
+    }
+
+    /* Stands in for decodeResponse(), one case per decoder */
+    private static int
+    decodeResponse(int kind) {
+        switch (kind) {
+            case RESPONSE_VOID: return RESPONSE_VOID;
+            case RESPONSE_INTS: return RESPONSE_INTS;
+            case RESPONSE_STRING: return RESPONSE_STRING;
+            case RESPONSE_STRINGS: return RESPONSE_STRINGS;
+            case RESPONSE_RAW: return RESPONSE_RAW;
+            case RESPONSE_ICC_CARD_STATUS: return RESPONSE_ICC_CARD_STATUS;
+            case RESPONSE_ICC_IO: return RESPONSE_ICC_IO;
+            case RESPONSE_ICC_IO_BASE64: return RESPONSE_ICC_IO_BASE64;
+            case RESPONSE_CALL_LIST: return RESPONSE_CALL_LIST;
+            case RESPONSE_FAIL_CAUSE: return RESPONSE_FAIL_CAUSE;
+            case RESPONSE_SIGNAL_STRENGTH: return RESPONSE_SIGNAL_STRENGTH;
+            case RESPONSE_SMS: return RESPONSE_SMS;
+            case RESPONSE_SETUP_DATA_CALL: return RESPONSE_SETUP_DATA_CALL;
+            case RESPONSE_DATA_CALL_LIST: return RESPONSE_DATA_CALL_LIST;
+            case RESPONSE_CALL_FORWARD: return RESPONSE_CALL_FORWARD;
+            case RESPONSE_OPERATOR_INFOS: return RESPONSE_OPERATOR_INFOS;
+            case RESPONSE_PREFERRED_NETWORK_TYPE: return RESPONSE_PREFERRED_NETWORK_TYPE;
+            case RESPONSE_CELL_LIST: return RESPONSE_CELL_LIST;
+            case RESPONSE_CELL_INFO_LIST: return RESPONSE_CELL_INFO_LIST;
+            case RESPONSE_GSM_BROADCAST_CONFIG: return RESPONSE_GSM_BROADCAST_CONFIG;
+            case RESPONSE_CDMA_BROADCAST_CONFIG: return RESPONSE_CDMA_BROADCAST_CONFIG;
+            case RESPONSE_HARDWARE_CONFIG: return RESPONSE_HARDWARE_CONFIG;
+            case RESPONSE_RADIO_CAPABILITY: return RESPONSE_RADIO_CAPABILITY;
+            case RESPONSE_LCE_STATUS: return RESPONSE_LCE_STATUS;
+            case RESPONSE_LCE_DATA: return RESPONSE_LCE_DATA;
+            case RESPONSE_ACTIVITY_DATA: return RESPONSE_ACTIVITY_DATA;
+            default: return RESPONSE_UNKNOWN;
+        }
+    }
+
+    /*
+     * The processSolicited switch from before the tables, with the
+     * constants resolved and each decoder call replaced by its kind.
+     */
+    private static int
+    switchKind(int request) {
+        switch (request) {
+            case 1: return RESPONSE_ICC_CARD_STATUS; // GET_SIM_STATUS
+            case 2: return RESPONSE_INTS; // ENTER_SIM_PIN
+            case 3: return RESPONSE_INTS; // ENTER_SIM_PUK
+            case 4: return RESPONSE_INTS; // ENTER_SIM_PIN2
+            case 5: return RESPONSE_INTS; // ENTER_SIM_PUK2
+            case 6: return RESPONSE_INTS; // CHANGE_SIM_PIN
+            case 7: return RESPONSE_INTS; // CHANGE_SIM_PIN2
+            case 8: return RESPONSE_INTS; // ENTER_NETWORK_DEPERSONALIZATION
+            case 9: return RESPONSE_CALL_LIST; // GET_CURRENT_CALLS
+            case 10: return RESPONSE_VOID; // DIAL
+            case 10016: return RESPONSE_VOID; // DIAL_EMERGENCY
+            case 11: return RESPONSE_STRING; // GET_IMSI
+            case 12: return RESPONSE_VOID; // HANGUP
+            case 13: return RESPONSE_VOID; // HANGUP_WAITING_OR_BACKGROUND
+            case 14: return RESPONSE_VOID; // HANGUP_FOREGROUND_RESUME_BACKGROUND
+            case 15: return RESPONSE_VOID; // SWITCH_WAITING_OR_HOLDING_AND_ACTIVE
+            case 16: return RESPONSE_VOID; // CONFERENCE
+            case 17: return RESPONSE_VOID; // UDUB
+            case 18: return RESPONSE_FAIL_CAUSE; // LAST_CALL_FAIL_CAUSE
+            case 19: return RESPONSE_SIGNAL_STRENGTH; // SIGNAL_STRENGTH
+            case 20: return RESPONSE_STRINGS; // VOICE_REGISTRATION_STATE
+            case 21: return RESPONSE_STRINGS; // DATA_REGISTRATION_STATE
+            case 22: return RESPONSE_STRINGS; // OPERATOR
+            case 23: return RESPONSE_VOID; // RADIO_POWER
+            case 24: return RESPONSE_VOID; // DTMF
+            case 25: return RESPONSE_SMS; // SEND_SMS
+            case 26: return RESPONSE_SMS; // SEND_SMS_EXPECT_MORE
+            case 27: return RESPONSE_SETUP_DATA_CALL; // SETUP_DATA_CALL
+            case 28: return RESPONSE_ICC_IO; // SIM_IO
+            case 29: return RESPONSE_VOID; // SEND_USSD
+            case 30: return RESPONSE_VOID; // CANCEL_USSD
+            case 31: return RESPONSE_INTS; // GET_CLIR
+            case 32: return RESPONSE_VOID; // SET_CLIR
+            case 33: return RESPONSE_CALL_FORWARD; // QUERY_CALL_FORWARD_STATUS
+            case 34: return RESPONSE_VOID; // SET_CALL_FORWARD
+            case 35: return RESPONSE_INTS; // QUERY_CALL_WAITING
+            case 36: return RESPONSE_VOID; // SET_CALL_WAITING
+            case 37: return RESPONSE_VOID; // SMS_ACKNOWLEDGE
+            case 38: return RESPONSE_STRING; // GET_IMEI
+            case 39: return RESPONSE_STRING; // GET_IMEISV
+            case 40: return RESPONSE_VOID; // ANSWER
+            case 41: return RESPONSE_VOID; // DEACTIVATE_DATA_CALL
+            case 42: return RESPONSE_INTS; // QUERY_FACILITY_LOCK
+            case 43: return RESPONSE_INTS; // SET_FACILITY_LOCK
+            case 44: return RESPONSE_VOID; // CHANGE_BARRING_PASSWORD
+            case 45: return RESPONSE_INTS; // QUERY_NETWORK_SELECTION_MODE
+            case 46: return RESPONSE_VOID; // SET_NETWORK_SELECTION_AUTOMATIC
+            case 47: return RESPONSE_VOID; // SET_NETWORK_SELECTION_MANUAL
+            case 48: return RESPONSE_OPERATOR_INFOS; // QUERY_AVAILABLE_NETWORKS
+            case 49: return RESPONSE_VOID; // DTMF_START
+            case 50: return RESPONSE_VOID; // DTMF_STOP
+            case 51: return RESPONSE_STRING; // BASEBAND_VERSION
+            case 52: return RESPONSE_VOID; // SEPARATE_CONNECTION
+            case 53: return RESPONSE_VOID; // SET_MUTE
+            case 54: return RESPONSE_INTS; // GET_MUTE
+            case 55: return RESPONSE_INTS; // QUERY_CLIP
+            case 56: return RESPONSE_INTS; // LAST_DATA_CALL_FAIL_CAUSE
+            case 57: return RESPONSE_DATA_CALL_LIST; // DATA_CALL_LIST
+            case 58: return RESPONSE_VOID; // RESET_RADIO
+            case 59: return RESPONSE_RAW; // OEM_HOOK_RAW
+            case 60: return RESPONSE_STRINGS; // OEM_HOOK_STRINGS
+            case 61: return RESPONSE_VOID; // SCREEN_STATE
+            case 62: return RESPONSE_VOID; // SET_SUPP_SVC_NOTIFICATION
+            case 63: return RESPONSE_INTS; // WRITE_SMS_TO_SIM
+            case 64: return RESPONSE_VOID; // DELETE_SMS_ON_SIM
+            case 65: return RESPONSE_VOID; // SET_BAND_MODE
+            case 66: return RESPONSE_INTS; // QUERY_AVAILABLE_BAND_MODE
+            case 67: return RESPONSE_STRING; // STK_GET_PROFILE
+            case 68: return RESPONSE_VOID; // STK_SET_PROFILE
+            case 69: return RESPONSE_STRING; // STK_SEND_ENVELOPE_COMMAND
+            case 70: return RESPONSE_VOID; // STK_SEND_TERMINAL_RESPONSE
+            case 71: return RESPONSE_INTS; // STK_HANDLE_CALL_SETUP_REQUESTED_FROM_SIM
+            case 72: return RESPONSE_VOID; // EXPLICIT_CALL_TRANSFER
+            case 73: return RESPONSE_VOID; // SET_PREFERRED_NETWORK_TYPE
+            case 74: return RESPONSE_PREFERRED_NETWORK_TYPE; // GET_PREFERRED_NETWORK_TYPE
+            case 75: return RESPONSE_CELL_LIST; // GET_NEIGHBORING_CELL_IDS
+            case 76: return RESPONSE_VOID; // SET_LOCATION_UPDATES
+            case 77: return RESPONSE_VOID; // CDMA_SET_SUBSCRIPTION_SOURCE
+            case 78: return RESPONSE_VOID; // CDMA_SET_ROAMING_PREFERENCE
+            case 79: return RESPONSE_INTS; // CDMA_QUERY_ROAMING_PREFERENCE
+            case 80: return RESPONSE_VOID; // SET_TTY_MODE
+            case 81: return RESPONSE_INTS; // QUERY_TTY_MODE
+            case 82: return RESPONSE_VOID; // CDMA_SET_PREFERRED_VOICE_PRIVACY_MODE
+            case 83: return RESPONSE_INTS; // CDMA_QUERY_PREFERRED_VOICE_PRIVACY_MODE
+            case 84: return RESPONSE_VOID; // CDMA_FLASH
+            case 85: return RESPONSE_VOID; // CDMA_BURST_DTMF
+            case 87: return RESPONSE_SMS; // CDMA_SEND_SMS
+            case 88: return RESPONSE_VOID; // CDMA_SMS_ACKNOWLEDGE
+            case 89: return RESPONSE_GSM_BROADCAST_CONFIG; // GSM_GET_BROADCAST_CONFIG
+            case 90: return RESPONSE_VOID; // GSM_SET_BROADCAST_CONFIG
+            case 91: return RESPONSE_VOID; // GSM_BROADCAST_ACTIVATION
+            case 92: return RESPONSE_CDMA_BROADCAST_CONFIG; // CDMA_GET_BROADCAST_CONFIG
+            case 93: return RESPONSE_VOID; // CDMA_SET_BROADCAST_CONFIG
+            case 94: return RESPONSE_VOID; // CDMA_BROADCAST_ACTIVATION
+            case 86: return RESPONSE_VOID; // CDMA_VALIDATE_AND_WRITE_AKEY
+            case 95: return RESPONSE_STRINGS; // CDMA_SUBSCRIPTION
+            case 96: return RESPONSE_INTS; // CDMA_WRITE_SMS_TO_RUIM
+            case 97: return RESPONSE_VOID; // CDMA_DELETE_SMS_ON_RUIM
+            case 98: return RESPONSE_STRINGS; // DEVICE_IDENTITY
+            case 100: return RESPONSE_STRING; // GET_SMSC_ADDRESS
+            case 101: return RESPONSE_VOID; // SET_SMSC_ADDRESS
+            case 99: return RESPONSE_VOID; // EXIT_EMERGENCY_CALLBACK_MODE
+            case 102: return RESPONSE_VOID; // REPORT_SMS_MEMORY_STATUS
+            case 103: return RESPONSE_VOID; // REPORT_STK_SERVICE_IS_RUNNING
+            case 104: return RESPONSE_INTS; // CDMA_GET_SUBSCRIPTION_SOURCE
+            case 105: return RESPONSE_STRING; // ISIM_AUTHENTICATION
+            case 106: return RESPONSE_VOID; // ACKNOWLEDGE_INCOMING_GSM_SMS_WITH_PDU
+            case 107: return RESPONSE_ICC_IO; // STK_SEND_ENVELOPE_WITH_STATUS
+            case 108: return RESPONSE_INTS; // VOICE_RADIO_TECH
+            case 109: return RESPONSE_CELL_INFO_LIST; // GET_CELL_INFO_LIST
+            case 110: return RESPONSE_VOID; // SET_UNSOL_CELL_INFO_LIST_RATE
+            case 111: return RESPONSE_VOID; // SET_INITIAL_ATTACH_APN
+            case 128: return RESPONSE_VOID; // SET_DATA_PROFILE
+            case 112: return RESPONSE_INTS; // IMS_REGISTRATION_STATE
+            case 113: return RESPONSE_SMS; // IMS_SEND_SMS
+            case 114: return RESPONSE_ICC_IO; // SIM_TRANSMIT_APDU_BASIC
+            case 10027: return RESPONSE_INTS; // SIM_OPEN_CHANNEL
+            case 10028: return RESPONSE_VOID; // SIM_CLOSE_CHANNEL
+            case 117: return RESPONSE_ICC_IO; // SIM_TRANSMIT_APDU_CHANNEL
+            case 118: return RESPONSE_STRING; // NV_READ_ITEM
+            case 119: return RESPONSE_VOID; // NV_WRITE_ITEM
+            case 120: return RESPONSE_VOID; // NV_WRITE_CDMA_PRL
+            case 121: return RESPONSE_VOID; // NV_RESET_CONFIG
+            case 122: return RESPONSE_VOID; // SET_UICC_SUBSCRIPTION
+            case 123: return RESPONSE_VOID; // ALLOW_DATA
+            case 124: return RESPONSE_HARDWARE_CONFIG; // GET_HARDWARE_CONFIG
+            case 125: return RESPONSE_ICC_IO_BASE64; // SIM_AUTHENTICATION
+            case 129: return RESPONSE_VOID; // SHUTDOWN
+            case 130: return RESPONSE_RADIO_CAPABILITY; // GET_RADIO_CAPABILITY
+            case 131: return RESPONSE_RADIO_CAPABILITY; // SET_RADIO_CAPABILITY
+            case 132: return RESPONSE_LCE_STATUS; // START_LCE
+            case 133: return RESPONSE_LCE_STATUS; // STOP_LCE
+            case 134: return RESPONSE_LCE_DATA; // PULL_LCEDATA
+            case 135: return RESPONSE_ACTIVITY_DATA; // GET_ACTIVITY_INFO
+            case 136: return RESPONSE_STRING; // SIM_GET_ATR
+            default: return RESPONSE_UNKNOWN;
+        }
+    }
+
+    private void
+    report(String name, long ns) {
+        System.out.printf("%-8s %8.2f ns/response %8.2f ms total%n",
+                name, (double) ns / mResponses, ns / 1e6);
+    }
+}
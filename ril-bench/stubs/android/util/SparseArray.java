@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package android.util;
+
+import java.util.Arrays;
+
+/**
+ * Host stand-in for the framework SparseArray: sorted keys, binary search,
+ * append() at the end for increasing keys. Deletion compacts right away
+ * instead of leaving DELETED markers for a later gc(), which only makes
+ * remove() slower than the real one.
+ */
+public class SparseArray<E> {
+    private int[] mKeys = new int[16];
+    private Object[] mValues = new Object[16];
+    private int mSize;
+
+    public int size() {
+        return mSize;
+    }
+
+    public int keyAt(int index) {
+        return mKeys[index];
+    }
+
+    @SuppressWarnings("unchecked")
+    public E valueAt(int index) {
+        return (E) mValues[index];
+    }
+
+    public int indexOfKey(int key) {
+        return Arrays.binarySearch(mKeys, 0, mSize, key);
+    }
+
+    public E get(int key) {
+        int i = indexOfKey(key);
+        return i < 0 ? null : valueAt(i);
+    }
+
+    public void put(int key, E value) {
+        int i = indexOfKey(key);
+        if (i >= 0) {
+            mValues[i] = value;
+            return;
+        }
+        i = ~i;
+        ensureCapacity();
+        System.arraycopy(mKeys, i, mKeys, i + 1, mSize - i);
+        System.arraycopy(mValues, i, mValues, i + 1, mSize - i);
+        mKeys[i] = key;
+        mValues[i] = value;
+        mSize++;
+    }
+
+    public void append(int key, E value) {
+        if (mSize > 0 && key <= mKeys[mSize - 1]) {
+            put(key, value);
+            return;
+        }
+        ensureCapacity();
+        mKeys[mSize] = key;
+        mValues[mSize] = value;
+        mSize++;
+    }
+
+    public void remove(int key) {
+        int i = indexOfKey(key);
+        if (i >= 0) {
+            removeAt(i);
+        }
+    }
+
+    public void removeAt(int index) {
+        System.arraycopy(mKeys, index + 1, mKeys, index, mSize - index - 1);
+        System.arraycopy(mValues, index + 1, mValues, index, mSize - index - 1);
+        mSize--;
+        mValues[mSize] = null;
+    }
+
+    private void ensureCapacity() {
+        if (mSize == mKeys.length) {
+            mKeys = Arrays.copyOf(mKeys, mSize * 2);
+            mValues = Arrays.copyOf(mValues, mSize * 2);
+        }
+    }
+}
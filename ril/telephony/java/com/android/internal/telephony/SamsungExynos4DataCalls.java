@@ -0,0 +1,501 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import static com.android.internal.telephony.RILConstants.*;
+
+import android.os.Parcel;
+import android.telephony.Rlog;
+import android.util.SparseArray;
+import android.util.SparseIntArray;
+import android.util.SparseLongArray;
+
+import com.android.internal.telephony.dataconnection.DataCallResponse;
+
+import java.io.PrintWriter;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.List;
+
+/**
+ * Orders PDP context activations and keeps track of the contexts.
+ *
+ * DcTracker brings each APN context (mobile, mms, supl, dun, hipri) up
+ * with its own DataConnection, so several SETUP_DATA_CALLs can be wanted at
+ * once. The modem is given mLimit of them at a time; the rest wait here
+ * instead of on the rild socket, where they could only be worked through
+ * in arrival order. Setups for the APNs in mPriorityApns (typically an
+ * operator's dedicated SUPL APN) go ahead of the others, so a GPS fix does
+ * not wait for MMS or DUN to come up.
+ *
+ * With early attach on, Samsung's PS_ATTACH is sent as soon as the radio
+ * is on, so the first activation doesn't have to wait for the attach.
+ *
+ * Every context the modem reports is kept by cid, as the DataCallResponse
+ * (RIL_Data_Call_Response_v11) it last reported.
+ *
+ * RIL_UNSOL_DATA_CALL_LIST_CHANGED always carries the full list, and
+ * DcController rebuilds the link properties of every context in it. Lists
+ * are diffed against the previous one record by record (raw parcel bytes,
+ * by cid): records that haven't changed keep their DataCallResponse
+ * instead of having their addresses, DNS servers and gateways parsed
+ * again, and an unsol in which nothing was added, removed or changed
+ * isn't passed on at all.
+ */
+final class SamsungExynos4DataCalls {
+
+    /* In-flight setups RIL doesn't know about after this long were lost */
+    private static final long LOST_REQUEST_GRACE_MS = 5000;
+
+    /* RIL_RadioState */
+    private static final int RADIO_STATE_ON = 10;
+
+    /* Oldest and newest RIL_Data_Call_Response layouts we can diff */
+    private static final int DATA_CALL_MIN_VERSION = 5;
+    private static final int DATA_CALL_MAX_VERSION = 11;
+    /* Sanity limit, the CP has far fewer contexts */
+    private static final int MAX_DATA_CALLS = 16;
+
+    /** A decoded data call list and what changed since the last one */
+    static final class DataCallList {
+        final ArrayList<DataCallResponse> mList;
+        final boolean mChanged;
+
+        DataCallList(ArrayList<DataCallResponse> list, boolean changed) {
+            mList = list;
+            mChanged = changed;
+        }
+    }
+
+    private static final class Reported {
+        final byte[] mRaw;
+        final DataCallResponse mResponse;
+
+        Reported(byte[] raw, DataCallResponse response) {
+            mRaw = raw;
+            mResponse = response;
+        }
+    }
+
+    private static final class Held {
+        final RILRequest mRequest;
+        final boolean mPriority;
+        final long mSentAt;
+
+        Held(RILRequest rr, boolean priority, long sentAt) {
+            mRequest = rr;
+            mPriority = priority;
+            mSentAt = sentAt;
+        }
+    }
+
+    private final SamsungExynos4RequestScheduler.Dispatcher mDispatcher;
+    private final int mLimit;
+    private final List<String> mPriorityApns;
+    private final boolean mEarlyAttach;
+
+    /* serial -> time sent, for the setups in flight */
+    private final SparseLongArray mInFlight = new SparseLongArray();
+    private final ArrayList<Held> mQueue = new ArrayList<Held>();
+    /* serial -> cid, for the deactivations in flight */
+    private final SparseIntArray mDeactivating = new SparseIntArray();
+    private final SparseArray<DataCallResponse> mContexts = new SparseArray<DataCallResponse>();
+    /* cid -> record in the last data call list, null before the first */
+    private SparseArray<Reported> mReported;
+
+    private boolean mRadioOn;
+    private boolean mAttachSent;
+
+    private long mSetups;
+    private long mHeld;
+    private long mPrioritized;
+    private long mLost;
+    private long mAttaches;
+    private long mLists;
+    private long mUnchangedLists;
+    private long mReused;
+    private long mAdded;
+    private long mRemoved;
+    private long mChanged;
+
+    SamsungExynos4DataCalls(SamsungExynos4RequestScheduler.Dispatcher dispatcher, int limit,
+            String priorityApns, boolean earlyAttach) {
+        mDispatcher = dispatcher;
+        mLimit = Math.max(1, limit);
+        mPriorityApns = priorityApns.isEmpty()
+                ? new ArrayList<String>() : Arrays.asList(priorityApns.split(","));
+        mEarlyAttach = earlyAttach;
+    }
+
+    /**
+     * Called as SamsungExynos4RIL.send() takes rr, now is also what
+     * Dispatcher.dispatch() gets as the send time if rr is held.
+     *
+     * @return true if rr was held back, false if the caller should send it
+     *         now
+     */
+    synchronized boolean
+    submit(RILRequest rr, long now) {
+        switch (rr.mRequest) {
+            case RIL_REQUEST_SETUP_DATA_CALL:
+                break;
+            case RIL_REQUEST_DEACTIVATE_DATA_CALL: {
+                int cid = deactivateCid(rr.mParcel);
+                if (cid >= 0) {
+                    mDeactivating.put(rr.mSerial, cid);
+                }
+                return false;
+            }
+            default:
+                return false;
+        }
+
+        mSetups++;
+        if (mQueue.isEmpty() && setupAllowed(now)) {
+            mInFlight.put(rr.mSerial, now);
+            return false;
+        }
+
+        String apn = setupApn(rr.mParcel);
+        boolean priority = apn != null && mPriorityApns.contains(apn);
+        int at = mQueue.size();
+        if (priority) {
+            // Behind earlier priority setups, ahead of everything else.
+            at = 0;
+            while (at < mQueue.size() && mQueue.get(at).mPriority) {
+                at++;
+            }
+            if (at < mQueue.size()) {
+                mPrioritized++;
+            }
+        }
+        mQueue.add(at, new Held(rr, priority, now));
+        mHeld++;
+        return true;
+    }
+
+    /**
+     * serial got its answer (or was given up on), update the contexts and
+     * send whatever that lets through.
+     *
+     * @return see drain()
+     */
+    synchronized long
+    complete(int serial, int error, long now) {
+        mInFlight.delete(serial);
+        int i = mDeactivating.indexOfKey(serial);
+        if (i >= 0) {
+            if (error == 0) {
+                mContexts.remove(mDeactivating.valueAt(i));
+            }
+            mDeactivating.removeAt(i);
+        }
+        return drain(now);
+    }
+
+    /**
+     * Send the held back setups that may go now.
+     *
+     * @return when to look again for lost setups holding the others back,
+     *         or -1 if none is held back
+     */
+    synchronized long
+    drain(long now) {
+        while (!mQueue.isEmpty()) {
+            if (!setupAllowed(now)) {
+                return now + LOST_REQUEST_GRACE_MS;
+            }
+            Held held = mQueue.remove(0);
+            mInFlight.put(held.mRequest.mSerial, now);
+            mDispatcher.dispatch(held.mRequest, held.mSentAt);
+        }
+        return -1;
+    }
+
+    /** A successful answer to request */
+    synchronized void
+    onResult(int request, Object ret) {
+        if (request == RIL_REQUEST_SETUP_DATA_CALL) {
+            DataCallResponse dcr = (DataCallResponse) ret;
+            if (dcr.status == 0 && dcr.cid >= 0) {
+                mContexts.put(dcr.cid, dcr);
+            }
+        }
+    }
+
+    /**
+     * Decode a data call list (RIL_UNSOL_DATA_CALL_LIST_CHANGED, or the
+     * answer to DATA_CALL_LIST) at p and make it the current one.
+     */
+    synchronized DataCallList
+    decodeDataCallList(RIL ril, Parcel p) {
+        int start = p.dataPosition();
+        int[] cids = null;
+        byte[][] raws = null;
+
+        int[] bounds = recordBounds(p);
+        if (bounds != null) {
+            int count = bounds.length / 2;
+            byte[] data = p.marshall();
+            cids = new int[count];
+            raws = new byte[count][];
+            for (int i = 0; i < count; i++) {
+                raws[i] = Arrays.copyOfRange(data, bounds[2 * i], bounds[2 * i + 1]);
+                // status, suggestedRetryTime, cid
+                cids[i] = readInt(raws[i], 8);
+            }
+        }
+
+        ArrayList<DataCallResponse> list = null;
+        if (raws != null && mReported != null && raws.length == mReported.size()) {
+            list = new ArrayList<DataCallResponse>(raws.length);
+            for (int i = 0; i < raws.length; i++) {
+                Reported old = mReported.get(cids[i]);
+                if (old == null || !Arrays.equals(old.mRaw, raws[i])) {
+                    list = null;
+                    break;
+                }
+                list.add(old.mResponse);
+            }
+        }
+
+        boolean changed;
+        mLists++;
+        if (list != null) {
+            // recordBounds() left p past the list.
+            mReused += list.size();
+            changed = false;
+        } else {
+            p.setDataPosition(start);
+            list = asList(ril.responseDataCallList(p));
+            changed = diff(cids, raws, list);
+        }
+        if (!changed) {
+            mUnchangedLists++;
+        }
+
+        mContexts.clear();
+        for (DataCallResponse dcr : list) {
+            mContexts.put(dcr.cid, dcr);
+        }
+        return new DataCallList(list, changed);
+    }
+
+    /**
+     * The radio state changed.
+     *
+     * @return whether the caller should send PS_ATTACH now
+     */
+    synchronized boolean
+    onRadioState(int state) {
+        boolean on = state == RADIO_STATE_ON;
+        if (!on) {
+            // The modem drops its contexts with the radio.
+            mContexts.clear();
+            mReported = null;
+            mAttachSent = false;
+        }
+        mRadioOn = on;
+        if (on && mEarlyAttach && !mAttachSent) {
+            mAttachSent = true;
+            mAttaches++;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * The socket went away, forget the setups and deactivations in flight.
+     *
+     * @return the setups held back, for the caller to fail
+     */
+    synchronized ArrayList<RILRequest>
+    clear() {
+        ArrayList<RILRequest> held = new ArrayList<RILRequest>(mQueue.size());
+        for (Held h : mQueue) {
+            held.add(h.mRequest);
+        }
+        mQueue.clear();
+        mInFlight.clear();
+        mDeactivating.clear();
+        return held;
+    }
+
+    synchronized void
+    dump(PrintWriter pw) {
+        pw.println(" mDataCalls limit=" + mLimit + " priorityApns=" + mPriorityApns
+                + " earlyAttach=" + mEarlyAttach + " setups=" + mSetups + " held=" + mHeld
+                + " prioritized=" + mPrioritized + " lost=" + mLost
+                + " attaches=" + mAttaches + " inFlight=" + mInFlight.size()
+                + " queued=" + mQueue.size() + " radioOn=" + mRadioOn);
+        pw.println("  lists=" + mLists + " unchanged=" + mUnchangedLists + " reused=" + mReused
+                + " added=" + mAdded + " removed=" + mRemoved + " changed=" + mChanged);
+        for (int i = 0; i < mContexts.size(); i++) {
+            pw.println("  " + mContexts.valueAt(i));
+        }
+    }
+
+    /*
+     * Make list the last reported one and count what changed. cids and raws
+     * describe its records, or are null if recordBounds() couldn't tell.
+     *
+     * @return whether any context was added, removed or changed
+     */
+    private boolean
+    diff(int[] cids, byte[][] raws, ArrayList<DataCallResponse> list) {
+        boolean first = mReported == null;
+        SparseArray<Reported> reported = new SparseArray<Reported>();
+        int added = 0;
+        int changed = 0;
+        for (int i = 0; i < list.size(); i++) {
+            DataCallResponse dcr = list.get(i);
+            byte[] raw = raws != null && cids[i] == dcr.cid ? raws[i] : null;
+            Reported old = mReported != null ? mReported.get(dcr.cid) : null;
+            if (old == null) {
+                added++;
+            } else if (raw == null || !Arrays.equals(old.mRaw, raw)) {
+                changed++;
+            }
+            reported.put(dcr.cid, new Reported(raw, dcr));
+        }
+        int removed = 0;
+        for (int i = 0; mReported != null && i < mReported.size(); i++) {
+            if (reported.get(mReported.keyAt(i)) == null) {
+                removed++;
+            }
+        }
+        mReported = reported;
+
+        mAdded += added;
+        mRemoved += removed;
+        mChanged += changed;
+        if (SamsungExynos4RIL.RILJ_LOGD && added + removed + changed > 0) {
+            Rlog.d(SamsungExynos4RIL.RILJ_LOG_TAG, "Data call list: " + added + " added, "
+                    + removed + " removed, " + changed + " changed");
+        }
+        // The first list always goes out, even if empty.
+        return first || added + removed + changed > 0;
+    }
+
+    private boolean
+    setupAllowed(long now) {
+        // Setups RIL failed itself (no socket, radio off) never reach
+        // complete(), forget them once RIL has.
+        for (int i = mInFlight.size() - 1; i >= 0; i--) {
+            if (now - mInFlight.valueAt(i) > LOST_REQUEST_GRACE_MS
+                    && !mDispatcher.isOutstanding(mInFlight.keyAt(i))) {
+                mInFlight.removeAt(i);
+                mLost++;
+            }
+        }
+        return mInFlight.size() < mLimit;
+    }
+
+    /* SETUP_DATA_CALL arguments: count, then tech, profile, apn, ... */
+    private static String
+    setupApn(Parcel p) {
+        int pos = p.dataPosition();
+        try {
+            p.setDataPosition(8);
+            if (p.readInt() < 3) {
+                return null;
+            }
+            p.readString(); // radio technology
+            p.readString(); // profile
+            return p.readString();
+        } finally {
+            p.setDataPosition(pos);
+        }
+    }
+
+    /*
+     * Skip over the data call list at p.
+     *
+     * @return start and end offset of each record, or null (and p
+     *         anywhere) if the list isn't laid out the way we expect
+     */
+    private static int[]
+    recordBounds(Parcel p) {
+        int version = p.readInt();
+        int count = p.readInt();
+        if (version < DATA_CALL_MIN_VERSION || version > DATA_CALL_MAX_VERSION
+                || count < 0 || count > MAX_DATA_CALLS) {
+            return null;
+        }
+        int[] bounds = new int[2 * count];
+        for (int i = 0; i < count; i++) {
+            bounds[2 * i] = p.dataPosition();
+            // status, suggestedRetryTime, cid, active
+            p.setDataPosition(p.dataPosition() + 4 * 4);
+            // type, ifname, addresses, dnses, gateways
+            for (int j = 0; j < 5; j++) {
+                skipString(p);
+            }
+            if (version >= 10) {
+                skipString(p); // pcscf
+            }
+            if (version >= 11) {
+                p.readInt(); // mtu
+            }
+            if (p.dataPosition() > p.dataSize()) {
+                return null;
+            }
+            bounds[2 * i + 1] = p.dataPosition();
+        }
+        return bounds;
+    }
+
+    /* Parcel String16: length in chars (-1 for null), then the chars and a
+     * terminating 0, padded to 4 bytes */
+    private static void
+    skipString(Parcel p) {
+        int length = p.readInt();
+        if (length >= 0) {
+            p.setDataPosition(p.dataPosition() + (((length + 1) * 2 + 3) & ~3));
+        }
+    }
+
+    private static int
+    readInt(byte[] data, int offset) {
+        // Parcels are little endian on this hardware.
+        return (data[offset] & 0xff) | (data[offset + 1] & 0xff) << 8
+                | (data[offset + 2] & 0xff) << 16 | (data[offset + 3] & 0xff) << 24;
+    }
+
+    @SuppressWarnings("unchecked")
+    private static ArrayList<DataCallResponse>
+    asList(Object ret) {
+        return (ArrayList<DataCallResponse>) ret;
+    }
+
+    /* DEACTIVATE_DATA_CALL arguments: count, then cid and reason */
+    private static int
+    deactivateCid(Parcel p) {
+        int pos = p.dataPosition();
+        try {
+            p.setDataPosition(8);
+            if (p.readInt() < 1) {
+                return -1;
+            }
+            return Integer.parseInt(p.readString());
+        } catch (NumberFormatException e) {
+            return -1;
+        } finally {
+            p.setDataPosition(pos);
+        }
+    }
+}
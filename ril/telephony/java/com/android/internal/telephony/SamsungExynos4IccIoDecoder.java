@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.os.Parcel;
+
+import com.android.internal.telephony.uicc.IccIoResult;
+
+/**
+ * Decodes RIL_SIM_IO_Response payloads straight out of the Parcel.
+ *
+ * The payload is a hex string, which RIL.responseICC_IO() reads into a
+ * String and then converts with IccUtils.hexStringToBytes(). A phonebook
+ * sync reads thousands of EF records this way and each one leaves an
+ * intermediate String (twice the size of the hex text) behind.
+ *
+ * libbinder writes a String16 as an int32 character count followed by the
+ * UTF-16 characters, a terminating NUL and padding up to a multiple of four
+ * bytes. On the little-endian targets we run on, every readInt() therefore
+ * returns two hex digits, which is one payload byte, and the only allocation
+ * left is the byte[] handed to IccIoResult.
+ */
+final class SamsungExynos4IccIoDecoder {
+
+    /* Hex digit -> nibble, -1 for anything else */
+    private static final byte[] sNibbles = new byte[128];
+
+    static {
+        for (int i = 0; i < sNibbles.length; i++) {
+            sNibbles[i] = -1;
+        }
+        for (int i = 0; i < 10; i++) {
+            sNibbles['0' + i] = (byte) i;
+        }
+        for (int i = 0; i < 6; i++) {
+            sNibbles['a' + i] = (byte) (10 + i);
+            sNibbles['A' + i] = (byte) (10 + i);
+        }
+    }
+
+    private SamsungExynos4IccIoDecoder() {
+    }
+
+    static IccIoResult
+    decode(Parcel p) {
+        int sw1 = p.readInt();
+        int sw2 = p.readInt();
+        int start = p.dataPosition();
+
+        if (p.readInt() < 0) {
+            // null String, IccIoResult keeps a null payload for it
+            return new IccIoResult(sw1, sw2, (byte[]) null);
+        }
+        p.setDataPosition(start);
+
+        byte[] payload = readHexPayload(p);
+        if (payload == null) {
+            // Not something we can take apart in place (odd length,
+            // non hex characters), let IccIoResult deal with it as before.
+            p.setDataPosition(start);
+            return new IccIoResult(sw1, sw2, p.readString());
+        }
+        return new IccIoResult(sw1, sw2, payload);
+    }
+
+    /**
+     * Read a String16 of hex digits at the current position into bytes and
+     * leave the Parcel positioned after it.
+     *
+     * @return the payload, or null if the string is not even length hex
+     *         (the position is then undefined)
+     */
+    private static byte[]
+    readHexPayload(Parcel p) {
+        int chars = p.readInt();
+        if ((chars & 1) != 0) {
+            return null;
+        }
+        // Characters plus NUL, padded to 4 bytes
+        int end = p.dataPosition() + (((chars + 1) * 2 + 3) & ~3);
+        if (end > p.dataSize()) {
+            return null;
+        }
+
+        final byte[] nibbles = sNibbles;
+        byte[] payload = new byte[chars / 2];
+        for (int i = 0; i < payload.length; i++) {
+            int pair = p.readInt();
+            int hi = pair & 0xffff;
+            int lo = pair >>> 16;
+            if (hi >= 128 || lo >= 128 || nibbles[hi] < 0 || nibbles[lo] < 0) {
+                return null;
+            }
+            payload[i] = (byte) ((nibbles[hi] << 4) | nibbles[lo]);
+        }
+        p.setDataPosition(end);
+        return payload;
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import static com.android.internal.telephony.RILConstants.*;
+
+import java.io.PrintWriter;
+
+/**
+ * Answers for requests that return fixed modem data (IMEI, IMEISV,
+ * baseband version, device identity). The first successful answer is
+ * kept until clear(), which SamsungExynos4RIL calls when the modem goes
+ * away.
+ *
+ * Samsung's serial number, manufacture date and barcode requests would
+ * belong here too, but their answers aren't decoded (see
+ * sSamsungResponseKinds), so there is nothing to keep.
+ *
+ * None of these requests take arguments, so the request code alone is
+ * the key.
+ */
+final class SamsungExynos4IdentityCache {
+
+    private static final int[] CACHEABLE = {
+        RIL_REQUEST_GET_IMEI,
+        RIL_REQUEST_GET_IMEISV,
+        RIL_REQUEST_BASEBAND_VERSION,
+        RIL_REQUEST_DEVICE_IDENTITY,
+    };
+
+    private final Object[] mAnswers = new Object[CACHEABLE.length];
+    private final int[] mHits = new int[CACHEABLE.length];
+    private int mClears;
+
+    static boolean
+    isCacheable(int request) {
+        return slot(request) >= 0;
+    }
+
+    /** @return the cached answer to request, or null */
+    synchronized Object
+    get(int request) {
+        int i = slot(request);
+        if (i < 0 || mAnswers[i] == null) {
+            return null;
+        }
+        mHits[i]++;
+        Object ret = mAnswers[i];
+        // Don't hand out our own array, callers are free to modify theirs.
+        return ret instanceof String[] ? ((String[]) ret).clone() : ret;
+    }
+
+    synchronized void
+    put(int request, Object ret) {
+        int i = slot(request);
+        if (i < 0 || !isUsable(ret)) {
+            return;
+        }
+        mAnswers[i] = ret instanceof String[] ? ((String[]) ret).clone() : ret;
+    }
+
+    synchronized void
+    clear() {
+        for (int i = 0; i < mAnswers.length; i++) {
+            mAnswers[i] = null;
+        }
+        mClears++;
+    }
+
+    synchronized void
+    dump(PrintWriter pw) {
+        StringBuilder sb = new StringBuilder(" mIdentityCache clears=" + mClears);
+        for (int i = 0; i < CACHEABLE.length; i++) {
+            sb.append(' ').append(SamsungExynos4RIL.requestToString(CACHEABLE[i]))
+                    .append(mAnswers[i] != null ? "=cached/" : "=empty/").append(mHits[i]);
+        }
+        pw.println(sb);
+    }
+
+    private static int
+    slot(int request) {
+        for (int i = 0; i < CACHEABLE.length; i++) {
+            if (CACHEABLE[i] == request) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /* The modem answers with empty strings until it has the data */
+    private static boolean
+    isUsable(Object ret) {
+        if (ret instanceof String) {
+            return !((String) ret).isEmpty();
+        }
+        if (ret instanceof String[]) {
+            for (String s : (String[]) ret) {
+                if (s != null && !s.isEmpty()) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import java.io.PrintWriter;
+import java.util.concurrent.atomic.AtomicLongArray;
+import java.util.concurrent.atomic.AtomicReferenceArray;
+
+/**
+ * Request latency histograms, one per request code, from send() to the
+ * solicited response.
+ *
+ * Buckets are log-linear: SUB_BUCKETS linear buckets per power of two of
+ * milliseconds, so every bucket is within 1/SUB_BUCKETS of its value and
+ * 0ms to MAX_MS fits in a few hundred longs. Histograms are allocated on a
+ * code's first sample and updated with atomics only, recording never
+ * blocks the receiver thread.
+ */
+final class SamsungExynos4LatencyHistograms {
+
+    private static final int SUB_BUCKET_BITS = 3;
+    private static final int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    /* Anything slower lands in the last bucket */
+    private static final int MAX_MS_BITS = 20;
+    private static final int BUCKETS = (MAX_MS_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    /* Per histogram totals, stored after the buckets */
+    private static final int COUNT = BUCKETS;
+    private static final int SUM = BUCKETS + 1;
+    private static final int MAX = BUCKETS + 2;
+    private static final int SLOTS = BUCKETS + 3;
+
+    private static final int AOSP_CODES = 256;
+    private static final int SAMSUNG_CODES = 64;
+
+    private final AtomicReferenceArray<AtomicLongArray> mHistograms =
+            new AtomicReferenceArray<AtomicLongArray>(AOSP_CODES + SAMSUNG_CODES);
+
+    void
+    record(int request, long latencyMs) {
+        int index = histogramIndex(request);
+        if (index < 0 || latencyMs < 0) {
+            return;
+        }
+
+        AtomicLongArray h = mHistograms.get(index);
+        if (h == null) {
+            mHistograms.compareAndSet(index, null, new AtomicLongArray(SLOTS));
+            h = mHistograms.get(index);
+        }
+
+        h.incrementAndGet(bucket(latencyMs));
+        h.incrementAndGet(COUNT);
+        h.addAndGet(SUM, latencyMs);
+        long max;
+        do {
+            max = h.get(MAX);
+        } while (latencyMs > max && !h.compareAndSet(MAX, max, latencyMs));
+    }
+
+    void
+    dump(PrintWriter pw) {
+        pw.println(" Request latency (ms):");
+        for (int i = 0; i < mHistograms.length(); i++) {
+            AtomicLongArray h = mHistograms.get(i);
+            if (h == null) {
+                continue;
+            }
+            // Snapshot the buckets, recording may carry on meanwhile.
+            long[] buckets = new long[BUCKETS];
+            long count = 0;
+            for (int b = 0; b < BUCKETS; b++) {
+                buckets[b] = h.get(b);
+                count += buckets[b];
+            }
+            if (count == 0) {
+                continue;
+            }
+            int request = i < AOSP_CODES ? i : i - AOSP_CODES + SamsungExynos4RIL.SAMSUNG_REQUEST_BASE;
+            pw.println("  " + SamsungExynos4RIL.requestToString(request)
+                    + " n=" + count
+                    + " mean=" + h.get(SUM) / Math.max(1, h.get(COUNT))
+                    + " p50=" + percentile(buckets, count, 50)
+                    + " p90=" + percentile(buckets, count, 90)
+                    + " p99=" + percentile(buckets, count, 99)
+                    + " max=" + h.get(MAX));
+        }
+    }
+
+    private static int
+    histogramIndex(int request) {
+        if (request >= 0 && request < AOSP_CODES) {
+            return request;
+        }
+        int index = request - SamsungExynos4RIL.SAMSUNG_REQUEST_BASE;
+        if (index >= 0 && index < SAMSUNG_CODES) {
+            return AOSP_CODES + index;
+        }
+        return -1;
+    }
+
+    private static int
+    bucket(long ms) {
+        if (ms < SUB_BUCKETS) {
+            return (int) ms;
+        }
+        int shift = 63 - Long.numberOfLeadingZeros(ms) - SUB_BUCKET_BITS;
+        int b = (shift + 1) * SUB_BUCKETS + (int) (ms >>> shift) - SUB_BUCKETS;
+        return Math.min(b, BUCKETS - 1);
+    }
+
+    /* Upper bound of bucket b */
+    private static long
+    bucketLimit(int b) {
+        if (b < SUB_BUCKETS) {
+            return b;
+        }
+        int shift = b / SUB_BUCKETS - 1;
+        long base = (long) (b % SUB_BUCKETS + SUB_BUCKETS) << shift;
+        return base + (1L << shift) - 1;
+    }
+
+    private static long
+    percentile(long[] buckets, long count, int percent) {
+        long rank = (count * percent + 99) / 100;
+        long seen = 0;
+        for (int b = 0; b < buckets.length; b++) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                return bucketLimit(b);
+            }
+        }
+        return bucketLimit(buckets.length - 1);
+    }
+}
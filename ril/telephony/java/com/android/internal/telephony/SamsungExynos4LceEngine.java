@@ -0,0 +1,285 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.os.Handler;
+import android.os.Looper;
+import android.os.Message;
+import android.os.SystemClock;
+import android.telephony.ServiceState;
+import android.telephony.SignalStrength;
+
+import java.io.BufferedReader;
+import java.io.FileReader;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+
+/**
+ * Link capacity estimation for a modem that has none (the xmm6262 answers
+ * START_LCE/PULL_LCEDATA with REQUEST_NOT_SUPPORTED).
+ *
+ * The estimate starts from a model: the downlink peak of the current radio
+ * technology (HSDPA counted only while the modem says it is in use),
+ * scaled down by signal strength. While LCE is started the data
+ * interface's rx byte counter is sampled every report interval; a sample
+ * that moved a fair share of the model's rate means the link was loaded,
+ * and the rate seen then is a measurement of it. Measurements pull the
+ * estimate towards what was seen and raise the confidence the closer they
+ * come to the model, and age out after MEASUREMENT_MAX_AGE_MS.
+ *
+ * The answers are what RIL_LceStatusInfo and RIL_LceDataInfo would
+ * decode to, see SamsungExynos4RIL.
+ */
+final class SamsungExynos4LceEngine extends Handler {
+
+    /* RIL_LceStatusInfo.lce_status */
+    static final int LCE_STOPPED = 0;
+    static final int LCE_ACTIVE = 1;
+
+    interface Listener {
+        /** Push mode report, [kbps, confidence, suspended] */
+        void onLceData(ArrayList<Integer> data);
+    }
+
+    private static final int EVENT_SAMPLE = 1;
+
+    private static final int MIN_INTERVAL_MS = 1000;
+    private static final int DEFAULT_INTERVAL_MS = 5000;
+    /* A sample at this share of the model rate counts as a loaded link */
+    private static final int LOADED_PERCENT = 25;
+    private static final long MEASUREMENT_MAX_AGE_MS = 30 * 1000;
+
+    /* Confidence of the model alone, and at best with a measurement */
+    private static final int MODEL_CONFIDENCE = 30;
+    private static final int MAX_CONFIDENCE = 90;
+
+    /* GSM signal strength in ASU, full rate from ASU_GOOD up */
+    private static final int ASU_UNKNOWN = 99;
+    private static final int ASU_GOOD = 16;
+
+    private final Listener mListener;
+    private final String mRxBytesPath;
+
+    private boolean mStarted;
+    private boolean mPullMode;
+    private int mIntervalMs = DEFAULT_INTERVAL_MS;
+
+    private int mRadioTech = ServiceState.RIL_RADIO_TECHNOLOGY_UNKNOWN;
+    private boolean mHsdpa;
+    private int mAsu = ASU_UNKNOWN;
+
+    private long mLastRxBytes = -1;
+    private long mLastSampleAt;
+    private int mMeasuredKbps;
+    private long mMeasuredAt;
+
+    private long mSamples;
+    private long mLoadedSamples;
+    private long mReports;
+
+    SamsungExynos4LceEngine(Looper looper, String iface, Listener listener) {
+        super(looper);
+        mListener = listener;
+        mRxBytesPath = "/sys/class/net/" + iface + "/statistics/rx_bytes";
+    }
+
+    /** @return the START_LCE answer, [status, actual interval] */
+    synchronized ArrayList<Integer>
+    start(int reportIntervalMs, boolean pullMode) {
+        mStarted = true;
+        mPullMode = pullMode;
+        mIntervalMs = Math.max(MIN_INTERVAL_MS, reportIntervalMs);
+        mLastRxBytes = -1;
+        removeMessages(EVENT_SAMPLE);
+        sendEmptyMessage(EVENT_SAMPLE);
+        return status();
+    }
+
+    /** @return the STOP_LCE answer */
+    synchronized ArrayList<Integer>
+    stop() {
+        mStarted = false;
+        removeMessages(EVENT_SAMPLE);
+        return status();
+    }
+
+    /** @return the PULL_LCEDATA answer, [kbps, confidence, suspended] */
+    synchronized ArrayList<Integer>
+    pull() {
+        return estimate(SystemClock.elapsedRealtime());
+    }
+
+    synchronized void
+    onSignalStrength(SignalStrength ss) {
+        mAsu = ss.getGsmSignalStrength();
+    }
+
+    synchronized void
+    onRadioTechnology(int radioTech) {
+        mRadioTech = radioTech;
+    }
+
+    /** RIL_UNSOL_HSDPA_STATE_CHANGED */
+    synchronized void
+    onHsdpaState(boolean active) {
+        mHsdpa = active;
+    }
+
+    synchronized void
+    dump(PrintWriter pw) {
+        pw.println(" mLce started=" + mStarted + " pullMode=" + mPullMode
+                + " intervalMs=" + mIntervalMs + " radioTech=" + mRadioTech
+                + " hsdpa=" + mHsdpa + " asu=" + mAsu + " modelKbps=" + modelKbps()
+                + " measuredKbps=" + mMeasuredKbps + " samples=" + mSamples
+                + " loaded=" + mLoadedSamples + " reports=" + mReports
+                + " estimate=" + estimate(SystemClock.elapsedRealtime()));
+    }
+
+    @Override
+    public void
+    handleMessage(Message msg) {
+        if (msg.what != EVENT_SAMPLE) {
+            return;
+        }
+
+        ArrayList<Integer> report = null;
+        synchronized (this) {
+            if (!mStarted) {
+                return;
+            }
+            long now = SystemClock.elapsedRealtime();
+            sample(now);
+            if (!mPullMode) {
+                report = estimate(now);
+                mReports++;
+            }
+            sendEmptyMessageDelayed(EVENT_SAMPLE, mIntervalMs);
+        }
+        if (report != null) {
+            mListener.onLceData(report);
+        }
+    }
+
+    private ArrayList<Integer>
+    status() {
+        ArrayList<Integer> status = new ArrayList<Integer>(2);
+        status.add(mStarted ? LCE_ACTIVE : LCE_STOPPED);
+        status.add(mIntervalMs);
+        return status;
+    }
+
+    private void
+    sample(long now) {
+        long rxBytes = readCounter(mRxBytesPath);
+        if (rxBytes >= 0 && mLastRxBytes >= 0 && rxBytes >= mLastRxBytes
+                && now > mLastSampleAt) {
+            mSamples++;
+            int kbps = (int) Math.min(Integer.MAX_VALUE,
+                    (rxBytes - mLastRxBytes) * 8 / (now - mLastSampleAt));
+            int model = modelKbps();
+            if (model > 0 && kbps * 100L >= model * (long) LOADED_PERCENT) {
+                mLoadedSamples++;
+                // Keep the best recent one, a loaded link rarely shows its
+                // full rate in every sample.
+                if (now - mMeasuredAt > MEASUREMENT_MAX_AGE_MS || kbps > mMeasuredKbps) {
+                    mMeasuredKbps = kbps;
+                }
+                mMeasuredAt = now;
+            }
+        }
+        mLastRxBytes = rxBytes;
+        mLastSampleAt = now;
+    }
+
+    private ArrayList<Integer>
+    estimate(long now) {
+        int model = modelKbps();
+        int kbps = model;
+        int confidence = mAsu == ASU_UNKNOWN ? MODEL_CONFIDENCE / 3 : MODEL_CONFIDENCE;
+
+        if (model > 0 && mMeasuredAt > 0 && now - mMeasuredAt <= MEASUREMENT_MAX_AGE_MS) {
+            // The link did at least mMeasuredKbps; if the model says more,
+            // the truth is probably in between.
+            kbps = mMeasuredKbps >= model ? mMeasuredKbps : (model + mMeasuredKbps) / 2;
+            int agreement = (int) (100L * Math.min(model, mMeasuredKbps)
+                    / Math.max(model, mMeasuredKbps));
+            confidence = Math.max(confidence, MAX_CONFIDENCE * agreement / 100);
+        }
+
+        // Suspended: no data interface, or no idea what the radio is on.
+        boolean suspended = model == 0 || mLastRxBytes < 0;
+
+        ArrayList<Integer> data = new ArrayList<Integer>(3);
+        data.add(kbps);
+        data.add(confidence);
+        data.add(suspended ? 1 : 0);
+        return data;
+    }
+
+    private int
+    modelKbps() {
+        int peak = peakKbps(mRadioTech, mHsdpa);
+        if (mAsu == ASU_UNKNOWN) {
+            return peak;
+        }
+        // Linear from a tenth of the peak at ASU 0 up to the peak at ASU_GOOD.
+        int asu = Math.min(Math.max(mAsu, 0), ASU_GOOD);
+        return (int) (peak * (10L + 90L * asu / ASU_GOOD) / 100);
+    }
+
+    /* Downlink peak the xmm6262 reaches on radioTech */
+    private static int
+    peakKbps(int radioTech, boolean hsdpa) {
+        switch (radioTech) {
+            case ServiceState.RIL_RADIO_TECHNOLOGY_GPRS:
+                return 80;
+            case ServiceState.RIL_RADIO_TECHNOLOGY_EDGE:
+                return 236;
+            case ServiceState.RIL_RADIO_TECHNOLOGY_UMTS:
+                return 384;
+            case ServiceState.RIL_RADIO_TECHNOLOGY_HSDPA:
+            case ServiceState.RIL_RADIO_TECHNOLOGY_HSUPA:
+            case ServiceState.RIL_RADIO_TECHNOLOGY_HSPA:
+                return hsdpa ? 7200 : 384;
+            case ServiceState.RIL_RADIO_TECHNOLOGY_HSPAP:
+                return hsdpa ? 21000 : 384;
+            default:
+                return 0;
+        }
+    }
+
+    /* @return the interface counter in path, or -1 if the interface isn't up */
+    static long
+    readCounter(String path) {
+        BufferedReader reader = null;
+        try {
+            reader = new BufferedReader(new FileReader(path));
+            String line = reader.readLine();
+            return line != null ? Long.parseLong(line.trim()) : -1;
+        } catch (IOException | NumberFormatException e) {
+            return -1;
+        } finally {
+            if (reader != null) {
+                try {
+                    reader.close();
+                } catch (IOException e) {
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.os.SystemClock;
+import android.telephony.DataConnectionRealTimeInfo;
+import android.telephony.ModemActivityInfo;
+import android.telephony.SignalStrength;
+
+import java.io.PrintWriter;
+
+/**
+ * Modem activity accounting for GET_ACTIVITY_INFO, which the xmm6262 doesn't
+ * implement.
+ *
+ * Time since boot is split into the RIL_ActivityStatsInfo buckets from what
+ * the RIL sees, at each state change and whenever the stats are asked for:
+ *
+ *  radio off                  sleep
+ *  in a call                  rx, and tx for the voice activity share
+ *  data power state high/med  rx, and tx for the time the uplink bytes take
+ *  otherwise                  idle for the paging duty cycle, sleep the rest
+ *
+ * The data power state is RIL_DcRtInfo's when the modem sends
+ * RIL_UNSOL_DC_RT_INFO_CHANGED. Until it does, it is inferred from the
+ * data interface byte counters: time to move the bytes at a nominal rate
+ * plus the RRC inactivity tail counts as active. Tx time goes to the power
+ * level bucket the downlink signal strength suggests.
+ *
+ * No energy figure is reported, there is no modem power profile to derive
+ * it from.
+ *
+ * The byte counters are read before taking the lock, so the receiver and
+ * binder threads never wait on each other's sysfs reads.
+ */
+final class SamsungExynos4ModemActivity {
+
+    /* RIL_RadioState */
+    private static final int RADIO_STATE_ON = 10;
+
+    /* Share of a call the uplink is on with DTX */
+    private static final int VOICE_ACTIVITY_PERCENT = 50;
+    /* Share of camped idle time the modem is awake for paging */
+    private static final int PAGING_DUTY_PERCENT = 2;
+    /* Inferred data activity: nominal rates and the DCH + FACH tail */
+    private static final int NOMINAL_RX_KBPS = 2000;
+    private static final int NOMINAL_TX_KBPS = 500;
+    private static final long INACTIVITY_TAIL_MS = 5000 + 10000;
+
+    /* GSM signal strength in ASU -> ModemActivityInfo tx power level */
+    private static final int ASU_UNKNOWN = 99;
+    private static final int[] TX_LEVEL_MIN_ASU = { 20, 14, 9, 4, 0 };
+
+    private final String mRxBytesPath;
+    private final String mTxBytesPath;
+
+    private boolean mRadioOn;
+    private boolean mInCall;
+    private int mPowerState = DataConnectionRealTimeInfo.DC_POWER_STATE_LOW;
+    private boolean mPowerStateReported;
+    private int mAsu = ASU_UNKNOWN;
+
+    private long mLastUpdateAt;
+    private long mLastRxBytes = -1;
+    private long mLastTxBytes = -1;
+
+    private long mSleepMs;
+    private long mIdleMs;
+    private long mRxMs;
+    private final long[] mTxMs = new long[ModemActivityInfo.TX_POWER_LEVELS];
+
+    SamsungExynos4ModemActivity(String iface) {
+        mRxBytesPath = "/sys/class/net/" + iface + "/statistics/rx_bytes";
+        mTxBytesPath = "/sys/class/net/" + iface + "/statistics/tx_bytes";
+        mLastUpdateAt = SystemClock.elapsedRealtime();
+    }
+
+    void
+    onRadioState(int state) {
+        long rxBytes = SamsungExynos4LceEngine.readCounter(mRxBytesPath);
+        long txBytes = SamsungExynos4LceEngine.readCounter(mTxBytesPath);
+        synchronized (this) {
+            update(SystemClock.elapsedRealtime(), rxBytes, txBytes);
+            mRadioOn = state == RADIO_STATE_ON;
+            if (!mRadioOn) {
+                mInCall = false;
+                mPowerState = DataConnectionRealTimeInfo.DC_POWER_STATE_LOW;
+            }
+        }
+    }
+
+    /** From the GET_CURRENT_CALLS answers */
+    void
+    onCallCount(int count) {
+        boolean inCall = count > 0;
+        synchronized (this) {
+            if (mInCall == inCall) {
+                // The usual case while polling, no counters to read.
+                return;
+            }
+        }
+        long rxBytes = SamsungExynos4LceEngine.readCounter(mRxBytesPath);
+        long txBytes = SamsungExynos4LceEngine.readCounter(mTxBytesPath);
+        synchronized (this) {
+            if (mInCall != inCall) {
+                update(SystemClock.elapsedRealtime(), rxBytes, txBytes);
+                mInCall = inCall;
+            }
+        }
+    }
+
+    /** RIL_DcRtInfo.powerState */
+    void
+    onDataPowerState(int powerState) {
+        long rxBytes = SamsungExynos4LceEngine.readCounter(mRxBytesPath);
+        long txBytes = SamsungExynos4LceEngine.readCounter(mTxBytesPath);
+        synchronized (this) {
+            update(SystemClock.elapsedRealtime(), rxBytes, txBytes);
+            mPowerState = powerState;
+            mPowerStateReported = true;
+        }
+    }
+
+    synchronized void
+    onSignalStrength(SignalStrength ss) {
+        mAsu = ss.getGsmSignalStrength();
+    }
+
+    /** @return the GET_ACTIVITY_INFO answer, totals since boot */
+    ModemActivityInfo
+    snapshot() {
+        long rxBytes = SamsungExynos4LceEngine.readCounter(mRxBytesPath);
+        long txBytes = SamsungExynos4LceEngine.readCounter(mTxBytesPath);
+        synchronized (this) {
+            long now = SystemClock.elapsedRealtime();
+            update(now, rxBytes, txBytes);
+            int[] tx = new int[mTxMs.length];
+            for (int i = 0; i < tx.length; i++) {
+                tx[i] = clamp(mTxMs[i]);
+            }
+            return new ModemActivityInfo(now, clamp(mSleepMs), clamp(mIdleMs), tx,
+                    clamp(mRxMs), 0);
+        }
+    }
+
+    void
+    dump(PrintWriter pw) {
+        long rxBytes = SamsungExynos4LceEngine.readCounter(mRxBytesPath);
+        long txBytes = SamsungExynos4LceEngine.readCounter(mTxBytesPath);
+        synchronized (this) {
+            update(SystemClock.elapsedRealtime(), rxBytes, txBytes);
+            StringBuilder sb = new StringBuilder(" mModemActivity radioOn=" + mRadioOn
+                    + " inCall=" + mInCall + " powerState=" + mPowerState
+                    + (mPowerStateReported ? " (reported)" : " (inferred)")
+                    + " sleepMs=" + mSleepMs + " idleMs=" + mIdleMs + " rxMs=" + mRxMs
+                    + " txMs=");
+            for (int i = 0; i < mTxMs.length; i++) {
+                sb.append(i == 0 ? "" : "/").append(mTxMs[i]);
+            }
+            pw.println(sb);
+        }
+    }
+
+    /*
+     * Account for the time since the last update in the state until now,
+     * given the counters read just before. Caller holds the lock.
+     */
+    private void
+    update(long now, long rxBytes, long txBytes) {
+        long dt = now - mLastUpdateAt;
+        mLastUpdateAt = now;
+
+        long rxDelta = mLastRxBytes >= 0 && rxBytes >= mLastRxBytes ? rxBytes - mLastRxBytes : 0;
+        long txDelta = mLastTxBytes >= 0 && txBytes >= mLastTxBytes ? txBytes - mLastTxBytes : 0;
+        mLastRxBytes = rxBytes;
+        mLastTxBytes = txBytes;
+
+        if (dt <= 0) {
+            return;
+        }
+        if (!mRadioOn) {
+            mSleepMs += dt;
+            return;
+        }
+
+        int level = txLevel();
+        if (mInCall) {
+            mRxMs += dt;
+            mTxMs[level] += dt * VOICE_ACTIVITY_PERCENT / 100;
+            return;
+        }
+
+        long txMs = Math.min(dt, transferMs(txDelta, NOMINAL_TX_KBPS));
+        long activeMs;
+        if (mPowerStateReported) {
+            activeMs = mPowerState == DataConnectionRealTimeInfo.DC_POWER_STATE_LOW ? 0 : dt;
+        } else if (rxDelta + txDelta > 0) {
+            // Bursts between updates are counted as one; good enough as
+            // long as updates come with state changes and stats requests.
+            activeMs = Math.min(dt, Math.max(transferMs(rxDelta, NOMINAL_RX_KBPS), txMs)
+                    + INACTIVITY_TAIL_MS);
+        } else {
+            activeMs = 0;
+        }
+        mRxMs += activeMs;
+        if (activeMs > 0) {
+            mTxMs[level] += Math.min(txMs, activeMs);
+        }
+
+        long idle = dt - activeMs;
+        long paging = idle * PAGING_DUTY_PERCENT / 100;
+        mIdleMs += paging;
+        mSleepMs += idle - paging;
+    }
+
+    /* The weaker the downlink, the harder the uplink has to shout */
+    private int
+    txLevel() {
+        if (mAsu == ASU_UNKNOWN) {
+            return TX_LEVEL_MIN_ASU.length / 2;
+        }
+        for (int i = 0; i < TX_LEVEL_MIN_ASU.length; i++) {
+            if (mAsu >= TX_LEVEL_MIN_ASU[i]) {
+                return i;
+            }
+        }
+        return TX_LEVEL_MIN_ASU.length - 1;
+    }
+
+    private static long
+    transferMs(long bytes, int kbps) {
+        return bytes * 8 / kbps;
+    }
+
+    private static int
+    clamp(long ms) {
+        return (int) Math.min(ms, Integer.MAX_VALUE);
+    }
+}
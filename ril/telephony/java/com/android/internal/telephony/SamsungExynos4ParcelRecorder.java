@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import static com.android.internal.telephony.RILConstants.*;
+
+import android.os.Parcel;
+
+import java.io.BufferedOutputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.util.Arrays;
+
+/**
+ * Binary recorder of the parcels rild sends us, for debuggable builds.
+ *
+ * Every response parcel handed to processSolicited()/processUnsolicited()
+ * is appended to a fixed size byte ring, oldest entries are overwritten.
+ * Entries are
+ *
+ *   u32 entry length (including this header)
+ *   u32 flags (ENTRY_SOLICITED or ENTRY_UNSOLICITED, maybe ENTRY_REDACTED)
+ *   s64 elapsedRealtimeNanos() at arrival
+ *   u8[] the parcel as received, response type int included
+ *
+ * all little-endian, like the parcel data itself. save() writes a file
+ * header (TRACE_MAGIC, TRACE_VERSION, s64 wall clock ms) followed by the
+ * entries in arrival order; SamsungExynos4TraceReplay reads it back.
+ *
+ * Answers and unsols that carry identities, phone numbers, SMS or SIM
+ * contents are cut down to their header (response type and serial plus
+ * error, or unsol code) and flagged ENTRY_REDACTED, see isSensitive*().
+ */
+final class SamsungExynos4ParcelRecorder {
+
+    static final int TRACE_MAGIC = 0x31545253; // "SRT1"
+    static final int TRACE_VERSION = 2;
+
+    static final int ENTRY_SOLICITED = 0;
+    static final int ENTRY_UNSOLICITED = 1;
+    static final int ENTRY_REDACTED = 2;
+    static final int ENTRY_HEADER_BYTES = 16;
+    /* RIL reads at most RIL_MAX_COMMAND_BYTES (8k) per parcel */
+    static final int MAX_ENTRY_BYTES = ENTRY_HEADER_BYTES + 8 * 1024;
+
+    /* What is left of a redacted parcel: type, serial, error / type, code */
+    private static final int SOLICITED_HEADER_BYTES = 12;
+    private static final int UNSOLICITED_HEADER_BYTES = 8;
+
+    private final byte[] mRing;
+    /* Byte offsets since start, the ring index is offset % mRing.length */
+    private long mHead;
+    private long mTail;
+    private long mRecorded;
+    private long mOverwritten;
+
+    SamsungExynos4ParcelRecorder(int capacity) {
+        mRing = new byte[capacity];
+    }
+
+    /**
+     * @param flags ENTRY_SOLICITED or ENTRY_UNSOLICITED
+     * @param atNs elapsedRealtimeNanos() at which p arrived
+     * @param redact keep only the header of p, see isSensitive*()
+     */
+    void
+    record(int flags, long atNs, Parcel p, boolean redact) {
+        byte[] data = p.marshall();
+        if (redact) {
+            int keep = flags == ENTRY_SOLICITED
+                    ? SOLICITED_HEADER_BYTES : UNSOLICITED_HEADER_BYTES;
+            data = Arrays.copyOf(data, Math.min(keep, data.length));
+            flags |= ENTRY_REDACTED;
+        }
+        int length = ENTRY_HEADER_BYTES + data.length;
+
+        synchronized (this) {
+            if (length > mRing.length) {
+                return;
+            }
+            while (mHead + length - mTail > mRing.length) {
+                mTail += getInt(mTail);
+                mOverwritten++;
+            }
+            putInt(mHead, length);
+            putInt(mHead + 4, flags);
+            putLong(mHead + 8, atNs);
+            put(mHead + ENTRY_HEADER_BYTES, data);
+            mHead += length;
+            mRecorded++;
+        }
+    }
+
+    void
+    save(File file) throws IOException {
+        byte[] entries;
+        synchronized (this) {
+            entries = new byte[(int) (mHead - mTail)];
+            get(mTail, entries);
+        }
+
+        DataOutputStream out = new DataOutputStream(
+                new BufferedOutputStream(new FileOutputStream(file)));
+        try {
+            out.writeInt(Integer.reverseBytes(TRACE_MAGIC));
+            out.writeInt(Integer.reverseBytes(TRACE_VERSION));
+            out.writeLong(Long.reverseBytes(System.currentTimeMillis()));
+            out.write(entries);
+        } finally {
+            out.close();
+        }
+    }
+
+    /**
+     * @return whether the answer to request (-1 if unknown) may carry
+     *         identities, numbers, SMS or SIM contents
+     */
+    static boolean
+    isSensitiveRequest(int request) {
+        switch (request) {
+            case RIL_REQUEST_GET_SIM_STATUS:
+            case RIL_REQUEST_GET_IMSI:
+            case RIL_REQUEST_GET_IMEI:
+            case RIL_REQUEST_GET_IMEISV:
+            case RIL_REQUEST_DEVICE_IDENTITY:
+            case RIL_REQUEST_CDMA_SUBSCRIPTION:
+            case RIL_REQUEST_GET_CURRENT_CALLS:
+            case RIL_REQUEST_QUERY_CALL_FORWARD_STATUS:
+            case RIL_REQUEST_SIM_IO:
+            case RIL_REQUEST_SIM_AUTHENTICATION:
+            case RIL_REQUEST_ISIM_AUTHENTICATION:
+            case RIL_REQUEST_SIM_TRANSMIT_APDU_BASIC:
+            case RIL_REQUEST_SIM_TRANSMIT_APDU_CHANNEL:
+            case RIL_REQUEST_STK_GET_PROFILE:
+            case RIL_REQUEST_STK_SEND_ENVELOPE_COMMAND:
+            case RIL_REQUEST_STK_SEND_ENVELOPE_WITH_STATUS:
+            case RIL_REQUEST_SEND_SMS:
+            case RIL_REQUEST_SEND_SMS_EXPECT_MORE:
+            case RIL_REQUEST_CDMA_SEND_SMS:
+            case RIL_REQUEST_IMS_SEND_SMS:
+            case RIL_REQUEST_GET_SMSC_ADDRESS:
+            case RIL_REQUEST_OEM_HOOK_RAW:
+            case RIL_REQUEST_OEM_HOOK_STRINGS:
+            case SamsungExynos4RIL.RIL_REQUEST_GET_PHONEBOOK_ENTRY:
+            case SamsungExynos4RIL.RIL_REQUEST_READ_SMS_FROM_SIM:
+            case SamsungExynos4RIL.RIL_REQUEST_GET_SERIAL_NUMBER:
+            case SamsungExynos4RIL.RIL_REQUEST_GET_MANUFACTURE_DATE_NUMBER:
+            case SamsungExynos4RIL.RIL_REQUEST_GET_BARCODE_NUMBER:
+            case SamsungExynos4RIL.RIL_REQUEST_SIM_TRANSMIT_BASIC:
+            case SamsungExynos4RIL.RIL_REQUEST_SIM_TRANSMIT_CHANNEL:
+            case SamsungExynos4RIL.RIL_REQUEST_SIM_AUTH:
+            case -1:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    /** @return whether unsol response may carry numbers, SMS or SIM contents */
+    static boolean
+    isSensitiveUnsol(int response) {
+        switch (response) {
+            case RIL_UNSOL_RESPONSE_NEW_SMS:
+            case RIL_UNSOL_RESPONSE_NEW_SMS_STATUS_REPORT:
+            case RIL_UNSOL_RESPONSE_NEW_SMS_ON_SIM:
+            case RIL_UNSOL_RESPONSE_CDMA_NEW_SMS:
+            case RIL_UNSOL_ON_USSD:
+            case RIL_UNSOL_SUPP_SVC_NOTIFICATION:
+            case RIL_UNSOL_CDMA_INFO_REC:
+            case RIL_UNSOL_STK_PROACTIVE_COMMAND:
+            case RIL_UNSOL_STK_EVENT_NOTIFY:
+            case RIL_UNSOL_STK_CALL_SETUP:
+            case RIL_UNSOL_OEM_HOOK_RAW:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    synchronized String
+    stats() {
+        return "capacity=" + mRing.length + " used=" + (mHead - mTail)
+                + " recorded=" + mRecorded + " overwritten=" + mOverwritten;
+    }
+
+    private void
+    put(long offset, byte[] src) {
+        int i = (int) (offset % mRing.length);
+        int first = Math.min(src.length, mRing.length - i);
+        System.arraycopy(src, 0, mRing, i, first);
+        System.arraycopy(src, first, mRing, 0, src.length - first);
+    }
+
+    private void
+    get(long offset, byte[] dst) {
+        int i = (int) (offset % mRing.length);
+        int first = Math.min(dst.length, mRing.length - i);
+        System.arraycopy(mRing, i, dst, 0, first);
+        System.arraycopy(mRing, 0, dst, first, dst.length - first);
+    }
+
+    private void
+    putInt(long offset, int v) {
+        for (int b = 0; b < 4; b++, v >>>= 8) {
+            mRing[(int) ((offset + b) % mRing.length)] = (byte) v;
+        }
+    }
+
+    private void
+    putLong(long offset, long v) {
+        putInt(offset, (int) v);
+        putInt(offset + 4, (int) (v >>> 32));
+    }
+
+    private int
+    getInt(long offset) {
+        int v = 0;
+        for (int b = 3; b >= 0; b--) {
+            v = (v << 8) | (mRing[(int) ((offset + b) % mRing.length)] & 0xff);
+        }
+        return v;
+    }
+}
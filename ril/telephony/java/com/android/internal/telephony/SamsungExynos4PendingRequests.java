@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.util.SparseArray;
+
+/**
+ * Serial-keyed open addressing table of the requests SamsungExynos4RIL
+ * has handed to the socket and not yet seen a response for, with their
+ * send times and deadlines. Responses are still matched to their request
+ * through RIL's mRequestList, this is bookkeeping on top of it; see
+ * PendingRequestsBench for what it costs per response.
+ *
+ * RILRequest serials are allocated sequentially, so (serial & mask) spreads
+ * in-flight requests over distinct slots and lookups almost never probe.
+ * Removal uses backward shift deletion, so no tombstones accumulate during
+ * long SIM_IO bursts.
+ *
+ * The RILRequest objects themselves are owned by RIL and may be recycled
+ * behind our back (socket errors, clearRequestList), so every lookup checks
+ * that the stored request still carries the serial it was added with, and
+ * the table is cleared whenever RIL clears its list.
+ */
+final class SamsungExynos4PendingRequests {
+
+    static final long NO_DEADLINE = Long.MAX_VALUE;
+
+    private static final int INITIAL_CAPACITY = 64;
+
+    private int mMask;
+    private int[] mSerials;
+    private long[] mSentAt;
+    private long[] mDeadlines;
+    private RILRequest[] mRequests;
+    private int mSize;
+    private int mHighWater;
+
+    SamsungExynos4PendingRequests() {
+        allocate(INITIAL_CAPACITY);
+    }
+
+    private void
+    allocate(int capacity) {
+        mMask = capacity - 1;
+        mSerials = new int[capacity];
+        mSentAt = new long[capacity];
+        mDeadlines = new long[capacity];
+        mRequests = new RILRequest[capacity];
+    }
+
+    /**
+     * Track rr from now on. sentAt and deadline are elapsedRealtime()
+     * milliseconds, deadline may be NO_DEADLINE.
+     */
+    synchronized void
+    add(RILRequest rr, long sentAt, long deadline) {
+        if ((mSize + 1) * 4 > mRequests.length * 3) {
+            grow();
+        }
+        int i = insertSlot(rr.mSerial);
+        if (mRequests[i] == null) {
+            mSize++;
+        }
+        mSerials[i] = rr.mSerial;
+        mSentAt[i] = sentAt;
+        mDeadlines[i] = deadline;
+        mRequests[i] = rr;
+        if (mSize > mHighWater) {
+            mHighWater = mSize;
+        }
+    }
+
+    /**
+     * Stop tracking serial.
+     *
+     * @return the request sent with serial, or null if the serial was not
+     *         pending or RIL has recycled the request since
+     */
+    synchronized RILRequest
+    remove(int serial) {
+        int i = findSlot(serial);
+        if (i < 0) {
+            return null;
+        }
+        RILRequest rr = mRequests[i];
+        deleteSlot(i);
+        return rr.mSerial == serial ? rr : null;
+    }
+
+    /**
+     * @return the elapsedRealtime() serial was added with, or -1 if the
+     *         serial is not pending
+     */
+    synchronized long
+    sentAt(int serial) {
+        int i = findSlot(serial);
+        return i < 0 ? -1 : mSentAt[i];
+    }
+
+    /**
+     * Remove every request whose deadline is at or before now and put the
+     * ones RIL still owns into expired, keyed by the serial they were added
+     * with. Requests that were recycled by RIL in the meantime are dropped
+     * silently.
+     *
+     * @return the earliest deadline left in the table, or NO_DEADLINE
+     */
+    synchronized long
+    sweep(long now, SparseArray<RILRequest> expired) {
+        long next = NO_DEADLINE;
+        int i = 0;
+        while (i < mRequests.length) {
+            RILRequest rr = mRequests[i];
+            if (rr == null) {
+                i++;
+                continue;
+            }
+            if (mDeadlines[i] > now) {
+                next = Math.min(next, mDeadlines[i]);
+                i++;
+                continue;
+            }
+            if (rr.mSerial == mSerials[i]) {
+                expired.put(mSerials[i], rr);
+            }
+            // Backward shift may move an unvisited entry into slot i,
+            // so look at the same slot again.
+            deleteSlot(i);
+        }
+        return next;
+    }
+
+    synchronized void
+    clear() {
+        for (int i = 0; i < mRequests.length; i++) {
+            mRequests[i] = null;
+        }
+        mSize = 0;
+    }
+
+    synchronized int
+    size() {
+        return mSize;
+    }
+
+    synchronized int
+    highWater() {
+        return mHighWater;
+    }
+
+    private int
+    findSlot(int serial) {
+        int i = serial & mMask;
+        while (mRequests[i] != null) {
+            if (mSerials[i] == serial) {
+                return i;
+            }
+            i = (i + 1) & mMask;
+        }
+        return -1;
+    }
+
+    private int
+    insertSlot(int serial) {
+        int i = serial & mMask;
+        while (mRequests[i] != null && mSerials[i] != serial) {
+            i = (i + 1) & mMask;
+        }
+        return i;
+    }
+
+    private void
+    deleteSlot(int hole) {
+        mRequests[hole] = null;
+        mSize--;
+
+        int i = (hole + 1) & mMask;
+        while (mRequests[i] != null) {
+            int home = mSerials[i] & mMask;
+            // Shift entry i into the hole unless its home slot lies
+            // cyclically within (hole, i].
+            boolean movable = (i > hole) ? (home <= hole || home > i)
+                                         : (home <= hole && home > i);
+            if (movable) {
+                mSerials[hole] = mSerials[i];
+                mSentAt[hole] = mSentAt[i];
+                mDeadlines[hole] = mDeadlines[i];
+                mRequests[hole] = mRequests[i];
+                mRequests[i] = null;
+                hole = i;
+            }
+            i = (i + 1) & mMask;
+        }
+    }
+
+    private void
+    grow() {
+        int[] serials = mSerials;
+        long[] sentAt = mSentAt;
+        long[] deadlines = mDeadlines;
+        RILRequest[] requests = mRequests;
+
+        allocate(requests.length * 2);
+        for (int j = 0; j < requests.length; j++) {
+            if (requests[j] == null) {
+                continue;
+            }
+            int i = insertSlot(serials[j]);
+            mSerials[i] = serials[j];
+            mSentAt[i] = sentAt[j];
+            mDeadlines[i] = deadlines[j];
+            mRequests[i] = requests[j];
+        }
+    }
+}
@@ -0,0 +1,370 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.os.AsyncResult;
+import android.os.Handler;
+import android.os.Looper;
+import android.os.Message;
+import android.os.SystemProperties;
+import android.telephony.Rlog;
+import android.text.TextUtils;
+import android.util.SparseArray;
+
+import com.android.internal.telephony.uicc.IccIoResult;
+
+import java.io.PrintWriter;
+
+/**
+ * Read-ahead for SIM/USIM phonebook records.
+ *
+ * AdnRecordLoader asks IccFileHandler for an EF's size once (GET_RESPONSE)
+ * and then reads the records one READ_RECORD at a time, waiting for each
+ * answer before sending the next. With a few hundred records that is a few
+ * hundred serialized RIL round trips at boot.
+ *
+ * We watch the GET_RESPONSE answer for phonebook EFs to learn the record
+ * size and count, then keep up to mDepth READ_RECORDs for the following
+ * records in flight. When the framework asks for a record we already have
+ * (or have asked for), it is answered from here instead of going to the
+ * modem again.
+ *
+ * Writes to the file being read ahead, and SIM status changes, throw the
+ * read-ahead state away. Reads already handed to the framework are always
+ * answered.
+ */
+final class SamsungExynos4PhonebookReader extends Handler {
+
+    private static final int COMMAND_READ_RECORD = 0xb2;
+    private static final int COMMAND_GET_RESPONSE = 0xc0;
+    private static final int COMMAND_UPDATE_RECORD = 0xdc;
+    private static final int READ_RECORD_MODE_ABSOLUTE = 4;
+
+    /* EF GET_RESPONSE layout, see IccFileHandler */
+    private static final int GET_RESPONSE_EF_SIZE_BYTES = 15;
+    private static final int RESPONSE_DATA_FILE_SIZE_1 = 2;
+    private static final int RESPONSE_DATA_FILE_SIZE_2 = 3;
+    private static final int RESPONSE_DATA_FILE_TYPE = 6;
+    private static final int RESPONSE_DATA_STRUCTURE = 13;
+    private static final int RESPONSE_DATA_RECORD_LENGTH = 14;
+    private static final int TYPE_EF = 4;
+    private static final int EF_TYPE_LINEAR_FIXED = 1;
+
+    /*
+     * Phonebook EFs under DF_TELECOM on a 2G SIM, and everything under
+     * DF_PHONEBOOK on a USIM: the files loadEFLinearFixedAll() reads from
+     * the first record to the last.
+     */
+    private static final int EF_ADN = 0x6F3A;
+    private static final int EF_FDN = 0x6F3B;
+    private static final int EF_SDN = 0x6F49;
+    private static final String DF_PHONEBOOK_PATH = "3F007F105F3A";
+    /*
+     * Extension records are read one at a time, in whatever order the
+     * entries point to them, each with its own GET_RESPONSE. Reading ahead
+     * of those would fetch depth records for every one wanted.
+     */
+    private static final int EF_EXT1 = 0x6F4A;
+    private static final int EF_EXT2 = 0x6F4B;
+    private static final int EF_EXT3 = 0x6F4C;
+
+    private static final int DEFAULT_DEPTH = 8;
+
+    private static final int EVENT_GET_RESPONSE_DONE = 1;
+    private static final int EVENT_READ_RECORD_DONE = 2;
+
+    private static final class Request {
+        final int mFileId;
+        final String mPath;
+        final String mAid;
+        final Message mResult;
+
+        Request(int fileId, String path, String aid, Message result) {
+            mFileId = fileId;
+            mPath = path;
+            mAid = aid;
+            mResult = result;
+        }
+    }
+
+    private static final class Record {
+        final int mNumber;
+        final int mGeneration;
+        boolean mDone;
+        Object mResult;
+        Throwable mException;
+        Message mWaiter;
+
+        Record(int number, int generation) {
+            mNumber = number;
+            mGeneration = generation;
+        }
+    }
+
+    private final SamsungExynos4RIL mRil;
+    private final int mDepth;
+
+    /* The EF being read ahead, mFileId is -1 when there is none */
+    private int mFileId = -1;
+    private String mPath;
+    private String mAid;
+    private int mRecordSize;
+    private int mRecordCount;
+    private int mNextRecord;
+    private int mGeneration;
+    private final SparseArray<Record> mRecords = new SparseArray<Record>();
+
+    private long mReadAheadCount;
+    private long mHitCount;
+    private long mWastedCount;
+
+    SamsungExynos4PhonebookReader(SamsungExynos4RIL ril, Looper looper) {
+        super(looper);
+        mRil = ril;
+        mDepth = Math.max(0, SystemProperties.getInt("ro.ril.pb_read_ahead", DEFAULT_DEPTH));
+    }
+
+    /**
+     * Look at an ICC IO request before it is sent.
+     *
+     * @return true if the request was taken over, in which case result
+     *         will be answered from here
+     */
+    boolean
+    iccIO(int command, int fileid, String path, int p1, int p2, int p3,
+            String data, String pin2, String aid, Message result) {
+        if (mDepth == 0) {
+            return false;
+        }
+
+        switch (command) {
+            case COMMAND_GET_RESPONSE:
+                if (!isPhonebookFile(fileid, path)) {
+                    return false;
+                }
+                mRil.sendIccIO(command, fileid, path, p1, p2, p3, data, pin2, aid,
+                        obtainMessage(EVENT_GET_RESPONSE_DONE,
+                                new Request(fileid, path, aid, result)));
+                return true;
+
+            case COMMAND_READ_RECORD:
+                if (p2 != READ_RECORD_MODE_ABSOLUTE || data != null || pin2 != null) {
+                    return false;
+                }
+                return readRecord(fileid, path, p1, p3, aid, result);
+
+            case COMMAND_UPDATE_RECORD:
+                synchronized (this) {
+                    if (fileid == mFileId) {
+                        stop();
+                    }
+                }
+                return false;
+
+            default:
+                return false;
+        }
+    }
+
+    /** Forget everything read ahead, e.g. because the SIM changed */
+    synchronized void
+    reset() {
+        stop();
+    }
+
+    synchronized void
+    dump(PrintWriter pw) {
+        pw.println(" mPhonebookReader depth=" + mDepth + " readAhead=" + mReadAheadCount
+                + " hits=" + mHitCount + " wasted=" + mWastedCount);
+    }
+
+    @Override
+    public void
+    handleMessage(Message msg) {
+        AsyncResult ar = (AsyncResult) msg.obj;
+
+        switch (msg.what) {
+            case EVENT_GET_RESPONSE_DONE: {
+                Request req = (Request) ar.userObj;
+                if (ar.exception == null) {
+                    start(req, (IccIoResult) ar.result);
+                }
+                deliver(req.mResult, ar.result, ar.exception);
+                break;
+            }
+
+            case EVENT_READ_RECORD_DONE: {
+                Record record = (Record) ar.userObj;
+                Message waiter;
+                synchronized (this) {
+                    record.mDone = true;
+                    record.mResult = ar.result;
+                    record.mException = ar.exception;
+                    waiter = record.mWaiter;
+                    if (waiter != null && record.mGeneration == mGeneration) {
+                        mRecords.remove(record.mNumber);
+                        fill();
+                    }
+                }
+                if (waiter != null) {
+                    deliver(waiter, ar.result, ar.exception);
+                }
+                break;
+            }
+        }
+    }
+
+    private static boolean
+    isPhonebookFile(int fileid, String path) {
+        switch (fileid) {
+            case EF_ADN:
+            case EF_FDN:
+            case EF_SDN:
+                return true;
+            case EF_EXT1:
+            case EF_EXT2:
+            case EF_EXT3:
+                return false;
+            default:
+                return path != null && path.startsWith(DF_PHONEBOOK_PATH);
+        }
+    }
+
+    private synchronized void
+    start(Request req, IccIoResult io) {
+        byte[] data = io.payload;
+        if (!io.success() || data == null || data.length < GET_RESPONSE_EF_SIZE_BYTES
+                || data[RESPONSE_DATA_FILE_TYPE] != TYPE_EF
+                || data[RESPONSE_DATA_STRUCTURE] != EF_TYPE_LINEAR_FIXED) {
+            return;
+        }
+        int size = data[RESPONSE_DATA_RECORD_LENGTH] & 0xff;
+        int fileSize = ((data[RESPONSE_DATA_FILE_SIZE_1] & 0xff) << 8)
+                | (data[RESPONSE_DATA_FILE_SIZE_2] & 0xff);
+        if (size == 0 || fileSize / size < 2) {
+            return;
+        }
+
+        stop();
+        mFileId = req.mFileId;
+        mPath = req.mPath;
+        mAid = req.mAid;
+        mRecordSize = size;
+        mRecordCount = fileSize / size;
+        mNextRecord = 1;
+        fill();
+    }
+
+    private boolean
+    readRecord(int fileid, String path, int number, int size, String aid, Message result) {
+        Object ret;
+        Throwable exception;
+
+        synchronized (this) {
+            if (fileid != mFileId || size != mRecordSize
+                    || !TextUtils.equals(path, mPath) || !TextUtils.equals(aid, mAid)
+                    || number < 1 || number > mRecordCount) {
+                return false;
+            }
+
+            // The framework has moved past these, nobody will ask again.
+            while (mRecords.size() > 0 && mRecords.keyAt(0) < number) {
+                if (mRecords.valueAt(0).mWaiter == null) {
+                    mWastedCount++;
+                }
+                mRecords.removeAt(0);
+            }
+
+            Record record = mRecords.get(number);
+            if (record == null) {
+                // Not read ahead (yet), send it now and carry on after it.
+                record = new Record(number, mGeneration);
+                record.mWaiter = result;
+                mRecords.put(number, record);
+                mNextRecord = Math.max(mNextRecord, number + 1);
+                send(record);
+                fill();
+                return true;
+            }
+            if (record.mWaiter != null) {
+                // Same record asked for twice, let the second go to the modem.
+                return false;
+            }
+
+            mHitCount++;
+            if (!record.mDone) {
+                record.mWaiter = result;
+                return true;
+            }
+            mRecords.remove(number);
+            ret = record.mResult;
+            exception = record.mException;
+            fill();
+        }
+
+        deliver(result, ret, exception);
+        return true;
+    }
+
+    /* Keep mDepth records read ahead of the framework. Caller holds the lock. */
+    private void
+    fill() {
+        while (mFileId != -1 && mRecords.size() < mDepth && mNextRecord <= mRecordCount) {
+            Record record = new Record(mNextRecord++, mGeneration);
+            mRecords.put(record.mNumber, record);
+            mReadAheadCount++;
+            send(record);
+        }
+    }
+
+    private void
+    send(Record record) {
+        mRil.sendIccIO(COMMAND_READ_RECORD, mFileId, mPath, record.mNumber,
+                READ_RECORD_MODE_ABSOLUTE, mRecordSize, null, null, mAid,
+                obtainMessage(EVENT_READ_RECORD_DONE, record));
+    }
+
+    /* Caller holds the lock */
+    private void
+    stop() {
+        if (mFileId == -1) {
+            return;
+        }
+        // Records with a waiter are still answered when they complete, the
+        // generation keeps them from touching the next file's state.
+        for (int i = 0; i < mRecords.size(); i++) {
+            if (mRecords.valueAt(i).mWaiter == null) {
+                mWastedCount++;
+            }
+        }
+        if (SamsungExynos4RIL.RILJ_LOGD) {
+            Rlog.d(SamsungExynos4RIL.RILJ_LOG_TAG, "Phonebook read-ahead done for EF "
+                    + Integer.toHexString(mFileId) + ", " + mRecordCount + " records");
+        }
+        mRecords.clear();
+        mFileId = -1;
+        mGeneration++;
+    }
+
+    private static void
+    deliver(Message result, Object ret, Throwable exception) {
+        if (result != null) {
+            AsyncResult.forMessage(result, ret, exception);
+            result.sendToTarget();
+        }
+    }
+}
@@ -19,17 +19,41 @@ package com.android.internal.telephony;
 
 import static com.android.internal.telephony.RILConstants.*;
 
+import android.content.BroadcastReceiver;
 import android.content.Context;
+import android.content.Intent;
+import android.content.IntentFilter;
+import android.hardware.display.DisplayManager;
 import android.os.AsyncResult;
+import android.os.Build;
 import android.os.Handler;
+import android.os.HandlerThread;
+import android.os.Looper;
 import android.os.Message;
 import android.os.Parcel;
 import android.os.Registrant;
-import android.telephony.ModemActivityInfo;
+import android.os.SystemClock;
+import android.os.SystemProperties;
 import android.telephony.Rlog;
+import android.telephony.SignalStrength;
+import android.util.SparseArray;
+import android.util.SparseIntArray;
+import android.view.Display;
 
 import android.telephony.PhoneNumberUtils;
 
+import com.android.internal.telephony.uicc.IccIoResult;
+import com.android.internal.telephony.uicc.IccRefreshResponse;
+import com.android.internal.telephony.uicc.IccUtils;
+
+import java.io.File;
+import java.io.FileDescriptor;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.util.ArrayList;
+import java.util.Arrays;
+import java.util.concurrent.atomic.AtomicInteger;
+
 public class SamsungExynos4RIL extends RIL implements CommandsInterface {
 
     //SAMSUNG STATES
@@ -116,11 +140,476 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
     static final int RIL_UNSOL_UTS_GET_UNREAD_SMS_STATUS = 11031;
     static final int RIL_UNSOL_MIP_CONNECT_STATUS = 11032;
 
-    private Object mCatProCmdBuffer;
+    static final int SAMSUNG_REQUEST_BASE = 10000;
+
+    /* Solicited response decoders, see sAospResponseKinds/sSamsungResponseKinds */
+    private static final byte RESPONSE_UNKNOWN = 0;
+    private static final byte RESPONSE_VOID = 1;
+    private static final byte RESPONSE_INTS = 2;
+    private static final byte RESPONSE_STRING = 3;
+    private static final byte RESPONSE_STRINGS = 4;
+    private static final byte RESPONSE_RAW = 5;
+    private static final byte RESPONSE_ICC_CARD_STATUS = 6;
+    private static final byte RESPONSE_ICC_IO = 7;
+    private static final byte RESPONSE_ICC_IO_BASE64 = 8;
+    private static final byte RESPONSE_CALL_LIST = 9;
+    private static final byte RESPONSE_FAIL_CAUSE = 10;
+    private static final byte RESPONSE_SIGNAL_STRENGTH = 11;
+    private static final byte RESPONSE_SMS = 12;
+    private static final byte RESPONSE_SETUP_DATA_CALL = 13;
+    private static final byte RESPONSE_DATA_CALL_LIST = 14;
+    private static final byte RESPONSE_CALL_FORWARD = 15;
+    private static final byte RESPONSE_OPERATOR_INFOS = 16;
+    private static final byte RESPONSE_PREFERRED_NETWORK_TYPE = 17;
+    private static final byte RESPONSE_CELL_LIST = 18;
+    private static final byte RESPONSE_CELL_INFO_LIST = 19;
+    private static final byte RESPONSE_GSM_BROADCAST_CONFIG = 20;
+    private static final byte RESPONSE_CDMA_BROADCAST_CONFIG = 21;
+    private static final byte RESPONSE_HARDWARE_CONFIG = 22;
+    private static final byte RESPONSE_RADIO_CAPABILITY = 23;
+    private static final byte RESPONSE_LCE_STATUS = 24;
+    private static final byte RESPONSE_LCE_DATA = 25;
+    private static final byte RESPONSE_ACTIVITY_DATA = 26;
+
+    /*
+     * Dense request code -> decoder tables, one for the AOSP range and one
+     * for the Samsung range starting at SAMSUNG_REQUEST_BASE. The code list
+     * follows include/telephony/ril.h:
+ egrep "^#define RIL_REQUEST_" include/telephony/ril.h \
+ | sed -re 's/#define (RIL_REQUEST_[^ ]+) .*/kinds[\1] = RESPONSE_;/'
+     * Holes decode as RESPONSE_UNKNOWN.
+     */
+    private static final byte[] sAospResponseKinds = new byte[256];
+    private static final byte[] sSamsungResponseKinds = new byte[64];
+
+    static {
+        final byte[] kinds = sAospResponseKinds;
+        kinds[RIL_REQUEST_GET_SIM_STATUS] = RESPONSE_ICC_CARD_STATUS;
+        kinds[RIL_REQUEST_ENTER_SIM_PIN] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_ENTER_SIM_PUK] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_ENTER_SIM_PIN2] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_ENTER_SIM_PUK2] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_CHANGE_SIM_PIN] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_CHANGE_SIM_PIN2] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_ENTER_NETWORK_DEPERSONALIZATION] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_GET_CURRENT_CALLS] = RESPONSE_CALL_LIST;
+        kinds[RIL_REQUEST_DIAL] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GET_IMSI] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_HANGUP] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_HANGUP_WAITING_OR_BACKGROUND] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_HANGUP_FOREGROUND_RESUME_BACKGROUND] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SWITCH_WAITING_OR_HOLDING_AND_ACTIVE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CONFERENCE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_UDUB] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_LAST_CALL_FAIL_CAUSE] = RESPONSE_FAIL_CAUSE;
+        kinds[RIL_REQUEST_SIGNAL_STRENGTH] = RESPONSE_SIGNAL_STRENGTH;
+        kinds[RIL_REQUEST_VOICE_REGISTRATION_STATE] = RESPONSE_STRINGS;
+        kinds[RIL_REQUEST_DATA_REGISTRATION_STATE] = RESPONSE_STRINGS;
+        kinds[RIL_REQUEST_OPERATOR] = RESPONSE_STRINGS;
+        kinds[RIL_REQUEST_RADIO_POWER] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_DTMF] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SEND_SMS] = RESPONSE_SMS;
+        kinds[RIL_REQUEST_SEND_SMS_EXPECT_MORE] = RESPONSE_SMS;
+        kinds[RIL_REQUEST_SETUP_DATA_CALL] = RESPONSE_SETUP_DATA_CALL;
+        kinds[RIL_REQUEST_SIM_IO] = RESPONSE_ICC_IO;
+        kinds[RIL_REQUEST_SEND_USSD] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CANCEL_USSD] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GET_CLIR] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_SET_CLIR] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_QUERY_CALL_FORWARD_STATUS] = RESPONSE_CALL_FORWARD;
+        kinds[RIL_REQUEST_SET_CALL_FORWARD] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_QUERY_CALL_WAITING] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_SET_CALL_WAITING] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SMS_ACKNOWLEDGE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GET_IMEI] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_GET_IMEISV] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_ANSWER] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_DEACTIVATE_DATA_CALL] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_QUERY_FACILITY_LOCK] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_SET_FACILITY_LOCK] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_CHANGE_BARRING_PASSWORD] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_QUERY_NETWORK_SELECTION_MODE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_SET_NETWORK_SELECTION_AUTOMATIC] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SET_NETWORK_SELECTION_MANUAL] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_QUERY_AVAILABLE_NETWORKS] = RESPONSE_OPERATOR_INFOS;
+        kinds[RIL_REQUEST_DTMF_START] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_DTMF_STOP] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_BASEBAND_VERSION] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_SEPARATE_CONNECTION] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SET_MUTE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GET_MUTE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_QUERY_CLIP] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_LAST_DATA_CALL_FAIL_CAUSE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_DATA_CALL_LIST] = RESPONSE_DATA_CALL_LIST;
+        kinds[RIL_REQUEST_RESET_RADIO] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_OEM_HOOK_RAW] = RESPONSE_RAW;
+        kinds[RIL_REQUEST_OEM_HOOK_STRINGS] = RESPONSE_STRINGS;
+        kinds[RIL_REQUEST_SCREEN_STATE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SET_SUPP_SVC_NOTIFICATION] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_WRITE_SMS_TO_SIM] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_DELETE_SMS_ON_SIM] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SET_BAND_MODE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_QUERY_AVAILABLE_BAND_MODE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_STK_GET_PROFILE] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_STK_SET_PROFILE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_STK_SEND_ENVELOPE_COMMAND] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_STK_SEND_TERMINAL_RESPONSE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_STK_HANDLE_CALL_SETUP_REQUESTED_FROM_SIM] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_EXPLICIT_CALL_TRANSFER] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SET_PREFERRED_NETWORK_TYPE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GET_PREFERRED_NETWORK_TYPE] = RESPONSE_PREFERRED_NETWORK_TYPE;
+        kinds[RIL_REQUEST_GET_NEIGHBORING_CELL_IDS] = RESPONSE_CELL_LIST;
+        kinds[RIL_REQUEST_SET_LOCATION_UPDATES] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_SET_SUBSCRIPTION_SOURCE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_SET_ROAMING_PREFERENCE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_QUERY_ROAMING_PREFERENCE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_SET_TTY_MODE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_QUERY_TTY_MODE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_CDMA_SET_PREFERRED_VOICE_PRIVACY_MODE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_QUERY_PREFERRED_VOICE_PRIVACY_MODE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_CDMA_FLASH] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_BURST_DTMF] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_SEND_SMS] = RESPONSE_SMS;
+        kinds[RIL_REQUEST_CDMA_SMS_ACKNOWLEDGE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GSM_GET_BROADCAST_CONFIG] = RESPONSE_GSM_BROADCAST_CONFIG;
+        kinds[RIL_REQUEST_GSM_SET_BROADCAST_CONFIG] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GSM_BROADCAST_ACTIVATION] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_GET_BROADCAST_CONFIG] = RESPONSE_CDMA_BROADCAST_CONFIG;
+        kinds[RIL_REQUEST_CDMA_SET_BROADCAST_CONFIG] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_BROADCAST_ACTIVATION] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_VALIDATE_AND_WRITE_AKEY] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_SUBSCRIPTION] = RESPONSE_STRINGS;
+        kinds[RIL_REQUEST_CDMA_WRITE_SMS_TO_RUIM] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_CDMA_DELETE_SMS_ON_RUIM] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_DEVICE_IDENTITY] = RESPONSE_STRINGS;
+        kinds[RIL_REQUEST_EXIT_EMERGENCY_CALLBACK_MODE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GET_SMSC_ADDRESS] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_SET_SMSC_ADDRESS] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_REPORT_SMS_MEMORY_STATUS] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_REPORT_STK_SERVICE_IS_RUNNING] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_CDMA_GET_SUBSCRIPTION_SOURCE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_ISIM_AUTHENTICATION] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_ACKNOWLEDGE_INCOMING_GSM_SMS_WITH_PDU] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_STK_SEND_ENVELOPE_WITH_STATUS] = RESPONSE_ICC_IO;
+        kinds[RIL_REQUEST_VOICE_RADIO_TECH] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_GET_CELL_INFO_LIST] = RESPONSE_CELL_INFO_LIST;
+        kinds[RIL_REQUEST_SET_UNSOL_CELL_INFO_LIST_RATE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SET_INITIAL_ATTACH_APN] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_IMS_REGISTRATION_STATE] = RESPONSE_INTS;
+        kinds[RIL_REQUEST_IMS_SEND_SMS] = RESPONSE_SMS;
+        kinds[RIL_REQUEST_SIM_TRANSMIT_APDU_BASIC] = RESPONSE_ICC_IO;
+        kinds[RILConstants.RIL_REQUEST_SIM_OPEN_CHANNEL] = RESPONSE_INTS;
+        kinds[RILConstants.RIL_REQUEST_SIM_CLOSE_CHANNEL] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SIM_TRANSMIT_APDU_CHANNEL] = RESPONSE_ICC_IO;
+        kinds[RIL_REQUEST_NV_READ_ITEM] = RESPONSE_STRING;
+        kinds[RIL_REQUEST_NV_WRITE_ITEM] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_NV_WRITE_CDMA_PRL] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_NV_RESET_CONFIG] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SET_UICC_SUBSCRIPTION] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_ALLOW_DATA] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GET_HARDWARE_CONFIG] = RESPONSE_HARDWARE_CONFIG;
+        kinds[RIL_REQUEST_SIM_AUTHENTICATION] = RESPONSE_ICC_IO_BASE64;
+        kinds[RIL_REQUEST_SET_DATA_PROFILE] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_SHUTDOWN] = RESPONSE_VOID;
+        kinds[RIL_REQUEST_GET_RADIO_CAPABILITY] = RESPONSE_RADIO_CAPABILITY;
+        kinds[RIL_REQUEST_SET_RADIO_CAPABILITY] = RESPONSE_RADIO_CAPABILITY;
+        kinds[RIL_REQUEST_START_LCE] = RESPONSE_LCE_STATUS;
+        kinds[RIL_REQUEST_STOP_LCE] = RESPONSE_LCE_STATUS;
+        kinds[RIL_REQUEST_PULL_LCEDATA] = RESPONSE_LCE_DATA;
+        kinds[RIL_REQUEST_GET_ACTIVITY_INFO] = RESPONSE_ACTIVITY_DATA;
+        kinds[RIL_REQUEST_SIM_GET_ATR] = RESPONSE_STRING;
+
+        final byte[] samsung = sSamsungResponseKinds;
+        final int base = SAMSUNG_REQUEST_BASE;
+        /*
+         * Only requests answered without a payload, plus SIM_OPEN_CHANNEL
+         * as decoded before, are listed. The payload layout of the other
+         * Samsung answers (phonebook, SIM SMS, time info, serial numbers,
+         * ...) is undocumented; they stay RESPONSE_UNKNOWN and fail rather
+         * than decode into garbage until checked against libsec-ril.
+         */
+        samsung[RIL_REQUEST_SEND_ENCODED_USSD - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_SET_PDA_MEMORY_STATUS - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_DIAL_VIDEO_CALL - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_CALL_DEFLECTION - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_DIAL_EMERGENCY - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_STK_SIM_INIT_EVENT - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_SET_LINE_ID - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_SIM_OPEN_CHANNEL - base] = RESPONSE_INTS;
+        samsung[RIL_REQUEST_SIM_CLOSE_CHANNEL - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_PS_ATTACH - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_PS_DETACH - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_ACTIVATE_DATA_CALL - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_OMADM_SETUP_SESSION - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_OMADM_SERVER_START_SESSION - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_OMADM_CLIENT_START_SESSION - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_OMADM_SEND_DATA - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_CDMA_SET_DATAPROFILE - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_CDMA_SET_SYSTEMPROPERTIES - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_SEND_SMS_COUNT - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_SEND_SMS_MSG - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_SEND_SMS_MSG_READ_STATUS - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_MODEM_HANGUP - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_SET_PREFERRED_NETWORK_LIST - base] = RESPONSE_VOID;
+        samsung[RIL_REQUEST_HANGUP_VT - base] = RESPONSE_VOID;
+    }
+
+    /* Requests unanswered for this long are dropped from mPendingRequests */
+    private static final long PENDING_REQUEST_TIMEOUT_MS = 5 * 60 * 1000;
+
+    /* Default deadlines for the requests we cancel, see requestTimeout() */
+    private static final long NETWORK_SCAN_TIMEOUT_MS = 3 * 60 * 1000;
+    private static final long NETWORK_SELECTION_TIMEOUT_MS = 2 * 60 * 1000;
+
+    private static final int EVENT_SWEEP_PENDING_REQUESTS = 1;
+    private static final int EVENT_FLUSH_SIGNAL_STRENGTH = 2;
+    private static final int EVENT_SCREEN_STATE_CHANGED = 3;
+    private static final int EVENT_FLUSH_NETWORK_STATE = 4;
+    private static final int EVENT_SEND_SMS_EXPECT_MORE_DONE = 5;
+    private static final int EVENT_DRAIN_REQUESTS = 6;
+    private static final int EVENT_SAVE_WARM_START = 7;
+    private static final int EVENT_DRAIN_DATA_CALLS = 8;
+
+    /* Whether the modem takes RIL_REQUEST_SEND_SMS_EXPECT_MORE */
+    private static final int EXPECT_MORE_UNKNOWN = 0;
+    private static final int EXPECT_MORE_SUPPORTED = 1;
+    private static final int EXPECT_MORE_UNSUPPORTED = 2;
+
+    /* Unsol coalescing while the screen is off, see updateScreenState() */
+    private static final long SCREEN_OFF_NETWORK_STATE_INTERVAL_MS = 30 * 1000;
+
+    /*
+     * Where the parcel trace goes on request, on debuggable builds:
+     * adb shell am broadcast -a com.android.internal.telephony.SAVE_RIL_TRACE
+     */
+    private static final String TRACE_FILE = "/data/misc/radio/ril-trace.bin";
+    private static final String ACTION_SAVE_TRACE =
+            "com.android.internal.telephony.SAVE_RIL_TRACE";
+
+    private static final String WARM_START_FILE = "/data/misc/radio/ril-warm-start.bin";
+    /* Batch snapshot writes, the boot burst changes it many times */
+    private static final long WARM_START_SAVE_DELAY_MS = 30 * 1000;
+
+    /* Early unsols kept per code until a registrant attaches */
+    private static final int UNSOL_REPLAY_CAPACITY = 8;
     /* private Message mPendingGetSimStatus; */
 
+    /*
+     * RIL's constructor starts the receiver thread, which may call send()
+     * and processUnsolicited() before the fields below are assigned, so
+     * those paths must tolerate them being null.
+     */
+    private final SamsungExynos4PendingRequests mPendingRequests;
+    private final SamsungExynos4LatencyHistograms mLatencyHistograms;
+    private final SamsungExynos4RequestScheduler mRequestScheduler;
+    private final SamsungExynos4DataCalls mDataCalls;
+    private final SamsungExynos4LceEngine mLce;
+    private final SamsungExynos4IdentityCache mIdentityCache;
+    private final SamsungExynos4WarmStart mWarmStart;
+    private final DeviceHandler mDeviceHandler;
+    private final SamsungExynos4PhonebookReader mPhonebookReader;
+    private final SamsungExynos4SignalStrengthFilter mSignalStrengthFilter;
+    /* Created on first use, possibly before the constructor body runs */
+    private SamsungExynos4UnsolReplay mUnsolReplay;
+    private SamsungExynos4ModemActivity mModemActivity;
+    private final SamsungExynos4ParcelRecorder mParcelRecorder;
+    private final long mSignalMaxIntervalMs;
+    private final long mScreenOffSignalMaxIntervalMs;
+    private final DisplayManager mDisplayManager;
+    /* Serializes unsol handling between the receiver and trace replay */
+    private final Object mUnsolLock = new Object();
+
+    /* Screen off profile state, guarded by mScreenLock */
+    private final Object mScreenLock = new Object();
+    private boolean mScreenOff;
+    private int mCellInfoListRate = -1;
+    private boolean mLocationUpdates;
+    private boolean mNetworkStatePending;
+    private long mScreenOffSince;
+    private long mScreenOffTotalMs;
+    private long mScreenOffSignalDroppedBase;
+    private long mAvoidedWakeups;
+
+    private volatile int mExpectMoreSupport = EXPECT_MORE_UNKNOWN;
+    private final AtomicInteger mExpectMoreSent = new AtomicInteger();
+    private final AtomicInteger mExpectMoreFallbacks = new AtomicInteger();
+    private long mNextSweepAt = SamsungExynos4PendingRequests.NO_DEADLINE;
+    private int mStaleRequestCount;
+    private final long mNetworkScanTimeoutMs;
+    private final long mNetworkSelectionTimeoutMs;
+    /* Requests answered with REQUEST_CANCELLED per code, guarded by itself */
+    private final SparseIntArray mCancelledRequests = new SparseIntArray();
+
     public SamsungExynos4RIL(Context context, int networkMode, int cdmaSubscription, Integer instanceId) {
         super(context, networkMode, cdmaSubscription, instanceId);
+
+        HandlerThread thread = new HandlerThread("SamsungExynos4RIL");
+        thread.start();
+        mDeviceHandler = new DeviceHandler(thread.getLooper());
+        mNetworkScanTimeoutMs = SystemProperties.getLong("ro.ril.network_scan_timeout_ms",
+                NETWORK_SCAN_TIMEOUT_MS);
+        mNetworkSelectionTimeoutMs = SystemProperties.getLong(
+                "ro.ril.network_selection_timeout_ms", NETWORK_SELECTION_TIMEOUT_MS);
+        mPendingRequests = new SamsungExynos4PendingRequests();
+        mLatencyHistograms = new SamsungExynos4LatencyHistograms();
+        mIdentityCache = new SamsungExynos4IdentityCache();
+        if (SystemProperties.getBoolean("ro.ril.warm_start", true)) {
+            mWarmStart = new SamsungExynos4WarmStart(new File(WARM_START_FILE));
+            mWarmStart.load();
+        } else {
+            mWarmStart = null;
+        }
+        mRequestScheduler = new SamsungExynos4RequestScheduler(
+                new SamsungExynos4RequestScheduler.Dispatcher() {
+                    @Override
+                    public void dispatch(RILRequest rr, long sentAt) {
+                        sendNow(rr, sentAt);
+                        // super.send() took its own, drop the one taken when held.
+                        decrementWakeLock();
+                    }
+
+                    @Override
+                    public boolean isOutstanding(int serial) {
+                        synchronized (mRequestList) {
+                            return mRequestList.get(serial) != null;
+                        }
+                    }
+                },
+                // No lower than the phonebook read-ahead depth, or boot SIM loading
+                // queues up behind it.
+                SystemProperties.getInt("ro.ril.bulk_requests_in_flight", 8),
+                SystemProperties.getLong("ro.ril.bulk_request_max_wait_ms", 2000));
+        mDataCalls = new SamsungExynos4DataCalls(
+                new SamsungExynos4RequestScheduler.Dispatcher() {
+                    @Override
+                    public void dispatch(RILRequest rr, long sentAt) {
+                        sendScheduled(rr, sentAt);
+                        decrementWakeLock();
+                    }
+
+                    @Override
+                    public boolean isOutstanding(int serial) {
+                        synchronized (mRequestList) {
+                            return mRequestList.get(serial) != null;
+                        }
+                    }
+                },
+                SystemProperties.getInt("ro.ril.data_calls_in_flight", 1),
+                SystemProperties.get("ro.ril.priority_apns", ""),
+                SystemProperties.getBoolean("ro.ril.ps_attach_early", false));
+        if (SystemProperties.getBoolean("ro.ril.lce_emulation", true)) {
+            mLce = new SamsungExynos4LceEngine(thread.getLooper(), dataIface(),
+                    new SamsungExynos4LceEngine.Listener() {
+                        @Override
+                        public void onLceData(ArrayList<Integer> data) {
+                            notifyLceData(data);
+                        }
+                    });
+        } else {
+            mLce = null;
+        }
+        // The ring holds modem traffic, even redacted it stays off user builds.
+        int traceKb = Build.IS_DEBUGGABLE
+                ? SystemProperties.getInt("ro.ril.trace_buffer_kb", 256) : 0;
+        mParcelRecorder = traceKb > 0 ? new SamsungExynos4ParcelRecorder(traceKb * 1024) : null;
+        mPhonebookReader = new SamsungExynos4PhonebookReader(this, thread.getLooper());
+        mSignalMaxIntervalMs = SystemProperties.getLong("ro.ril.signal_max_interval_ms", 10000);
+        mScreenOffSignalMaxIntervalMs = SystemProperties.getLong(
+                "ro.ril.screen_off_signal_max_interval_ms", 60 * 1000);
+        mSignalStrengthFilter = new SamsungExynos4SignalStrengthFilter(
+                SystemProperties.getInt("ro.ril.signal_hysteresis", 2), mSignalMaxIntervalMs);
+
+        // Opt-in, see sendSMSExpectMore()
+        String expectMore = SystemProperties.get("ro.ril.sms_expect_more", "false");
+        if ("true".equals(expectMore)) {
+            mExpectMoreSupport = EXPECT_MORE_SUPPORTED;
+        } else if (!"auto".equals(expectMore)) {
+            mExpectMoreSupport = EXPECT_MORE_UNSUPPORTED;
+        }
+
+        mDisplayManager = (DisplayManager) context.getSystemService(Context.DISPLAY_SERVICE);
+        mDisplayManager.registerDisplayListener(mDisplayListener, mDeviceHandler);
+        mDeviceHandler.sendEmptyMessage(EVENT_SCREEN_STATE_CHANGED);
+
+        if (mParcelRecorder != null) {
+            context.registerReceiver(mSaveTraceReceiver, new IntentFilter(ACTION_SAVE_TRACE),
+                    android.Manifest.permission.DUMP, mDeviceHandler);
+        }
+
+        String replay = SystemProperties.get("debug.ril.replay_trace");
+        if (Build.IS_DEBUGGABLE && !replay.isEmpty()) {
+            double speed = 1;
+            try {
+                speed = Double.parseDouble(SystemProperties.get("debug.ril.replay_speed", "1"));
+            } catch (NumberFormatException e) {
+            }
+            new SamsungExynos4TraceReplay(this, mDeviceHandler, new File(replay), speed,
+                    SystemProperties.getLong("debug.ril.replay_delay_ms", 30 * 1000)).start();
+        }
+    }
+
+    private final DisplayManager.DisplayListener mDisplayListener =
+            new DisplayManager.DisplayListener() {
+        @Override
+        public void onDisplayAdded(int displayId) { }
+
+        @Override
+        public void onDisplayRemoved(int displayId) { }
+
+        @Override
+        public void onDisplayChanged(int displayId) {
+            if (displayId == Display.DEFAULT_DISPLAY) {
+                updateScreenState();
+            }
+        }
+    };
+
+    private final BroadcastReceiver mSaveTraceReceiver = new BroadcastReceiver() {
+        @Override
+        public void onReceive(Context context, Intent intent) {
+            try {
+                mParcelRecorder.save(new File(TRACE_FILE));
+                Rlog.i(RILJ_LOG_TAG, "Parcel trace saved to " + TRACE_FILE);
+            } catch (IOException e) {
+                Rlog.e(RILJ_LOG_TAG, "Could not save parcel trace to " + TRACE_FILE, e);
+            }
+        }
+    };
+
+    private class DeviceHandler extends Handler {
+        DeviceHandler(Looper looper) {
+            super(looper);
+        }
+
+        @Override
+        public void handleMessage(Message msg) {
+            switch (msg.what) {
+                case EVENT_SWEEP_PENDING_REQUESTS:
+                    sweepPendingRequests();
+                    break;
+                case EVENT_FLUSH_SIGNAL_STRENGTH:
+                    flushSignalStrength();
+                    break;
+                case EVENT_SCREEN_STATE_CHANGED:
+                    updateScreenState();
+                    break;
+                case EVENT_FLUSH_NETWORK_STATE:
+                    flushNetworkState();
+                    break;
+                case EVENT_SEND_SMS_EXPECT_MORE_DONE:
+                    onSendSmsExpectMoreDone((AsyncResult) msg.obj);
+                    break;
+                case EVENT_DRAIN_REQUESTS:
+                    scheduleRequestDrain(mRequestScheduler.drain(SystemClock.elapsedRealtime()));
+                    break;
+                case EVENT_SAVE_WARM_START:
+                    mWarmStart.save();
+                    break;
+                case EVENT_DRAIN_DATA_CALLS:
+                    scheduleDataCallDrain(mDataCalls.drain(SystemClock.elapsedRealtime()));
+                    break;
+            }
+        }
     }
 
     static String
@@ -139,19 +628,104 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
         }
     }
 
+    private static int
+    responseKind(int request) {
+        if (request >= 0 && request < sAospResponseKinds.length) {
+            return sAospResponseKinds[request];
+        }
+        int index = request - SAMSUNG_REQUEST_BASE;
+        if (index >= 0 && index < sSamsungResponseKinds.length) {
+            return sSamsungResponseKinds[index];
+        }
+        return RESPONSE_UNKNOWN;
+    }
+
+    private Object
+    decodeResponse(int kind, Parcel p) {
+        switch (kind) {
+            case RESPONSE_VOID: return responseVoid(p);
+            case RESPONSE_INTS: return responseInts(p);
+            case RESPONSE_STRING: return responseString(p);
+            case RESPONSE_STRINGS: return responseStrings(p);
+            case RESPONSE_RAW: return responseRaw(p);
+            case RESPONSE_ICC_CARD_STATUS: return responseIccCardStatus(p);
+            case RESPONSE_ICC_IO: return responseIccIo(p);
+            case RESPONSE_ICC_IO_BASE64: return responseICC_IOBase64(p);
+            case RESPONSE_CALL_LIST: return responseCallList(p);
+            case RESPONSE_FAIL_CAUSE: return responseFailCause(p);
+            case RESPONSE_SIGNAL_STRENGTH: return responseSignalStrength(p);
+            case RESPONSE_SMS: return responseSMS(p);
+            case RESPONSE_SETUP_DATA_CALL: return responseSetupDataCall(p);
+            case RESPONSE_DATA_CALL_LIST:
+                if (mDataCalls != null) {
+                    return mDataCalls.decodeDataCallList(this, p).mList;
+                }
+                return responseDataCallList(p);
+            case RESPONSE_CALL_FORWARD: return responseCallForward(p);
+            case RESPONSE_OPERATOR_INFOS: return responseOperatorInfos(p);
+            case RESPONSE_PREFERRED_NETWORK_TYPE: return responseGetPreferredNetworkType(p);
+            case RESPONSE_CELL_LIST: return responseCellList(p);
+            case RESPONSE_CELL_INFO_LIST: return responseCellInfoList(p);
+            case RESPONSE_GSM_BROADCAST_CONFIG: return responseGmsBroadcastConfig(p);
+            case RESPONSE_CDMA_BROADCAST_CONFIG: return responseCdmaBroadcastConfig(p);
+            case RESPONSE_HARDWARE_CONFIG: return responseHardwareConfig(p);
+            case RESPONSE_RADIO_CAPABILITY: return responseRadioCapability(p);
+            case RESPONSE_LCE_STATUS: return responseLceStatus(p);
+            case RESPONSE_LCE_DATA: return responseLceData(p);
+            case RESPONSE_ACTIVITY_DATA: return responseActivityData(p);
+            default:
+                throw new RuntimeException("Unrecognized response decoder: " + kind);
+        }
+    }
+
+    private Object
+    responseIccIo(Parcel p) {
+        IccIoResult ret = SamsungExynos4IccIoDecoder.decode(p);
+
+        if (RILJ_LOGV) riljLog("< iccIO: "
+                + " 0x" + Integer.toHexString(ret.sw1)
+                + " 0x" + Integer.toHexString(ret.sw2) + " "
+                + IccUtils.bytesToHexString(ret.payload));
+        return ret;
+    }
 
     @Override
     protected RILRequest processSolicited (Parcel p) {
         int serial, error;
         boolean found = false;
+        long arrivalNs = mParcelRecorder != null ? SystemClock.elapsedRealtimeNanos() : 0;
 
         serial = p.readInt();
         error = p.readInt();
 
+        if (mWarmStart != null && mWarmStart.tracks(serial)) {
+            validateWarmStart(serial, error, p);
+        }
+
+        long sentAt = -1;
+        if (mPendingRequests != null) {
+            sentAt = mPendingRequests.sentAt(serial);
+            mPendingRequests.remove(serial);
+        }
+        if (mRequestScheduler != null) {
+            scheduleRequestDrain(mRequestScheduler.complete(serial,
+                    SystemClock.elapsedRealtime()));
+        }
+        if (mDataCalls != null) {
+            scheduleDataCallDrain(mDataCalls.complete(serial, error,
+                    SystemClock.elapsedRealtime()));
+        }
+
         RILRequest rr;
 
         rr = findAndRemoveRequestFromList(serial);
 
+        if (mParcelRecorder != null) {
+            mParcelRecorder.record(SamsungExynos4ParcelRecorder.ENTRY_SOLICITED, arrivalNs, p,
+                    SamsungExynos4ParcelRecorder.isSensitiveRequest(
+                            rr != null ? rr.mRequest : -1));
+        }
+
         if (rr == null) {
             Rlog.w(RILJ_LOG_TAG, "Unexpected solicited response! sn: "
                             + serial + " error: " + error);
@@ -162,160 +736,21 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
 
         if (error == 0 || p.dataAvail() > 0) {
             // either command succeeds or command fails but with data payload
-            try {switch (rr.mRequest) {
-            /*
- cat libs/telephony/ril_commands.h \
- | egrep "^ *{RIL_" \
- | sed -re 's/\{([^,]+),[^,]+,([^}]+).+/case \1: ret = \2(p); break;/'
-             */
-            case RIL_REQUEST_GET_SIM_STATUS: ret =  responseIccCardStatus(p); break;
-            case RIL_REQUEST_ENTER_SIM_PIN: ret =  responseInts(p); break;
-            case RIL_REQUEST_ENTER_SIM_PUK: ret =  responseInts(p); break;
-            case RIL_REQUEST_ENTER_SIM_PIN2: ret =  responseInts(p); break;
-            case RIL_REQUEST_ENTER_SIM_PUK2: ret =  responseInts(p); break;
-            case RIL_REQUEST_CHANGE_SIM_PIN: ret =  responseInts(p); break;
-            case RIL_REQUEST_CHANGE_SIM_PIN2: ret =  responseInts(p); break;
-            case RIL_REQUEST_ENTER_NETWORK_DEPERSONALIZATION: ret =  responseInts(p); break;
-            case RIL_REQUEST_GET_CURRENT_CALLS: ret =  responseCallList(p); break;
-            case RIL_REQUEST_DIAL: ret =  responseVoid(p); break;
-            case RIL_REQUEST_DIAL_EMERGENCY: ret =  responseVoid(p); break;
-            case RIL_REQUEST_GET_IMSI: ret =  responseString(p); break;
-            case RIL_REQUEST_HANGUP: ret =  responseVoid(p); break;
-            case RIL_REQUEST_HANGUP_WAITING_OR_BACKGROUND: ret =  responseVoid(p); break;
-            case RIL_REQUEST_HANGUP_FOREGROUND_RESUME_BACKGROUND: {
-                if (mTestingEmergencyCall.getAndSet(false)) {
+            try {
+                if (rr.mRequest == RIL_REQUEST_HANGUP_FOREGROUND_RESUME_BACKGROUND
+                        && mTestingEmergencyCall.getAndSet(false)) {
                     if (mEmergencyCallbackModeRegistrant != null) {
                         riljLog("testing emergency call, notify ECM Registrants");
                         mEmergencyCallbackModeRegistrant.notifyRegistrant();
                     }
                 }
-                ret =  responseVoid(p);
-                break;
-            }
-            case RIL_REQUEST_SWITCH_WAITING_OR_HOLDING_AND_ACTIVE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CONFERENCE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_UDUB: ret =  responseVoid(p); break;
-            case RIL_REQUEST_LAST_CALL_FAIL_CAUSE: ret =  responseFailCause(p); break;
-            case RIL_REQUEST_SIGNAL_STRENGTH: ret =  responseSignalStrength(p); break;
-            case RIL_REQUEST_VOICE_REGISTRATION_STATE: ret =  responseStrings(p); break;
-            case RIL_REQUEST_DATA_REGISTRATION_STATE: ret =  responseStrings(p); break;
-            case RIL_REQUEST_OPERATOR: ret =  responseStrings(p); break;
-            case RIL_REQUEST_RADIO_POWER: ret =  responseVoid(p); break;
-            case RIL_REQUEST_DTMF: ret =  responseVoid(p); break;
-            case RIL_REQUEST_SEND_SMS: ret =  responseSMS(p); break;
-            case RIL_REQUEST_SEND_SMS_EXPECT_MORE: ret =  responseSMS(p); break;
-            case RIL_REQUEST_SETUP_DATA_CALL: ret =  responseSetupDataCall(p); break;
-            case RIL_REQUEST_SIM_IO: ret =  responseICC_IO(p); break;
-            case RIL_REQUEST_SEND_USSD: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CANCEL_USSD: ret =  responseVoid(p); break;
-            case RIL_REQUEST_GET_CLIR: ret =  responseInts(p); break;
-            case RIL_REQUEST_SET_CLIR: ret =  responseVoid(p); break;
-            case RIL_REQUEST_QUERY_CALL_FORWARD_STATUS: ret =  responseCallForward(p); break;
-            case RIL_REQUEST_SET_CALL_FORWARD: ret =  responseVoid(p); break;
-            case RIL_REQUEST_QUERY_CALL_WAITING: ret =  responseInts(p); break;
-            case RIL_REQUEST_SET_CALL_WAITING: ret =  responseVoid(p); break;
-            case RIL_REQUEST_SMS_ACKNOWLEDGE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_GET_IMEI: ret =  responseString(p); break;
-            case RIL_REQUEST_GET_IMEISV: ret =  responseString(p); break;
-            case RIL_REQUEST_ANSWER: ret =  responseVoid(p); break;
-            case RIL_REQUEST_DEACTIVATE_DATA_CALL: ret =  responseVoid(p); break;
-            case RIL_REQUEST_QUERY_FACILITY_LOCK: ret =  responseInts(p); break;
-            case RIL_REQUEST_SET_FACILITY_LOCK: ret =  responseInts(p); break;
-            case RIL_REQUEST_CHANGE_BARRING_PASSWORD: ret =  responseVoid(p); break;
-            case RIL_REQUEST_QUERY_NETWORK_SELECTION_MODE: ret =  responseInts(p); break;
-            case RIL_REQUEST_SET_NETWORK_SELECTION_AUTOMATIC: ret =  responseVoid(p); break;
-            case RIL_REQUEST_SET_NETWORK_SELECTION_MANUAL: ret =  responseVoid(p); break;
-            case RIL_REQUEST_QUERY_AVAILABLE_NETWORKS : ret =  responseOperatorInfos(p); break;
-            case RIL_REQUEST_DTMF_START: ret =  responseVoid(p); break;
-            case RIL_REQUEST_DTMF_STOP: ret =  responseVoid(p); break;
-            case RIL_REQUEST_BASEBAND_VERSION: ret =  responseString(p); break;
-            case RIL_REQUEST_SEPARATE_CONNECTION: ret =  responseVoid(p); break;
-            case RIL_REQUEST_SET_MUTE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_GET_MUTE: ret =  responseInts(p); break;
-            case RIL_REQUEST_QUERY_CLIP: ret =  responseInts(p); break;
-            case RIL_REQUEST_LAST_DATA_CALL_FAIL_CAUSE: ret =  responseInts(p); break;
-            case RIL_REQUEST_DATA_CALL_LIST: ret =  responseDataCallList(p); break;
-            case RIL_REQUEST_RESET_RADIO: ret =  responseVoid(p); break;
-            case RIL_REQUEST_OEM_HOOK_RAW: ret =  responseRaw(p); break;
-            case RIL_REQUEST_OEM_HOOK_STRINGS: ret =  responseStrings(p); break;
-            case RIL_REQUEST_SCREEN_STATE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_SET_SUPP_SVC_NOTIFICATION: ret =  responseVoid(p); break;
-            case RIL_REQUEST_WRITE_SMS_TO_SIM: ret =  responseInts(p); break;
-            case RIL_REQUEST_DELETE_SMS_ON_SIM: ret =  responseVoid(p); break;
-            case RIL_REQUEST_SET_BAND_MODE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_QUERY_AVAILABLE_BAND_MODE: ret =  responseInts(p); break;
-            case RIL_REQUEST_STK_GET_PROFILE: ret =  responseString(p); break;
-            case RIL_REQUEST_STK_SET_PROFILE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_STK_SEND_ENVELOPE_COMMAND: ret =  responseString(p); break;
-            case RIL_REQUEST_STK_SEND_TERMINAL_RESPONSE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_STK_HANDLE_CALL_SETUP_REQUESTED_FROM_SIM: ret =  responseInts(p); break;
-            case RIL_REQUEST_EXPLICIT_CALL_TRANSFER: ret =  responseVoid(p); break;
-            case RIL_REQUEST_SET_PREFERRED_NETWORK_TYPE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_GET_PREFERRED_NETWORK_TYPE: ret =  responseGetPreferredNetworkType(p); break;
-            case RIL_REQUEST_GET_NEIGHBORING_CELL_IDS: ret = responseCellList(p); break;
-            case RIL_REQUEST_SET_LOCATION_UPDATES: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_SET_SUBSCRIPTION_SOURCE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_SET_ROAMING_PREFERENCE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_QUERY_ROAMING_PREFERENCE: ret =  responseInts(p); break;
-            case RIL_REQUEST_SET_TTY_MODE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_QUERY_TTY_MODE: ret =  responseInts(p); break;
-            case RIL_REQUEST_CDMA_SET_PREFERRED_VOICE_PRIVACY_MODE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_QUERY_PREFERRED_VOICE_PRIVACY_MODE: ret =  responseInts(p); break;
-            case RIL_REQUEST_CDMA_FLASH: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_BURST_DTMF: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_SEND_SMS: ret =  responseSMS(p); break;
-            case RIL_REQUEST_CDMA_SMS_ACKNOWLEDGE: ret =  responseVoid(p); break;
-            case RIL_REQUEST_GSM_GET_BROADCAST_CONFIG: ret =  responseGmsBroadcastConfig(p); break;
-            case RIL_REQUEST_GSM_SET_BROADCAST_CONFIG: ret =  responseVoid(p); break;
-            case RIL_REQUEST_GSM_BROADCAST_ACTIVATION: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_GET_BROADCAST_CONFIG: ret =  responseCdmaBroadcastConfig(p); break;
-            case RIL_REQUEST_CDMA_SET_BROADCAST_CONFIG: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_BROADCAST_ACTIVATION: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_VALIDATE_AND_WRITE_AKEY: ret =  responseVoid(p); break;
-            case RIL_REQUEST_CDMA_SUBSCRIPTION: ret =  responseStrings(p); break;
-            case RIL_REQUEST_CDMA_WRITE_SMS_TO_RUIM: ret =  responseInts(p); break;
-            case RIL_REQUEST_CDMA_DELETE_SMS_ON_RUIM: ret =  responseVoid(p); break;
-            case RIL_REQUEST_DEVICE_IDENTITY: ret =  responseStrings(p); break;
-            case RIL_REQUEST_GET_SMSC_ADDRESS: ret = responseString(p); break;
-            case RIL_REQUEST_SET_SMSC_ADDRESS: ret = responseVoid(p); break;
-            case RIL_REQUEST_EXIT_EMERGENCY_CALLBACK_MODE: ret = responseVoid(p); break;
-            case RIL_REQUEST_REPORT_SMS_MEMORY_STATUS: ret = responseVoid(p); break;
-            case RIL_REQUEST_REPORT_STK_SERVICE_IS_RUNNING: ret = responseVoid(p); break;
-            case RIL_REQUEST_CDMA_GET_SUBSCRIPTION_SOURCE: ret =  responseInts(p); break;
-            case RIL_REQUEST_ISIM_AUTHENTICATION: ret =  responseString(p); break;
-            case RIL_REQUEST_ACKNOWLEDGE_INCOMING_GSM_SMS_WITH_PDU: ret = responseVoid(p); break;
-            case RIL_REQUEST_STK_SEND_ENVELOPE_WITH_STATUS: ret = responseICC_IO(p); break;
-            case RIL_REQUEST_VOICE_RADIO_TECH: ret = responseInts(p); break;
-            case RIL_REQUEST_GET_CELL_INFO_LIST: ret = responseCellInfoList(p); break;
-            case RIL_REQUEST_SET_UNSOL_CELL_INFO_LIST_RATE: ret = responseVoid(p); break;
-            case RIL_REQUEST_SET_INITIAL_ATTACH_APN: ret = responseVoid(p); break;
-            case RIL_REQUEST_SET_DATA_PROFILE: ret = responseVoid(p); break;
-            case RIL_REQUEST_IMS_REGISTRATION_STATE: ret = responseInts(p); break;
-            case RIL_REQUEST_IMS_SEND_SMS: ret =  responseSMS(p); break;
-            case RIL_REQUEST_SIM_TRANSMIT_APDU_BASIC: ret =  responseICC_IO(p); break;
-            case RIL_REQUEST_SIM_OPEN_CHANNEL: ret  = responseInts(p); break;
-            case RIL_REQUEST_SIM_CLOSE_CHANNEL: ret  = responseVoid(p); break;
-            case RIL_REQUEST_SIM_TRANSMIT_APDU_CHANNEL: ret = responseICC_IO(p); break;
-            case RIL_REQUEST_SIM_GET_ATR: ret = responseString(p); break;
-            case RIL_REQUEST_NV_READ_ITEM: ret = responseString(p); break;
-            case RIL_REQUEST_NV_WRITE_ITEM: ret = responseVoid(p); break;
-            case RIL_REQUEST_NV_WRITE_CDMA_PRL: ret = responseVoid(p); break;
-            case RIL_REQUEST_NV_RESET_CONFIG: ret = responseVoid(p); break;
-            case RIL_REQUEST_SET_UICC_SUBSCRIPTION: ret = responseVoid(p); break;
-            case RIL_REQUEST_ALLOW_DATA: ret = responseVoid(p); break;
-            case RIL_REQUEST_GET_HARDWARE_CONFIG: ret = responseHardwareConfig(p); break;
-            case RIL_REQUEST_SIM_AUTHENTICATION: ret =  responseICC_IOBase64(p); break;
-            case RIL_REQUEST_SHUTDOWN: ret = responseVoid(p); break;
-            case RIL_REQUEST_GET_RADIO_CAPABILITY: ret =  responseRadioCapability(p); break;
-            case RIL_REQUEST_SET_RADIO_CAPABILITY: ret =  responseRadioCapability(p); break;
-            case RIL_REQUEST_START_LCE: ret = responseLceStatus(p); break;
-            case RIL_REQUEST_STOP_LCE: ret = responseLceStatus(p); break;
-            case RIL_REQUEST_PULL_LCEDATA: ret = responseLceData(p); break;
-            case RIL_REQUEST_GET_ACTIVITY_INFO: ret = responseActivityData(p); break;
-            default:
-                throw new RuntimeException("Unrecognized solicited response: " + rr.mRequest);
-            //break;
-            }} catch (Throwable tr) {
+
+                int kind = responseKind(rr.mRequest);
+                if (kind == RESPONSE_UNKNOWN) {
+                    throw new RuntimeException("Unrecognized solicited response: " + rr.mRequest);
+                }
+                ret = decodeResponse(kind, p);
+            } catch (Throwable tr) {
                 // Exceptions here usually mean invalid RIL responses
 
                 Rlog.w(RILJ_LOG_TAG, rr.serialString() + "< "
@@ -326,6 +761,7 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
                     AsyncResult.forMessage(rr.mResult, null, tr);
                     rr.mResult.sendToTarget();
                 }
+                recordLatency(rr, sentAt);
                 return rr;
             }
         }
@@ -383,8 +819,7 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
                     break;
                 }
                 case RIL_REQUEST_GET_ACTIVITY_INFO:
-                    ret = new ModemActivityInfo(0, 0, 0,
-                            new int [ModemActivityInfo.TX_POWER_LEVELS], 0, 0);
+                    ret = modemActivity().snapshot();
                     error = 0;
                     break;
             }
@@ -395,15 +830,422 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
             if (RILJ_LOGD) riljLog(rr.serialString() + "< " + requestToString(rr.mRequest)
                     + " " + retToString(rr.mRequest, ret));
 
+            if (mIdentityCache != null) {
+                mIdentityCache.put(rr.mRequest, ret);
+            }
+            if (mDataCalls != null) {
+                mDataCalls.onResult(rr.mRequest, ret);
+            }
+            if (mLce != null && rr.mRequest == RIL_REQUEST_DATA_REGISTRATION_STATE) {
+                onDataRegistrationState((String[]) ret);
+            }
+            if (rr.mRequest == RIL_REQUEST_GET_CURRENT_CALLS) {
+                modemActivity().onCallCount(((ArrayList<?>) ret).size());
+            }
+
             if (rr.mResult != null) {
                 AsyncResult.forMessage(rr.mResult, ret, null);
                 rr.mResult.sendToTarget();
             }
         }
 
+        recordLatency(rr, sentAt);
         return rr;
     }
 
+    /*
+     * RILReceiver drops the radio to RADIO_UNAVAILABLE right before it
+     * clears mRequestList and restarts the serials, forget everything that
+     * was in flight along with it, and fail what was held back the way
+     * RIL fails mRequestList.
+     */
+    @Override
+    protected void
+    setRadioState(RadioState newState) {
+        if (newState == RadioState.RADIO_UNAVAILABLE) {
+            if (mPendingRequests != null) {
+                mPendingRequests.clear();
+            }
+            if (mRequestScheduler != null) {
+                failHeld(mRequestScheduler.clear());
+            }
+            if (mDataCalls != null) {
+                failHeld(mDataCalls.clear());
+            }
+        }
+        super.setRadioState(newState);
+    }
+
+    private void
+    failHeld(ArrayList<RILRequest> held) {
+        for (RILRequest rr : held) {
+            if (RILJ_LOGD) riljLog(rr.serialString() + "< " + requestToString(rr.mRequest)
+                    + " held back, radio unavailable");
+            rr.onError(RADIO_NOT_AVAILABLE, null);
+            rr.release();
+            decrementWakeLock();
+        }
+    }
+
+    private void
+    recordLatency(RILRequest rr, long sentAt) {
+        if (sentAt >= 0 && mLatencyHistograms != null) {
+            mLatencyHistograms.record(rr.mRequest, SystemClock.elapsedRealtime() - sentAt);
+        }
+    }
+
+    @Override
+    protected void
+    send(RILRequest rr) {
+        if (mIdentityCache != null && SamsungExynos4IdentityCache.isCacheable(rr.mRequest)) {
+            Object cached = mIdentityCache.get(rr.mRequest);
+            if (cached != null) {
+                if (RILJ_LOGD) riljLog(rr.serialString() + "< " + requestToString(rr.mRequest)
+                        + " " + retToString(rr.mRequest, cached) + " (cached)");
+                if (rr.mResult != null) {
+                    AsyncResult.forMessage(rr.mResult, cached, null);
+                    rr.mResult.sendToTarget();
+                }
+                rr.release();
+                return;
+            }
+        }
+        if (mWarmStart != null) {
+            String key = SamsungExynos4WarmStart.key(rr);
+            if (key != null) {
+                byte[] payload = mWarmStart.onSend(rr, key);
+                if (payload != null) {
+                    answerFromSnapshot(rr, payload);
+                }
+            }
+        }
+        // Latency counts from here, time spent held back included.
+        long sentAt = SystemClock.elapsedRealtime();
+        if (mDataCalls == null) {
+            sendScheduled(rr, sentAt);
+            return;
+        }
+        // Same wakelock handling as sendScheduled().
+        acquireWakeLock();
+        if (mDataCalls.submit(rr, sentAt)) {
+            if (RILJ_LOGV) riljLog(rr.serialString() + "> " + requestToString(rr.mRequest)
+                    + " held back");
+            scheduleDataCallDrain(mDataCalls.drain(SystemClock.elapsedRealtime()));
+            return;
+        }
+        sendScheduled(rr, sentAt);
+        decrementWakeLock();
+    }
+
+    private void
+    sendScheduled(RILRequest rr, long sentAt) {
+        if (mRequestScheduler == null) {
+            sendNow(rr, sentAt);
+            return;
+        }
+        // Held requests keep the device up until they go out, like RIL does
+        // for mRequestList. Taken first, drain() may dispatch rr right away.
+        acquireWakeLock();
+        if (mRequestScheduler.submit(rr, SystemClock.elapsedRealtime(), sentAt)) {
+            if (RILJ_LOGV) riljLog(rr.serialString() + "> " + requestToString(rr.mRequest)
+                    + " held back");
+            scheduleRequestDrain(mRequestScheduler.drain(SystemClock.elapsedRealtime()));
+            return;
+        }
+        sendNow(rr, sentAt);
+        decrementWakeLock();
+    }
+
+    private void
+    sendNow(RILRequest rr, long sentAt) {
+        if (mPendingRequests != null) {
+            long now = SystemClock.elapsedRealtime();
+            long timeout = requestTimeout(rr.mRequest);
+            long deadline = now + (timeout > 0 ? timeout : PENDING_REQUEST_TIMEOUT_MS);
+            mPendingRequests.add(rr, sentAt, deadline);
+            scheduleSweep(deadline);
+        }
+        super.send(rr);
+    }
+
+    /*
+     * Answer rr from the warm start snapshot. rr still goes to the modem,
+     * but its answer only validates the snapshot, see validateWarmStart().
+     */
+    private void
+    answerFromSnapshot(RILRequest rr, byte[] payload) {
+        Parcel p = Parcel.obtain();
+        try {
+            p.unmarshall(payload, 0, payload.length);
+            p.setDataPosition(0);
+            Object ret = decodeResponse(responseKind(rr.mRequest), p);
+            if (RILJ_LOGD) riljLog(rr.serialString() + "< " + requestToString(rr.mRequest)
+                    + " " + retToString(rr.mRequest, ret) + " (snapshot)");
+            if (rr.mResult != null) {
+                AsyncResult.forMessage(rr.mResult, ret, null);
+                rr.mResult.sendToTarget();
+                rr.mResult = null;
+            }
+        } catch (Throwable tr) {
+            // Let the modem answer it then.
+            Rlog.w(RILJ_LOG_TAG, "Bad snapshot entry for " + requestToString(rr.mRequest), tr);
+        } finally {
+            p.recycle();
+        }
+    }
+
+    /*
+     * The framework already has an answer to whatever the snapshot served,
+     * it must not get a second one. When the served answer was wrong, have
+     * it read the state again instead.
+     */
+    private void
+    validateWarmStart(int serial, int error, Parcel p) {
+        byte[] payload = null;
+        if (error == 0) {
+            byte[] data = p.marshall();
+            payload = Arrays.copyOfRange(data, p.dataPosition(), data.length);
+        }
+
+        switch (mWarmStart.onResponse(serial, payload)) {
+            case SamsungExynos4WarmStart.MISMATCH_SIM: {
+                // As RIL_UNSOL_SIM_REFRESH would, IccRecords reloads its files.
+                IccRefreshResponse refresh = new IccRefreshResponse();
+                refresh.refreshResult = IccRefreshResponse.REFRESH_RESULT_FILE_UPDATE;
+                refresh.efId = mWarmStart.mismatchFileId();
+                mIccRefreshRegistrants.notifyRegistrants(new AsyncResult(null, refresh, null));
+                break;
+            }
+            case SamsungExynos4WarmStart.MISMATCH_NETWORK:
+                mVoiceNetworkStateRegistrants.notifyRegistrants(new AsyncResult(null, null, null));
+                break;
+        }
+
+        if (mWarmStart.isDirty() && !mDeviceHandler.hasMessages(EVENT_SAVE_WARM_START)) {
+            mDeviceHandler.sendEmptyMessageDelayed(EVENT_SAVE_WARM_START,
+                    WARM_START_SAVE_DELAY_MS);
+        }
+    }
+
+    private void
+    scheduleRequestDrain(long at) {
+        if (at < 0 || mDeviceHandler.hasMessages(EVENT_DRAIN_REQUESTS)) {
+            return;
+        }
+        mDeviceHandler.sendEmptyMessageDelayed(EVENT_DRAIN_REQUESTS,
+                Math.max(0, at - SystemClock.elapsedRealtime()));
+    }
+
+    private void
+    scheduleDataCallDrain(long at) {
+        if (at < 0 || mDeviceHandler.hasMessages(EVENT_DRAIN_DATA_CALLS)) {
+            return;
+        }
+        mDeviceHandler.sendEmptyMessageDelayed(EVENT_DRAIN_DATA_CALLS,
+                Math.max(0, at - SystemClock.elapsedRealtime()));
+    }
+
+    private void
+    scheduleSweep(long deadline) {
+        synchronized (mDeviceHandler) {
+            if (deadline >= mNextSweepAt) {
+                return;
+            }
+            mNextSweepAt = deadline;
+            mDeviceHandler.removeMessages(EVENT_SWEEP_PENDING_REQUESTS);
+            mDeviceHandler.sendEmptyMessageDelayed(EVENT_SWEEP_PENDING_REQUESTS,
+                    Math.max(0, deadline - SystemClock.elapsedRealtime()));
+        }
+    }
+
+    private void
+    sweepPendingRequests() {
+        synchronized (mDeviceHandler) {
+            mNextSweepAt = SamsungExynos4PendingRequests.NO_DEADLINE;
+        }
+
+        SparseArray<RILRequest> expired = new SparseArray<RILRequest>();
+        long next = mPendingRequests.sweep(SystemClock.elapsedRealtime(), expired);
+        for (int i = 0; i < expired.size(); i++) {
+            RILRequest rr = expired.valueAt(i);
+            int request = rr.mRequest;
+            if (requestTimeout(request) > 0) {
+                cancelRequest(expired.keyAt(i), request);
+                continue;
+            }
+            // RIL still owns the request and will answer it if the modem
+            // ever does, we only stop tracking it here.
+            mStaleRequestCount++;
+            Rlog.w(RILJ_LOG_TAG, "[" + expired.keyAt(i) + "]> " + requestToString(request)
+                    + " not answered after " + PENDING_REQUEST_TIMEOUT_MS + "ms");
+        }
+
+        if (next != SamsungExynos4PendingRequests.NO_DEADLINE) {
+            scheduleSweep(next);
+        }
+    }
+
+    /**
+     * @return how long request may take before it is answered with
+     *         REQUEST_CANCELLED, or -1 if it may take as long as it likes
+     */
+    private long
+    requestTimeout(int request) {
+        switch (request) {
+            case RIL_REQUEST_QUERY_AVAILABLE_NETWORKS:
+                return mNetworkScanTimeoutMs;
+            case RIL_REQUEST_SET_NETWORK_SELECTION_AUTOMATIC:
+            case RIL_REQUEST_SET_NETWORK_SELECTION_MANUAL:
+                return mNetworkSelectionTimeoutMs;
+            default:
+                return -1;
+        }
+    }
+
+    /*
+     * Fail a request that ran past its deadline with REQUEST_CANCELLED, the
+     * way processResponse() would have completed it. The socket protocol
+     * has no way to reach RIL_Cancel in rild, so the modem still finishes
+     * the request; its answer is then dropped as unexpected.
+     */
+    private void
+    cancelRequest(int serial, int request) {
+        RILRequest rr = findAndRemoveRequestFromList(serial);
+        if (rr == null) {
+            // Answered while we were looking.
+            return;
+        }
+
+        synchronized (mCancelledRequests) {
+            mCancelledRequests.put(request, mCancelledRequests.get(request) + 1);
+        }
+        Rlog.w(RILJ_LOG_TAG, rr.serialString() + "> " + requestToString(request)
+                + " not answered after " + requestTimeout(request) + "ms, cancelling");
+
+        rr.onError(REQUEST_CANCELLED, null);
+        rr.release();
+        decrementWakeLock();
+        scheduleRequestDrain(mRequestScheduler.complete(serial, SystemClock.elapsedRealtime()));
+        scheduleDataCallDrain(mDataCalls.complete(serial, REQUEST_CANCELLED,
+                SystemClock.elapsedRealtime()));
+    }
+
+    @Override
+    public void
+    dump(FileDescriptor fd, PrintWriter pw, String[] args) {
+        super.dump(fd, pw, args);
+        pw.println("SamsungExynos4RIL:");
+        pw.println(" mPendingRequests.size=" + mPendingRequests.size()
+                + " highWater=" + mPendingRequests.highWater());
+        pw.println(" mStaleRequestCount=" + mStaleRequestCount);
+        synchronized (mCancelledRequests) {
+            for (int i = 0; i < mCancelledRequests.size(); i++) {
+                pw.println(" cancelled " + requestToString(mCancelledRequests.keyAt(i))
+                        + "=" + mCancelledRequests.valueAt(i));
+            }
+        }
+        mLatencyHistograms.dump(pw);
+        mRequestScheduler.dump(pw);
+        mDataCalls.dump(pw);
+        if (mLce != null) {
+            mLce.dump(pw);
+        }
+        modemActivity().dump(pw);
+        mIdentityCache.dump(pw);
+        if (mWarmStart != null) {
+            mWarmStart.dump(pw);
+        }
+        if (mParcelRecorder != null) {
+            pw.println(" mParcelRecorder " + mParcelRecorder.stats());
+        }
+        mPhonebookReader.dump(pw);
+        mSignalStrengthFilter.dump(pw);
+        synchronized (unsolReplay()) {
+            unsolReplay().dump(pw);
+        }
+        pw.println(" mExpectMoreSupport=" + mExpectMoreSupport + " sent=" + mExpectMoreSent.get()
+                + " fallbacks=" + mExpectMoreFallbacks.get());
+        synchronized (mScreenLock) {
+            long offMs = mScreenOffTotalMs;
+            long avoided = mAvoidedWakeups;
+            if (mScreenOff) {
+                offMs += SystemClock.elapsedRealtime() - mScreenOffSince;
+                avoided += mSignalStrengthFilter.droppedCount() - mScreenOffSignalDroppedBase;
+            }
+            pw.println(" mScreenOff=" + mScreenOff + " screenOffMs=" + offMs
+                    + " avoidedWakeups=" + avoided + " perHour="
+                    + (offMs > 0 ? avoided * 3600000L / offMs : 0));
+        }
+    }
+
+    /*
+     * The xmm6262 has no LCE, answer the LCE requests from mLce instead.
+     */
+    @Override
+    public void
+    startLceService(int reportIntervalMs, boolean pullMode, Message response) {
+        if (mLce == null) {
+            super.startLceService(reportIntervalMs, pullMode, response);
+            return;
+        }
+        answerLocally(RIL_REQUEST_START_LCE, mLce.start(reportIntervalMs, pullMode), response);
+    }
+
+    @Override
+    public void
+    stopLceService(Message response) {
+        if (mLce == null) {
+            super.stopLceService(response);
+            return;
+        }
+        answerLocally(RIL_REQUEST_STOP_LCE, mLce.stop(), response);
+    }
+
+    @Override
+    public void
+    pullLceData(Message response) {
+        if (mLce == null) {
+            super.pullLceData(response);
+            return;
+        }
+        answerLocally(RIL_REQUEST_PULL_LCEDATA, mLce.pull(), response);
+    }
+
+    /* The xmm6262 doesn't keep activity stats, mModemActivity does */
+    @Override
+    public void
+    getModemActivityInfo(Message response) {
+        answerLocally(RIL_REQUEST_GET_ACTIVITY_INFO, modemActivity().snapshot(), response);
+    }
+
+    private void
+    answerLocally(int request, Object ret, Message response) {
+        if (RILJ_LOGD) riljLog("< " + requestToString(request) + " "
+                + retToString(request, ret) + " (emulated)");
+        if (response != null) {
+            AsyncResult.forMessage(response, ret, null);
+            response.sendToTarget();
+        }
+    }
+
+    @Override
+    public void
+    iccIOForApp(int command, int fileid, String path, int p1, int p2, int p3,
+            String data, String pin2, String aid, Message result) {
+        if (mPhonebookReader != null && mPhonebookReader.iccIO(command, fileid, path,
+                p1, p2, p3, data, pin2, aid, result)) {
+            return;
+        }
+        super.iccIOForApp(command, fileid, path, p1, p2, p3, data, pin2, aid, result);
+    }
+
+    /* ICC IO that bypasses mPhonebookReader, for its own reads */
+    void
+    sendIccIO(int command, int fileid, String path, int p1, int p2, int p3,
+            String data, String pin2, String aid, Message result) {
+        super.iccIOForApp(command, fileid, path, p1, p2, p3, data, pin2, aid, result);
+    }
+
     @Override
     public void
     dial(String address, int clirMode, UUSInfo uusInfo, Message result) {
@@ -447,14 +1289,82 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
     @Override
     protected void
     processUnsolicited (Parcel p) {
+        if (mParcelRecorder != null) {
+            long arrivalNs = SystemClock.elapsedRealtimeNanos();
+            int dataPosition = p.dataPosition();
+            boolean redact = SamsungExynos4ParcelRecorder.isSensitiveUnsol(p.readInt());
+            p.setDataPosition(dataPosition);
+            mParcelRecorder.record(SamsungExynos4ParcelRecorder.ENTRY_UNSOLICITED, arrivalNs, p,
+                    redact);
+        }
+        synchronized (mUnsolLock) {
+            processUnsolicitedResponse(p);
+        }
+    }
+
+    /* Replay entry point, skips the recorder */
+    void
+    replayUnsolicited(Parcel p) {
+        synchronized (mUnsolLock) {
+            processUnsolicitedResponse(p);
+        }
+    }
+
+    private void
+    processUnsolicitedResponse(Parcel p) {
         int dataPosition = p.dataPosition();
         int response = p.readInt();
         Object ret;
 
         try{switch(response) {
             case RIL_UNSOL_STK_PROACTIVE_COMMAND: ret = responseString(p); break;
+            case RIL_UNSOL_STK_EVENT_NOTIFY: ret = responseString(p); break;
+            case RIL_UNSOL_STK_SESSION_END: ret = responseVoid(p); break;
+            case RIL_UNSOL_STK_CALL_SETUP: ret = responseInts(p); break;
             case RIL_UNSOL_STK_SEND_SMS_RESULT: ret = responseInts(p); break; // Samsung STK
+            case RIL_UNSOL_RESTRICTED_STATE_CHANGED: ret = responseInts(p); break;
+            case RIL_UNSOL_SIGNAL_STRENGTH: ret = responseSignalStrength(p); break;
+            case RIL_UNSOL_HSDPA_STATE_CHANGED: ret = responseInts(p); break;
+            case RIL_UNSOL_DATA_CALL_LIST_CHANGED:
+                if (mDataCalls != null) {
+                    SamsungExynos4DataCalls.DataCallList list =
+                            mDataCalls.decodeDataCallList(this, p);
+                    if (!list.mChanged) {
+                        if (RILJ_LOGV) unsljLog(response);
+                        return;
+                    }
+                    ret = list.mList;
+                } else {
+                    ret = responseDataCallList(p);
+                }
+                break;
             default:
+                if (response == RIL_UNSOL_RESPONSE_VOICE_NETWORK_STATE_CHANGED
+                        && deferNetworkState()) {
+                    return;
+                }
+                if (response == RIL_UNSOL_RESPONSE_SIM_STATUS_CHANGED
+                        && mPhonebookReader != null) {
+                    mPhonebookReader.reset();
+                }
+                if (response == RIL_UNSOL_RESPONSE_RADIO_STATE_CHANGED) {
+                    int state = p.readInt();
+                    p.setDataPosition(dataPosition + 4);
+                    modemActivity().onRadioState(state);
+                    if (mDataCalls != null && mDataCalls.onRadioState(state)) {
+                        psAttach();
+                    }
+                }
+                if (response == RIL_UNSOL_DC_RT_INFO_CHANGED) {
+                    // RIL_DcRtInfo: time, powerState
+                    p.readLong();
+                    modemActivity().onDataPowerState(p.readInt());
+                    p.setDataPosition(dataPosition + 4);
+                }
+                if (mIdentityCache != null && modemWentAway(response, p)) {
+                    mIdentityCache.clear();
+                }
+
                 // Rewind the Parcel
                 p.setDataPosition(dataPosition);
 
@@ -469,37 +1379,369 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
 
         switch(response) {
             case RIL_UNSOL_STK_PROACTIVE_COMMAND:
+            case RIL_UNSOL_STK_EVENT_NOTIFY:
+            case RIL_UNSOL_STK_SESSION_END:
+            case RIL_UNSOL_STK_CALL_SETUP:
+            case RIL_UNSOL_STK_SEND_SMS_RESULT:
+            case RIL_UNSOL_RESTRICTED_STATE_CHANGED:
                 if (RILJ_LOGD) unsljLogRet(response, ret);
 
-                if (mCatProCmdRegistrant != null) {
-                    mCatProCmdRegistrant.notifyRegistrant(
-                            new AsyncResult (null, ret, null));
+                // The RIL sends these as soon as the SIM is up, which
+                // may well be before CatService or the service state
+                // tracker have registered. Buffer them so they don't get
+                // ignored (and break CatService).
+                notifyOrBuffer(response, ret);
+            break;
+            case RIL_UNSOL_SIGNAL_STRENGTH:
+                if (mLce != null) {
+                    mLce.onSignalStrength((SignalStrength) ret);
+                }
+                modemActivity().onSignalStrength((SignalStrength) ret);
+                if (mSignalStrengthFilter == null || mSignalStrengthFilter.offer(
+                        (SignalStrength) ret, SystemClock.elapsedRealtime())) {
+                    notifySignalStrength((SignalStrength) ret);
                 } else {
-                    // The RIL will send a CAT proactive command before the
-                    // registrant is registered. Buffer it to make sure it
-                    // does not get ignored (and breaks CatService).
-                    mCatProCmdBuffer = ret;
+                    scheduleSignalStrengthFlush();
                 }
             break;
-            case RIL_UNSOL_STK_SEND_SMS_RESULT:
+            case RIL_UNSOL_DATA_CALL_LIST_CHANGED:
                 if (RILJ_LOGD) unsljLogRet(response, ret);
 
-                if (mCatSendSmsResultRegistrant != null) {
-                    mCatSendSmsResultRegistrant.notifyRegistrant(
-                            new AsyncResult (null, ret, null));
+                mDataNetworkStateRegistrants.notifyRegistrants(new AsyncResult(null, ret, null));
+            break;
+            case RIL_UNSOL_HSDPA_STATE_CHANGED:
+                if (RILJ_LOGD) unsljLogRet(response, ret);
+
+                if (mLce != null) {
+                    int[] state = (int[]) ret;
+                    mLce.onHsdpaState(state.length > 0 && state[0] != 0);
                 }
             break;
         }
 
     }
 
+    /*
+     * Whether response says the modem restarted or went away, so whatever
+     * it told us about itself may have changed. Peeks at the radio state,
+     * the caller rewinds p.
+     */
+    private static boolean
+    modemWentAway(int response, Parcel p) {
+        switch (response) {
+            case RIL_UNSOL_RIL_CONNECTED:
+                return true;
+            case RIL_UNSOL_RESPONSE_RADIO_STATE_CHANGED:
+                // RIL_RadioState, 1 is RADIO_STATE_UNAVAILABLE
+                return p.readInt() == 1;
+            default:
+                return false;
+        }
+    }
+
+    /* RIL_REQUEST_DATA_REGISTRATION_STATE: [3] is the RIL_RadioTechnology */
+    private void
+    onDataRegistrationState(String[] state) {
+        if (state.length <= 3 || state[3] == null) {
+            return;
+        }
+        try {
+            mLce.onRadioTechnology(Integer.parseInt(state[3]));
+        } catch (NumberFormatException e) {
+        }
+    }
+
+    /* Push mode LCE report from mLce, as RIL_UNSOL_LCEDATA_RECV would be */
+    private void
+    notifyLceData(ArrayList<Integer> data) {
+        if (RILJ_LOGD) unsljLogRet(RIL_UNSOL_LCEDATA_RECV, data);
+
+        if (mLceInfoRegistrant != null) {
+            mLceInfoRegistrant.notifyRegistrant(new AsyncResult(null, data, null));
+        }
+    }
+
+    /* Samsung PS attach ahead of the first activation, see SamsungExynos4DataCalls */
+    private void
+    psAttach() {
+        RILRequest rr = RILRequest.obtain(RIL_REQUEST_PS_ATTACH, null);
+
+        if (RILJ_LOGD) riljLog(rr.serialString() + "> " + requestToString(rr.mRequest));
+
+        send(rr);
+    }
+
+    private void
+    notifySignalStrength(SignalStrength ss) {
+        if (mSignalStrengthRegistrant != null) {
+            mSignalStrengthRegistrant.notifyRegistrant(
+                    new AsyncResult (null, ss, null));
+        }
+    }
+
+    private void
+    scheduleSignalStrengthFlush() {
+        long at = mSignalStrengthFilter.flushAt();
+        if (at < 0 || mDeviceHandler.hasMessages(EVENT_FLUSH_SIGNAL_STRENGTH)) {
+            return;
+        }
+        mDeviceHandler.sendEmptyMessageDelayed(EVENT_FLUSH_SIGNAL_STRENGTH,
+                Math.max(0, at - SystemClock.elapsedRealtime()));
+    }
+
+    private void
+    flushSignalStrength() {
+        // Same lock as the unsol path, or a value held back here could be
+        // delivered after a newer one that got through in the meantime.
+        synchronized (mUnsolLock) {
+            SignalStrength ss = mSignalStrengthFilter.flush(SystemClock.elapsedRealtime());
+            if (ss != null) {
+                notifySignalStrength(ss);
+            } else {
+                // An update got through in the meantime and restarted the clock.
+                scheduleSignalStrengthFlush();
+            }
+        }
+    }
+
+    /*
+     * Screen off profile: while the default display is off, stop cell info
+     * and location update unsols, hold signal strength for longer and batch
+     * network state changes. Everything the framework asked for in the
+     * meantime is applied again when the screen comes back on.
+     */
+    private void
+    updateScreenState() {
+        Display display = mDisplayManager.getDisplay(Display.DEFAULT_DISPLAY);
+        boolean off = display != null && display.getState() != Display.STATE_ON;
+        boolean flush = false;
+
+        synchronized (mScreenLock) {
+            if (off == mScreenOff) {
+                return;
+            }
+            mScreenOff = off;
+            long now = SystemClock.elapsedRealtime();
+
+            if (off) {
+                mScreenOffSince = now;
+                mScreenOffSignalDroppedBase = mSignalStrengthFilter.droppedCount();
+                mSignalStrengthFilter.setMaxInterval(mScreenOffSignalMaxIntervalMs);
+                if (mCellInfoListRate >= 0) {
+                    super.setCellInfoListRate(Integer.MAX_VALUE, null);
+                }
+                if (mLocationUpdates) {
+                    super.setLocationUpdates(false, null);
+                }
+            } else {
+                mScreenOffTotalMs += now - mScreenOffSince;
+                mAvoidedWakeups += mSignalStrengthFilter.droppedCount()
+                        - mScreenOffSignalDroppedBase;
+                mSignalStrengthFilter.setMaxInterval(mSignalMaxIntervalMs);
+                if (mCellInfoListRate >= 0) {
+                    super.setCellInfoListRate(mCellInfoListRate, null);
+                }
+                if (mLocationUpdates) {
+                    super.setLocationUpdates(true, null);
+                }
+                flush = mNetworkStatePending;
+            }
+        }
+
+        if (RILJ_LOGD) riljLog("Screen " + (off ? "off" : "on") + ", unsol profile switched");
+        if (flush) {
+            mDeviceHandler.removeMessages(EVENT_FLUSH_NETWORK_STATE);
+            flushNetworkState();
+        }
+        // Let a held back signal strength out under the new interval.
+        mDeviceHandler.removeMessages(EVENT_FLUSH_SIGNAL_STRENGTH);
+        scheduleSignalStrengthFlush();
+    }
+
+    /**
+     * @return true if a voice network state change was folded into the
+     *         pending one instead of being passed on
+     */
+    private boolean
+    deferNetworkState() {
+        if (mDeviceHandler == null) {
+            return false;
+        }
+        synchronized (mScreenLock) {
+            if (!mScreenOff) {
+                return false;
+            }
+            if (mNetworkStatePending) {
+                mAvoidedWakeups++;
+                return true;
+            }
+            mNetworkStatePending = true;
+        }
+        mDeviceHandler.sendEmptyMessageDelayed(EVENT_FLUSH_NETWORK_STATE,
+                SCREEN_OFF_NETWORK_STATE_INTERVAL_MS);
+        return true;
+    }
+
+    private void
+    flushNetworkState() {
+        synchronized (mScreenLock) {
+            if (!mNetworkStatePending) {
+                return;
+            }
+            mNetworkStatePending = false;
+        }
+        if (RILJ_LOGD) unsljLog(RIL_UNSOL_RESPONSE_VOICE_NETWORK_STATE_CHANGED);
+        mVoiceNetworkStateRegistrants.notifyRegistrants(new AsyncResult(null, null, null));
+    }
+
+    @Override
+    public void
+    setCellInfoListRate(int rateInMillis, Message response) {
+        synchronized (mScreenLock) {
+            mCellInfoListRate = rateInMillis;
+            if (mScreenOff) {
+                // Applied when the screen comes back on.
+                if (response != null) {
+                    AsyncResult.forMessage(response, null, null);
+                    response.sendToTarget();
+                }
+                return;
+            }
+        }
+        super.setCellInfoListRate(rateInMillis, response);
+    }
+
+    @Override
+    public void
+    setLocationUpdates(boolean enable, Message response) {
+        synchronized (mScreenLock) {
+            mLocationUpdates = enable;
+            if (mScreenOff && enable) {
+                // Applied when the screen comes back on.
+                if (response != null) {
+                    AsyncResult.forMessage(response, null, null);
+                    response.sendToTarget();
+                }
+                return;
+            }
+        }
+        super.setLocationUpdates(enable, response);
+    }
+
+    private SamsungExynos4ModemActivity
+    modemActivity() {
+        synchronized (this) {
+            if (mModemActivity == null) {
+                mModemActivity = new SamsungExynos4ModemActivity(dataIface());
+            }
+            return mModemActivity;
+        }
+    }
+
+    /* Same interface as config_datause_iface */
+    private static String
+    dataIface() {
+        return SystemProperties.get("ro.ril.lce_iface", "pdp0");
+    }
+
+    private SamsungExynos4UnsolReplay
+    unsolReplay() {
+        synchronized (this) {
+            if (mUnsolReplay == null) {
+                mUnsolReplay = new SamsungExynos4UnsolReplay(UNSOL_REPLAY_CAPACITY);
+            }
+            return mUnsolReplay;
+        }
+    }
+
+    private Registrant
+    unsolRegistrant(int response) {
+        switch (response) {
+            case RIL_UNSOL_STK_PROACTIVE_COMMAND: return mCatProCmdRegistrant;
+            case RIL_UNSOL_STK_EVENT_NOTIFY: return mCatEventRegistrant;
+            case RIL_UNSOL_STK_SESSION_END: return mCatSessionEndRegistrant;
+            case RIL_UNSOL_STK_CALL_SETUP: return mCatCallSetUpRegistrant;
+            case RIL_UNSOL_STK_SEND_SMS_RESULT: return mCatSendSmsResultRegistrant;
+            case RIL_UNSOL_RESTRICTED_STATE_CHANGED: return mRestrictedStateRegistrant;
+            default: return null;
+        }
+    }
+
+    /*
+     * Delivery and buffering happen under the replay lock, and so does
+     * registration plus replay in the setOn*() overrides below, so a
+     * registrant sees buffered responses strictly before live ones.
+     */
+    private void
+    notifyOrBuffer(int response, Object ret) {
+        SamsungExynos4UnsolReplay replay = unsolReplay();
+        synchronized (replay) {
+            Registrant r = unsolRegistrant(response);
+            if (r != null) {
+                r.notifyRegistrant(new AsyncResult (null, ret, null));
+            } else {
+                replay.add(response, ret);
+            }
+        }
+    }
+
+    /* Caller holds the replay lock */
+    private void
+    replayUnsol(int response) {
+        ArrayList<Object> buffered = new ArrayList<Object>();
+        unsolReplay().drain(response, buffered);
+        Registrant r = unsolRegistrant(response);
+        for (Object ret : buffered) {
+            if (RILJ_LOGD) riljLog("Replaying " + responseToString(response));
+            r.notifyRegistrant(new AsyncResult (null, ret, null));
+        }
+    }
+
     @Override
     public void setOnCatProactiveCmd(Handler h, int what, Object obj) {
-        mCatProCmdRegistrant = new Registrant (h, what, obj);
-        if (mCatProCmdBuffer != null) {
-            mCatProCmdRegistrant.notifyRegistrant(
-                                new AsyncResult (null, mCatProCmdBuffer, null));
-            mCatProCmdBuffer = null;
+        synchronized (unsolReplay()) {
+            super.setOnCatProactiveCmd(h, what, obj);
+            replayUnsol(RIL_UNSOL_STK_PROACTIVE_COMMAND);
+        }
+    }
+
+    @Override
+    public void setOnCatEvent(Handler h, int what, Object obj) {
+        synchronized (unsolReplay()) {
+            super.setOnCatEvent(h, what, obj);
+            replayUnsol(RIL_UNSOL_STK_EVENT_NOTIFY);
+        }
+    }
+
+    @Override
+    public void setOnCatSessionEnd(Handler h, int what, Object obj) {
+        synchronized (unsolReplay()) {
+            super.setOnCatSessionEnd(h, what, obj);
+            replayUnsol(RIL_UNSOL_STK_SESSION_END);
+        }
+    }
+
+    @Override
+    public void setOnCatCallSetUp(Handler h, int what, Object obj) {
+        synchronized (unsolReplay()) {
+            super.setOnCatCallSetUp(h, what, obj);
+            replayUnsol(RIL_UNSOL_STK_CALL_SETUP);
+        }
+    }
+
+    @Override
+    public void setOnCatSendSmsResult(Handler h, int what, Object obj) {
+        synchronized (unsolReplay()) {
+            super.setOnCatSendSmsResult(h, what, obj);
+            replayUnsol(RIL_UNSOL_STK_SEND_SMS_RESULT);
+        }
+    }
+
+    @Override
+    public void setOnRestrictedStateChanged(Handler h, int what, Object obj) {
+        synchronized (unsolReplay()) {
+            super.setOnRestrictedStateChanged(h, what, obj);
+            replayUnsol(RIL_UNSOL_RESTRICTED_STATE_CHANGED);
         }
     }
 
@@ -510,21 +1752,82 @@ public class SamsungExynos4RIL extends RIL implements CommandsInterface {
         rr.mParcel.writeString(pdu);
     }
 
+    /* One multipart segment on its way through sendSMSExpectMore() */
+    private static final class SmsSegment {
+        final String mSmscPDU;
+        final String mPdu;
+        final Message mResult;
+
+        SmsSegment(String smscPDU, String pdu, Message result) {
+            mSmscPDU = smscPDU;
+            mPdu = pdu;
+            mResult = result;
+        }
+    }
+
     /**
-     * The RIL can't handle the RIL_REQUEST_SEND_SMS_EXPECT_MORE
-     * request properly, so we use RIL_REQUEST_SEND_SMS instead.
+     * Send all but the last segment of a multipart message with
+     * RIL_REQUEST_SEND_SMS_EXPECT_MORE, so the modem keeps the relay link
+     * up (AT+CMMS) instead of setting it up for every segment.
+     *
+     * The shipping xmm6262 RIL can't handle RIL_REQUEST_SEND_SMS_EXPECT_MORE
+     * properly, so by default every segment goes out with
+     * RIL_REQUEST_SEND_SMS as before. ro.ril.sms_expect_more=true always
+     * uses EXPECT_MORE, for RIL builds known to take it. With "auto" the
+     * first segments probe for it: a segment refused with
+     * REQUEST_NOT_SUPPORTED is sent again with SEND_SMS, and we stay with
+     * SEND_SMS from then on. Any other error goes back to SmsDispatcher as
+     * it is, the segment may well have reached the network and retrying is
+     * up to its TP-MR handling.
      */
     @Override
     public void
     sendSMSExpectMore (String smscPDU, String pdu, Message result) {
-        RILRequest rr
-                = RILRequest.obtain(RIL_REQUEST_SEND_SMS, result);
+        if (mExpectMoreSupport == EXPECT_MORE_UNSUPPORTED) {
+            sendSMS(smscPDU, pdu, result);
+            return;
+        }
+
+        RILRequest rr = RILRequest.obtain(RIL_REQUEST_SEND_SMS_EXPECT_MORE,
+                mDeviceHandler.obtainMessage(EVENT_SEND_SMS_EXPECT_MORE_DONE,
+                        new SmsSegment(smscPDU, pdu, result)));
 
         constructGsmSendSmsRilRequest(rr, smscPDU, pdu);
 
         if (RILJ_LOGD) riljLog(rr.serialString() + "> " + requestToString(rr.mRequest));
 
+        mExpectMoreSent.incrementAndGet();
         send(rr);
     }
 
+    private void
+    onSendSmsExpectMoreDone(AsyncResult ar) {
+        SmsSegment segment = (SmsSegment) ar.userObj;
+
+        if (ar.exception instanceof CommandException
+                && mExpectMoreSupport != EXPECT_MORE_SUPPORTED) {
+            CommandException.Error err = ((CommandException) ar.exception).getCommandError();
+            if (err == CommandException.Error.REQUEST_NOT_SUPPORTED) {
+                Rlog.i(RILJ_LOG_TAG, "SEND_SMS_EXPECT_MORE not supported, using SEND_SMS");
+                mExpectMoreSupport = EXPECT_MORE_UNSUPPORTED;
+                mExpectMoreFallbacks.incrementAndGet();
+                sendSMS(segment.mSmscPDU, segment.mPdu, segment.mResult);
+                return;
+            }
+        }
+
+        if (ar.exception == null) {
+            mExpectMoreSupport = EXPECT_MORE_SUPPORTED;
+        }
+        forwardSmsResult(segment, ar);
+    }
+
+    private static void
+    forwardSmsResult(SmsSegment segment, AsyncResult ar) {
+        if (segment.mResult != null) {
+            AsyncResult.forMessage(segment.mResult, ar.result, ar.exception);
+            segment.mResult.sendToTarget();
+        }
+    }
+
 }
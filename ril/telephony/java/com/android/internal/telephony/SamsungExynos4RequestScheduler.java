@@ -0,0 +1,249 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import static com.android.internal.telephony.RILConstants.*;
+
+import android.util.SparseLongArray;
+
+import java.io.PrintWriter;
+import java.util.ArrayDeque;
+import java.util.ArrayList;
+
+/**
+ * Keeps bulk requests from getting between the modem and call control.
+ *
+ * rild hands requests to the vendor RIL in socket order, and the vendor
+ * RIL works through them one at a time. Once a phonebook sync or cell info
+ * poll has put a few dozen SIM_IOs on the socket, a DIAL waits behind all
+ * of them. Requests are sorted into three classes:
+ *
+ *  CLASS_CALL         call control and emergency, always sent right away
+ *  CLASS_INTERACTIVE  everything else, always sent right away
+ *  CLASS_BULK         SIM record and cell info reads, at most mBulkLimit
+ *                     on the socket, none while call control is
+ *
+ * Bulk requests that are held back go out in order as earlier ones are
+ * answered. One that has waited mBulkMaxWaitMs goes out regardless, so a
+ * stuck call or a lost answer can't starve them for good. Held requests
+ * aren't in RIL's request list yet, so when RIL clears that the caller
+ * has to clear() them along with it.
+ */
+final class SamsungExynos4RequestScheduler {
+
+    static final int CLASS_CALL = 0;
+    static final int CLASS_INTERACTIVE = 1;
+    static final int CLASS_BULK = 2;
+
+    /* In-flight entries RIL doesn't know about after this long were lost */
+    private static final long LOST_REQUEST_GRACE_MS = 5000;
+
+    interface Dispatcher {
+        /**
+         * Put rr on the socket. sentAt is the elapsedRealtime() at which
+         * SamsungExynos4RIL.send() took it, before any holding back.
+         */
+        void dispatch(RILRequest rr, long sentAt);
+
+        /** @return whether RIL still waits for an answer to serial */
+        boolean isOutstanding(int serial);
+    }
+
+    private static final class Held {
+        final RILRequest mRequest;
+        final long mQueuedAt;
+        final long mSentAt;
+
+        Held(RILRequest rr, long queuedAt, long sentAt) {
+            mRequest = rr;
+            mQueuedAt = queuedAt;
+            mSentAt = sentAt;
+        }
+    }
+
+    private final Dispatcher mDispatcher;
+    private final int mBulkLimit;
+    private final long mBulkMaxWaitMs;
+
+    /* serial -> time sent, for the call control and bulk requests in flight */
+    private final SparseLongArray mCallInFlight = new SparseLongArray();
+    private final SparseLongArray mBulkInFlight = new SparseLongArray();
+    private final ArrayDeque<Held> mBulkQueue = new ArrayDeque<Held>();
+
+    private final long[] mSent = new long[3];
+    private long mHeld;
+    private long mAged;
+    private long mLost;
+    private int mMaxQueued;
+
+    SamsungExynos4RequestScheduler(Dispatcher dispatcher, int bulkLimit, long bulkMaxWaitMs) {
+        mDispatcher = dispatcher;
+        mBulkLimit = Math.max(1, bulkLimit);
+        mBulkMaxWaitMs = bulkMaxWaitMs;
+    }
+
+    static int
+    requestClass(int request) {
+        switch (request) {
+            case RIL_REQUEST_DIAL:
+            case SamsungExynos4RIL.RIL_REQUEST_DIAL_EMERGENCY:
+            case SamsungExynos4RIL.RIL_REQUEST_DIAL_VIDEO_CALL:
+            case RIL_REQUEST_ANSWER:
+            case RIL_REQUEST_HANGUP:
+            case RIL_REQUEST_HANGUP_WAITING_OR_BACKGROUND:
+            case RIL_REQUEST_HANGUP_FOREGROUND_RESUME_BACKGROUND:
+            case SamsungExynos4RIL.RIL_REQUEST_HANGUP_VT:
+            case SamsungExynos4RIL.RIL_REQUEST_MODEM_HANGUP:
+            case RIL_REQUEST_SWITCH_WAITING_OR_HOLDING_AND_ACTIVE:
+            case RIL_REQUEST_CONFERENCE:
+            case RIL_REQUEST_SEPARATE_CONNECTION:
+            case RIL_REQUEST_EXPLICIT_CALL_TRANSFER:
+            case SamsungExynos4RIL.RIL_REQUEST_CALL_DEFLECTION:
+            case RIL_REQUEST_UDUB:
+            case RIL_REQUEST_GET_CURRENT_CALLS:
+            case RIL_REQUEST_LAST_CALL_FAIL_CAUSE:
+            case RIL_REQUEST_DTMF:
+            case RIL_REQUEST_DTMF_START:
+            case RIL_REQUEST_DTMF_STOP:
+            case RIL_REQUEST_SET_MUTE:
+                return CLASS_CALL;
+
+            case RIL_REQUEST_SIM_IO:
+            case SamsungExynos4RIL.RIL_REQUEST_GET_PHONEBOOK_ENTRY:
+            case SamsungExynos4RIL.RIL_REQUEST_READ_SMS_FROM_SIM:
+            case RIL_REQUEST_GET_CELL_INFO_LIST:
+            case RIL_REQUEST_GET_NEIGHBORING_CELL_IDS:
+                return CLASS_BULK;
+
+            default:
+                return CLASS_INTERACTIVE;
+        }
+    }
+
+    /**
+     * @param sentAt passed back to Dispatcher.dispatch() if rr is held
+     * @return true if rr was held back, false if the caller should send it
+     *         now
+     */
+    synchronized boolean
+    submit(RILRequest rr, long now, long sentAt) {
+        int cls = requestClass(rr.mRequest);
+        switch (cls) {
+            case CLASS_CALL:
+                mCallInFlight.put(rr.mSerial, now);
+                break;
+            case CLASS_BULK:
+                if (!mBulkQueue.isEmpty() || !bulkAllowed(now)) {
+                    mBulkQueue.add(new Held(rr, now, sentAt));
+                    mHeld++;
+                    mMaxQueued = Math.max(mMaxQueued, mBulkQueue.size());
+                    return true;
+                }
+                mBulkInFlight.put(rr.mSerial, now);
+                break;
+        }
+        mSent[cls]++;
+        return false;
+    }
+
+    /**
+     * serial got its answer (or was given up on), send whatever that
+     * lets through.
+     *
+     * @return see drain()
+     */
+    synchronized long
+    complete(int serial, long now) {
+        mCallInFlight.delete(serial);
+        mBulkInFlight.delete(serial);
+        return drain(now);
+    }
+
+    /**
+     * Send the held back bulk requests that may go now.
+     *
+     * @return when the oldest request still held back has waited long
+     *         enough to go regardless, or -1 if none is held back
+     */
+    synchronized long
+    drain(long now) {
+        while (!mBulkQueue.isEmpty()) {
+            Held held = mBulkQueue.peek();
+            boolean aged = now - held.mQueuedAt >= mBulkMaxWaitMs;
+            if (!aged && !bulkAllowed(now)) {
+                return held.mQueuedAt + mBulkMaxWaitMs;
+            }
+            mBulkQueue.poll();
+            if (aged) {
+                mAged++;
+            }
+            mBulkInFlight.put(held.mRequest.mSerial, now);
+            mSent[CLASS_BULK]++;
+            mDispatcher.dispatch(held.mRequest, held.mSentAt);
+        }
+        return -1;
+    }
+
+    /**
+     * The socket went away, forget what was in flight.
+     *
+     * @return the requests held back, for the caller to fail
+     */
+    synchronized ArrayList<RILRequest>
+    clear() {
+        ArrayList<RILRequest> held = new ArrayList<RILRequest>(mBulkQueue.size());
+        for (Held h : mBulkQueue) {
+            held.add(h.mRequest);
+        }
+        mBulkQueue.clear();
+        mCallInFlight.clear();
+        mBulkInFlight.clear();
+        return held;
+    }
+
+    synchronized void
+    dump(PrintWriter pw) {
+        pw.println(" mRequestScheduler bulkLimit=" + mBulkLimit
+                + " bulkMaxWaitMs=" + mBulkMaxWaitMs
+                + " sent call/interactive/bulk=" + mSent[CLASS_CALL] + "/"
+                + mSent[CLASS_INTERACTIVE] + "/" + mSent[CLASS_BULK]
+                + " held=" + mHeld + " aged=" + mAged + " lost=" + mLost
+                + " queued=" + mBulkQueue.size() + " maxQueued=" + mMaxQueued);
+    }
+
+    private boolean
+    bulkAllowed(long now) {
+        prune(mCallInFlight, now);
+        prune(mBulkInFlight, now);
+        return mCallInFlight.size() == 0 && mBulkInFlight.size() < mBulkLimit;
+    }
+
+    /*
+     * Requests RIL fails itself (socket errors, radio off) never reach
+     * complete(), forget them once RIL has.
+     */
+    private void
+    prune(SparseLongArray inFlight, long now) {
+        for (int i = inFlight.size() - 1; i >= 0; i--) {
+            if (now - inFlight.valueAt(i) > LOST_REQUEST_GRACE_MS
+                    && !mDispatcher.isOutstanding(inFlight.keyAt(i))) {
+                inFlight.removeAt(i);
+                mLost++;
+            }
+        }
+    }
+}
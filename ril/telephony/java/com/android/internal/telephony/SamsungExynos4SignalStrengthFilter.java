@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.telephony.SignalStrength;
+
+import java.io.PrintWriter;
+
+/**
+ * Coalesces RIL_UNSOL_SIGNAL_STRENGTH.
+ *
+ * In weak coverage the modem reports signal strength several times a second,
+ * mostly wobbling by one unit. An update is passed on when the bar level
+ * changes, when any RIL_SignalStrength_v10 field moved by at least
+ * mHysteresis since the last update passed on, or when mMaxIntervalMs has
+ * gone by. Anything else is held back; the caller is expected to flush()
+ * the newest held back update once mMaxIntervalMs is over, so the framework
+ * still converges on the current value.
+ *
+ * A max interval of 0 disables coalescing.
+ */
+final class SamsungExynos4SignalStrengthFilter {
+
+    private int mHysteresis;
+    private long mMaxIntervalMs;
+
+    private SignalStrength mLast;
+    private long mLastAt;
+    private SignalStrength mPending;
+
+    private long mPassedCount;
+    private long mDroppedCount;
+
+    SamsungExynos4SignalStrengthFilter(int hysteresis, long maxIntervalMs) {
+        mHysteresis = hysteresis;
+        mMaxIntervalMs = maxIntervalMs;
+    }
+
+    synchronized void
+    setMaxInterval(long maxIntervalMs) {
+        mMaxIntervalMs = maxIntervalMs;
+    }
+
+    synchronized long
+    maxInterval() {
+        return mMaxIntervalMs;
+    }
+
+    /**
+     * @return true if ss should be passed on now, false if it was held back
+     */
+    synchronized boolean
+    offer(SignalStrength ss, long now) {
+        // Whatever was held back is superseded by ss either way.
+        if (mPending != null) {
+            mDroppedCount++;
+        }
+        if (mLast == null || mMaxIntervalMs <= 0 || now - mLastAt >= mMaxIntervalMs
+                || ss.getLevel() != mLast.getLevel() || moved(mLast, ss)) {
+            pass(ss, now);
+            return true;
+        }
+        mPending = ss;
+        return false;
+    }
+
+    /**
+     * @return the update held back since the last one passed on, if
+     *         mMaxIntervalMs has gone by, or null
+     */
+    synchronized SignalStrength
+    flush(long now) {
+        SignalStrength ss = mPending;
+        if (ss == null || now - mLastAt < mMaxIntervalMs) {
+            return null;
+        }
+        pass(ss, now);
+        return ss;
+    }
+
+    /** @return when flush() will have something to return, or -1 */
+    synchronized long
+    flushAt() {
+        return mPending == null ? -1 : mLastAt + mMaxIntervalMs;
+    }
+
+    synchronized long
+    droppedCount() {
+        return mDroppedCount;
+    }
+
+    synchronized void
+    dump(PrintWriter pw) {
+        pw.println(" mSignalStrengthFilter hysteresis=" + mHysteresis
+                + " maxIntervalMs=" + mMaxIntervalMs + " passed=" + mPassedCount
+                + " dropped=" + mDroppedCount + " pending=" + (mPending != null));
+    }
+
+    private void
+    pass(SignalStrength ss, long now) {
+        mLast = ss;
+        mLastAt = now;
+        mPending = null;
+        mPassedCount++;
+    }
+
+    private boolean
+    moved(SignalStrength a, SignalStrength b) {
+        return moved(a.getGsmSignalStrength(), b.getGsmSignalStrength())
+                || moved(a.getGsmBitErrorRate(), b.getGsmBitErrorRate())
+                || moved(a.getCdmaDbm(), b.getCdmaDbm())
+                || moved(a.getCdmaEcio(), b.getCdmaEcio())
+                || moved(a.getEvdoDbm(), b.getEvdoDbm())
+                || moved(a.getEvdoEcio(), b.getEvdoEcio())
+                || moved(a.getEvdoSnr(), b.getEvdoSnr())
+                || moved(a.getLteSignalStrength(), b.getLteSignalStrength())
+                || moved(a.getLteRsrp(), b.getLteRsrp())
+                || moved(a.getLteRsrq(), b.getLteRsrq())
+                || moved(a.getLteRssnr(), b.getLteRssnr())
+                || moved(a.getLteCqi(), b.getLteCqi())
+                || moved(a.getTdScdmaRscp(), b.getTdScdmaRscp());
+    }
+
+    private boolean
+    moved(int a, int b) {
+        // Unknown values are Integer.MAX_VALUE, don't let that overflow.
+        return Math.abs((long) a - b) >= Math.max(1, mHysteresis);
+    }
+}
@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.os.Handler;
+import android.os.Parcel;
+import android.os.SystemClock;
+import android.telephony.Rlog;
+
+import java.io.BufferedInputStream;
+import java.io.DataInputStream;
+import java.io.EOFException;
+import java.io.File;
+import java.io.FileInputStream;
+import java.io.IOException;
+
+/**
+ * Feeds a SamsungExynos4ParcelRecorder capture back into SamsungExynos4RIL's
+ * unsol handling, keeping the recorded spacing scaled by 1/speed (0 replays
+ * as fast as possible).
+ *
+ * Solicited entries can't be replayed, their serials don't match anything
+ * we sent; they are only counted. The time spent handling the replayed
+ * parcels is logged at the end, which is what to compare between builds
+ * when bisecting a regression. This thread only reads and paces the trace;
+ * the parcels are handled on the given handler's looper so they never race
+ * the RIL's own unsol path beyond what SamsungExynos4RIL serializes.
+ *
+ * This injects state into the running phone, so it is only started on
+ * debuggable builds, see SamsungExynos4RIL.
+ */
+final class SamsungExynos4TraceReplay extends Thread {
+
+    private static final String LOG_TAG = "SamsungExynos4TraceReplay";
+
+    private final SamsungExynos4RIL mRil;
+    private final Handler mHandler;
+    private final File mFile;
+    private final double mSpeed;
+    private final long mDelayMs;
+
+    /* Only touched on mHandler's looper */
+    private int mReplayed;
+    private long mTotalNs;
+    private long mMaxNs;
+
+    SamsungExynos4TraceReplay(SamsungExynos4RIL ril, Handler handler, File file, double speed,
+            long delayMs) {
+        super(LOG_TAG);
+        mRil = ril;
+        mHandler = handler;
+        mFile = file;
+        mSpeed = speed;
+        mDelayMs = delayMs;
+    }
+
+    @Override
+    public void
+    run() {
+        SystemClock.sleep(mDelayMs);
+
+        DataInputStream in = null;
+        try {
+            in = new DataInputStream(new BufferedInputStream(new FileInputStream(mFile)));
+            if (Integer.reverseBytes(in.readInt()) != SamsungExynos4ParcelRecorder.TRACE_MAGIC
+                    || Integer.reverseBytes(in.readInt())
+                            != SamsungExynos4ParcelRecorder.TRACE_VERSION) {
+                Rlog.e(LOG_TAG, mFile + " is not a RIL trace");
+                return;
+            }
+            in.readLong();
+            replay(in);
+        } catch (IOException e) {
+            Rlog.e(LOG_TAG, "Replay of " + mFile + " failed", e);
+        } finally {
+            if (in != null) {
+                try {
+                    in.close();
+                } catch (IOException e) {
+                }
+            }
+        }
+    }
+
+    private void
+    replay(DataInputStream in) throws IOException {
+        long firstAt = -1;
+        long startNs = SystemClock.elapsedRealtimeNanos();
+        int skipped = 0;
+
+        while (true) {
+            int length;
+            try {
+                length = Integer.reverseBytes(in.readInt());
+            } catch (EOFException e) {
+                break;
+            }
+            if (length < SamsungExynos4ParcelRecorder.ENTRY_HEADER_BYTES
+                    || length > SamsungExynos4ParcelRecorder.MAX_ENTRY_BYTES) {
+                throw new IOException("corrupt entry, length " + length);
+            }
+            int flags = Integer.reverseBytes(in.readInt());
+            long at = Long.reverseBytes(in.readLong());
+            byte[] data = new byte[length - SamsungExynos4ParcelRecorder.ENTRY_HEADER_BYTES];
+            in.readFully(data);
+
+            if (flags != SamsungExynos4ParcelRecorder.ENTRY_UNSOLICITED) {
+                skipped++;
+                continue;
+            }
+
+            if (firstAt < 0) {
+                firstAt = at;
+            }
+            if (mSpeed > 0) {
+                long dueNs = startNs + (long) ((at - firstAt) / mSpeed);
+                long waitMs = (dueNs - SystemClock.elapsedRealtimeNanos()) / 1000000;
+                if (waitMs > 0) {
+                    SystemClock.sleep(waitMs);
+                }
+            }
+
+            final Parcel p = Parcel.obtain();
+            p.unmarshall(data, 0, data.length);
+            p.setDataPosition(0);
+            p.readInt(); // RESPONSE_UNSOLICITED
+
+            mHandler.post(new Runnable() {
+                @Override
+                public void run() {
+                    long t0 = SystemClock.elapsedRealtimeNanos();
+                    mRil.replayUnsolicited(p);
+                    long spent = SystemClock.elapsedRealtimeNanos() - t0;
+                    p.recycle();
+                    mTotalNs += spent;
+                    mMaxNs = Math.max(mMaxNs, spent);
+                    mReplayed++;
+                }
+            });
+        }
+
+        final int skippedEntries = skipped;
+        mHandler.post(new Runnable() {
+            @Override
+            public void run() {
+                Rlog.i(LOG_TAG, "Replayed " + mReplayed + " unsols from " + mFile + " ("
+                        + skippedEntries + " solicited or redacted skipped), handling took mean "
+                        + (mReplayed > 0 ? mTotalNs / mReplayed / 1000 : 0) + "us max "
+                        + mMaxNs / 1000 + "us");
+            }
+        });
+    }
+}
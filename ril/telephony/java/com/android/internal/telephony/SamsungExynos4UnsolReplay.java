@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import android.util.SparseArray;
+
+import java.io.PrintWriter;
+import java.util.ArrayList;
+
+/**
+ * Per unsol code rings of responses that arrived while nobody was
+ * registered for them, replayed in arrival order once somebody is.
+ *
+ * Each ring holds the newest mCapacity responses; older ones are counted
+ * as dropped. The class does no locking of its own, callers serialize
+ * buffering against registration (see SamsungExynos4RIL.notifyOrBuffer).
+ */
+final class SamsungExynos4UnsolReplay {
+
+    private static final class Ring {
+        final Object[] mItems;
+        int mHead;
+        int mCount;
+        long mBuffered;
+        long mDropped;
+
+        Ring(int capacity) {
+            mItems = new Object[capacity];
+        }
+    }
+
+    private final int mCapacity;
+    private final SparseArray<Ring> mRings = new SparseArray<Ring>();
+
+    SamsungExynos4UnsolReplay(int capacity) {
+        mCapacity = Math.max(1, capacity);
+    }
+
+    void
+    add(int response, Object ret) {
+        Ring ring = mRings.get(response);
+        if (ring == null) {
+            ring = new Ring(mCapacity);
+            mRings.put(response, ring);
+        }
+        int tail = (ring.mHead + ring.mCount) % mCapacity;
+        ring.mItems[tail] = ret;
+        if (ring.mCount == mCapacity) {
+            ring.mHead = (ring.mHead + 1) % mCapacity;
+            ring.mDropped++;
+        } else {
+            ring.mCount++;
+        }
+        ring.mBuffered++;
+    }
+
+    /** Move everything buffered for response to out, oldest first */
+    void
+    drain(int response, ArrayList<Object> out) {
+        Ring ring = mRings.get(response);
+        if (ring == null) {
+            return;
+        }
+        for (; ring.mCount > 0; ring.mCount--) {
+            out.add(ring.mItems[ring.mHead]);
+            ring.mItems[ring.mHead] = null;
+            ring.mHead = (ring.mHead + 1) % mCapacity;
+        }
+    }
+
+    void
+    dump(PrintWriter pw) {
+        pw.println(" mUnsolReplay capacity=" + mCapacity);
+        for (int i = 0; i < mRings.size(); i++) {
+            Ring ring = mRings.valueAt(i);
+            pw.println("  " + SamsungExynos4RIL.responseToString(mRings.keyAt(i))
+                    + " buffered=" + ring.mBuffered + " dropped=" + ring.mDropped
+                    + " pending=" + ring.mCount);
+        }
+    }
+}
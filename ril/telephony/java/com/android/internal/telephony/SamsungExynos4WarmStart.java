@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2016 The CyanogenMod Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+package com.android.internal.telephony;
+
+import static com.android.internal.telephony.RILConstants.*;
+
+import android.os.Parcel;
+import android.telephony.Rlog;
+import android.util.AtomicFile;
+import android.util.SparseArray;
+
+import java.io.DataInputStream;
+import java.io.DataOutputStream;
+import java.io.File;
+import java.io.FileNotFoundException;
+import java.io.FileOutputStream;
+import java.io.IOException;
+import java.io.PrintWriter;
+import java.nio.charset.StandardCharsets;
+import java.security.MessageDigest;
+import java.security.NoSuchAlgorithmException;
+import java.security.SecureRandom;
+import java.util.Arrays;
+import java.util.HashMap;
+import java.util.Map;
+
+/**
+ * Snapshot of the SIM and network answers the framework asks for right
+ * after boot, kept across reboots so they can be answered before the modem
+ * has.
+ *
+ * Entries are the raw response payloads (what follows serial and error in
+ * the response parcel), keyed by request code and request arguments. An
+ * entry is served at most once per boot: the request still goes to the
+ * modem, and its answer validates the entry; the framework only ever
+ * gets the one answer. A mismatch throws the whole snapshot away and tells
+ * SamsungExynos4RIL which state the framework has to read again: network
+ * state is polled again, a SIM file is refreshed as if the SIM had asked
+ * for it, which makes IccRecords read its files again.
+ *
+ * Only network state and a fixed list of operator provided EFs that
+ * don't change under a given SIM (EF_AD, EF_SPN, EF_SPDI, EF_PNN, EF_OPL)
+ * are kept. Card status is never served, the framework must not see a
+ * READY app before the modem says so. SIM file contents are only served
+ * after the modem's own EF_ICCID read matched, so a different SIM never
+ * sees the previous one's files. ICCID and IMSI are never stored, only
+ * hashes of them salted per device, to catch a SIM swap.
+ */
+final class SamsungExynos4WarmStart {
+
+    static final int MISMATCH_NONE = 0;
+    static final int MISMATCH_SIM = 1;
+    static final int MISMATCH_NETWORK = 2;
+
+    private static final String LOG_TAG = "SamsungExynos4WarmStart";
+
+    private static final int SNAPSHOT_MAGIC = 0x31575253; // "SRW1"
+    private static final int SNAPSHOT_VERSION = 2;
+
+    private static final int MAX_ENTRIES = 128;
+    private static final int MAX_PAYLOAD_BYTES = 1024;
+    private static final int SALT_BYTES = 16;
+
+    private static final int COMMAND_READ_BINARY = 0xb0;
+    private static final int COMMAND_READ_RECORD = 0xb2;
+    private static final int COMMAND_GET_RESPONSE = 0xc0;
+    private static final int EF_ICCID = 0x2fe2;
+    private static final int EF_SPN = 0x6f46;
+    private static final int EF_AD = 0x6fad;
+    private static final int EF_PNN = 0x6fc5;
+    private static final int EF_OPL = 0x6fc6;
+    private static final int EF_SPDI = 0x6fcd;
+
+    private final AtomicFile mFile;
+    private byte[] mSalt;
+
+    /* What the last boot saw, emptied when it turns out to be stale */
+    private final HashMap<String, byte[]> mSnapshot = new HashMap<String, byte[]>();
+    private String mSnapshotIccidHash;
+    private String mSnapshotImsiHash;
+    /* What this boot saw, saved for the next one */
+    private final HashMap<String, byte[]> mLive = new HashMap<String, byte[]>();
+    private String mLiveIccidHash;
+    private String mLiveImsiHash;
+
+    /* serial -> key of the snapshot-able requests in flight */
+    private final SparseArray<String> mInFlight = new SparseArray<String>();
+    /* serial -> payload served for it, to validate against */
+    private final SparseArray<byte[]> mServed = new SparseArray<byte[]>();
+
+    private boolean mSimArmed;
+    /* EF of the last MISMATCH_SIM */
+    private int mMismatchFileId;
+    private boolean mDirty;
+
+    private int mServedCount;
+    private int mValidatedCount;
+    private int mMismatchCount;
+
+    SamsungExynos4WarmStart(File file) {
+        mFile = new AtomicFile(file);
+    }
+
+    /**
+     * @return the key rr's answer is stored under, or null if it isn't
+     *         part of the snapshot
+     */
+    static String
+    key(RILRequest rr) {
+        switch (rr.mRequest) {
+            case RIL_REQUEST_GET_IMSI:
+            case RIL_REQUEST_OPERATOR:
+            case RIL_REQUEST_VOICE_REGISTRATION_STATE:
+            case RIL_REQUEST_DATA_REGISTRATION_STATE:
+                break;
+            case RIL_REQUEST_SIM_IO:
+                if (!isSnapshotFile(rr.mParcel)) {
+                    return null;
+                }
+                break;
+            default:
+                return null;
+        }
+
+        // The arguments follow request code and serial.
+        byte[] data = rr.mParcel.marshall();
+        return rr.mRequest + ":" + new String(data, 8, data.length - 8,
+                StandardCharsets.ISO_8859_1);
+    }
+
+    synchronized void
+    load() {
+        DataInputStream in = null;
+        try {
+            in = new DataInputStream(mFile.openRead());
+            if (in.readInt() != SNAPSHOT_MAGIC || in.readInt() != SNAPSHOT_VERSION) {
+                // Older versions kept SIM contents we no longer want on disk.
+                mFile.delete();
+                return;
+            }
+            byte[] salt = new byte[SALT_BYTES];
+            in.readFully(salt);
+            String iccidHash = in.readUTF();
+            String imsiHash = in.readUTF();
+            int count = Math.min(in.readInt(), MAX_ENTRIES);
+            for (int i = 0; i < count; i++) {
+                String key = in.readUTF();
+                byte[] payload = new byte[Math.min(in.readInt(), MAX_PAYLOAD_BYTES)];
+                in.readFully(payload);
+                mSnapshot.put(key, payload);
+            }
+            mSalt = salt;
+            mSnapshotIccidHash = iccidHash.isEmpty() ? null : iccidHash;
+            mSnapshotImsiHash = imsiHash.isEmpty() ? null : imsiHash;
+        } catch (FileNotFoundException e) {
+            // First boot
+        } catch (IOException e) {
+            Rlog.w(LOG_TAG, "Dropping unreadable snapshot", e);
+            mSnapshot.clear();
+        } finally {
+            if (mSalt == null) {
+                mSalt = new byte[SALT_BYTES];
+                new SecureRandom().nextBytes(mSalt);
+            }
+            if (in != null) {
+                try {
+                    in.close();
+                } catch (IOException e) {
+                }
+            }
+        }
+    }
+
+    /**
+     * Note that rr is about to be sent.
+     *
+     * @return the snapshot payload to answer it with right away, or null
+     */
+    synchronized byte[]
+    onSend(RILRequest rr, String key) {
+        mInFlight.put(rr.mSerial, key);
+
+        byte[] payload = mSnapshot.get(key);
+        if (payload == null || (rr.mRequest == RIL_REQUEST_SIM_IO && !mSimArmed)) {
+            return null;
+        }
+        // Once per boot, later requests go to the modem.
+        mSnapshot.remove(key);
+        mServed.put(rr.mSerial, payload);
+        mServedCount++;
+        return payload;
+    }
+
+    /** @return whether onResponse() wants to see the answer to serial */
+    synchronized boolean
+    tracks(int serial) {
+        return mInFlight.get(serial) != null;
+    }
+
+    /**
+     * The modem answered serial (payload is null if it failed).
+     *
+     * @return MISMATCH_NONE, or what the framework has to look at again
+     *         because what we served for serial was wrong; for
+     *         MISMATCH_SIM, mismatchFileId() tells which EF
+     */
+    synchronized int
+    onResponse(int serial, byte[] payload) {
+        String key = mInFlight.get(serial);
+        if (key == null) {
+            return MISMATCH_NONE;
+        }
+        mInFlight.remove(serial);
+        int request = Integer.parseInt(key.substring(0, key.indexOf(':')));
+        byte[] served = mServed.get(serial);
+        mServed.remove(serial);
+
+        if (payload != null) {
+            if (request == RIL_REQUEST_GET_IMSI) {
+                onImsi(payload);
+            } else if (isIccidRead(key)) {
+                onIccid(payload);
+            } else if (payload.length <= MAX_PAYLOAD_BYTES && mLive.size() < MAX_ENTRIES) {
+                byte[] old = mLive.put(key, payload);
+                mDirty |= old == null || !Arrays.equals(old, payload);
+            }
+        }
+
+        if (served == null) {
+            return MISMATCH_NONE;
+        }
+        if (payload != null && Arrays.equals(served, payload)) {
+            mValidatedCount++;
+            return MISMATCH_NONE;
+        }
+
+        mMismatchCount++;
+        Rlog.i(LOG_TAG, SamsungExynos4RIL.requestToString(request)
+                + " differs from the snapshot, dropping it");
+        invalidate();
+        switch (request) {
+            case RIL_REQUEST_OPERATOR:
+            case RIL_REQUEST_VOICE_REGISTRATION_STATE:
+            case RIL_REQUEST_DATA_REGISTRATION_STATE:
+                return MISMATCH_NETWORK;
+            default:
+                mMismatchFileId = keyInt(key, 1);
+                return MISMATCH_SIM;
+        }
+    }
+
+    synchronized int
+    mismatchFileId() {
+        return mMismatchFileId;
+    }
+
+    /** Write what this boot has seen, if anything changed */
+    void
+    save() {
+        HashMap<String, byte[]> entries;
+        byte[] salt;
+        String iccidHash;
+        String imsiHash;
+        synchronized (this) {
+            if (!mDirty) {
+                return;
+            }
+            mDirty = false;
+            // Entries this boot hasn't asked for yet are still good.
+            entries = new HashMap<String, byte[]>(mSnapshot);
+            entries.putAll(mLive);
+            salt = mSalt;
+            iccidHash = mLiveIccidHash != null ? mLiveIccidHash : mSnapshotIccidHash;
+            imsiHash = mLiveImsiHash != null ? mLiveImsiHash : mSnapshotImsiHash;
+        }
+
+        FileOutputStream fos = null;
+        try {
+            fos = mFile.startWrite();
+            DataOutputStream out = new DataOutputStream(fos);
+            out.writeInt(SNAPSHOT_MAGIC);
+            out.writeInt(SNAPSHOT_VERSION);
+            out.write(salt);
+            out.writeUTF(iccidHash != null ? iccidHash : "");
+            out.writeUTF(imsiHash != null ? imsiHash : "");
+            int count = Math.min(entries.size(), MAX_ENTRIES);
+            out.writeInt(count);
+            for (Map.Entry<String, byte[]> e : entries.entrySet()) {
+                if (count-- == 0) {
+                    break;
+                }
+                out.writeUTF(e.getKey());
+                out.writeInt(e.getValue().length);
+                out.write(e.getValue());
+            }
+            out.flush();
+            mFile.finishWrite(fos);
+        } catch (IOException e) {
+            Rlog.w(LOG_TAG, "Could not save snapshot", e);
+            if (fos != null) {
+                mFile.failWrite(fos);
+            }
+        }
+    }
+
+    synchronized boolean
+    isDirty() {
+        return mDirty;
+    }
+
+    synchronized void
+    dump(PrintWriter pw) {
+        pw.println(" mWarmStart entries=" + mSnapshot.size() + " live=" + mLive.size()
+                + " simArmed=" + mSimArmed + " served=" + mServedCount
+                + " validated=" + mValidatedCount + " mismatched=" + mMismatchCount);
+    }
+
+    private void
+    invalidate() {
+        mSnapshot.clear();
+        mSnapshotIccidHash = null;
+        mSnapshotImsiHash = null;
+        mSimArmed = false;
+        mDirty = true;
+    }
+
+    private void
+    onIccid(byte[] payload) {
+        String hash = hash(payload);
+        if (mSnapshotIccidHash != null) {
+            if (mSnapshotIccidHash.equals(hash)) {
+                mSimArmed = true;
+            } else {
+                Rlog.i(LOG_TAG, "Different SIM, dropping snapshot");
+                invalidate();
+            }
+        }
+        mDirty |= !hash.equals(mLiveIccidHash);
+        mLiveIccidHash = hash;
+    }
+
+    private void
+    onImsi(byte[] payload) {
+        String hash = hash(payload);
+        if (mSnapshotImsiHash != null && !mSnapshotImsiHash.equals(hash)) {
+            Rlog.i(LOG_TAG, "Different IMSI, dropping snapshot");
+            invalidate();
+        }
+        mDirty |= !hash.equals(mLiveImsiHash);
+        mLiveImsiHash = hash;
+    }
+
+    private static boolean
+    isIccidRead(String key) {
+        return key.startsWith(RIL_REQUEST_SIM_IO + ":")
+                && keyInt(key, 0) == COMMAND_READ_BINARY && keyInt(key, 1) == EF_ICCID;
+    }
+
+    /* SIM_IO key -> index'th int of the arguments (command, fileid) */
+    private static int
+    keyInt(String key, int index) {
+        int start = key.indexOf(':') + 1 + 4 * index;
+        int value = 0;
+        for (int b = 3; b >= 0; b--) {
+            value = (value << 8) | (key.charAt(start + b) & 0xff);
+        }
+        return value;
+    }
+
+    /*
+     * Plain reads of the files we keep, and of EF_ICCID, whose answer is
+     * only hashed. See RIL.iccIOForApp() for the layout.
+     */
+    private static boolean
+    isSnapshotFile(Parcel p) {
+        int pos = p.dataPosition();
+        try {
+            p.setDataPosition(8);
+            int command = p.readInt();
+            int fileid = p.readInt();
+            p.readString(); // path
+            p.readInt(); // p1
+            p.readInt(); // p2
+            p.readInt(); // p3
+            p.readString(); // data
+            String pin2 = p.readString();
+            if (pin2 != null) {
+                return false;
+            }
+            if (fileid == EF_ICCID) {
+                return command == COMMAND_READ_BINARY;
+            }
+            if (command != COMMAND_READ_BINARY && command != COMMAND_READ_RECORD
+                    && command != COMMAND_GET_RESPONSE) {
+                return false;
+            }
+            switch (fileid) {
+                case EF_AD:
+                case EF_SPN:
+                case EF_SPDI:
+                case EF_PNN:
+                case EF_OPL:
+                    return true;
+                default:
+                    return false;
+            }
+        } finally {
+            p.setDataPosition(pos);
+        }
+    }
+
+    /* Caller holds the lock, mSalt is set by load() */
+    private String
+    hash(byte[] data) {
+        try {
+            MessageDigest md = MessageDigest.getInstance("SHA-256");
+            md.update(mSalt);
+            byte[] digest = md.digest(data);
+            StringBuilder sb = new StringBuilder();
+            for (byte b : digest) {
+                sb.append(String.format("%02x", b & 0xff));
+            }
+            return sb.toString();
+        } catch (NoSuchAlgorithmException e) {
+            return "";
+        }
+    }
+}